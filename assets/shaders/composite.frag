@@ -0,0 +1,56 @@
+#version 460
+
+layout (location = 0) in vec2 inUV;
+layout (location = 0) out vec4 outFragColor;
+
+layout(set = 0, binding = 0) uniform sampler2D drawImage;
+// Level n is the source downsampled n + 1 times, only the part covering the source is valid
+layout(set = 0, binding = 1) uniform sampler2D bloomImage;
+
+layout(push_constant) uniform constants {
+    vec2 uvScale;
+    float exposure;
+    uint tonemapper;
+    vec2 bloomSourceSize;
+    float bloomIntensity;
+    uint bloomLevels;
+} PushConstants;
+
+const uint TONEMAP_NONE = 0;
+const uint TONEMAP_REINHARD = 1;
+const uint TONEMAP_ACES = 2;
+
+// Narkowicz's fit of the ACES filmic curve
+vec3 aces(vec3 x) {
+    return clamp((x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f), 0.0f, 1.0f);
+}
+
+// Every level weighs the same, the wide low levels give the glow its falloff
+vec3 sample_bloom() {
+    vec3 bloom = vec3(0.0f);
+    vec2 size = PushConstants.bloomSourceSize;
+    for (uint level = 0; level < PushConstants.bloomLevels; level++) {
+        size = max(floor(size * 0.5f), vec2(1.0f));
+        // Clamped half a texel in so the filter never reaches past the written region
+        vec2 texel = clamp(inUV * size, vec2(0.5f), size - 0.5f);
+        bloom += textureLod(bloomImage, texel / vec2(textureSize(bloomImage, int(level))), float(level)).rgb;
+    }
+    return bloom / float(max(PushConstants.bloomLevels, 1));
+}
+
+void main() {
+    // The draw image is only filled up to the draw extent, the scale stretches that region over the swapchain
+    vec3 color = texture(drawImage, inUV * PushConstants.uvScale).rgb;
+    if (PushConstants.bloomIntensity > 0.0f) {
+        color = mix(color, sample_bloom(), PushConstants.bloomIntensity);
+    }
+    color *= PushConstants.exposure;
+
+    if (PushConstants.tonemapper == TONEMAP_REINHARD) {
+        color = color / (1.0f + color);
+    } else if (PushConstants.tonemapper == TONEMAP_ACES) {
+        color = aces(color);
+    }
+
+    outFragColor = vec4(clamp(color, 0.0f, 1.0f), 1.0f);
+}
@@ -0,0 +1,5 @@
+// Format qualifier of the draw image. The engine picks the format at runtime, so every shader writing
+// the draw image is also compiled with DRAW_IMAGE_FORMAT=r11f_g11f_b10f (see DRAW_FORMAT_SHADERS in CMake)
+#ifndef DRAW_IMAGE_FORMAT
+#define DRAW_IMAGE_FORMAT rgba16f
+#endif
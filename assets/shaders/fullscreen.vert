@@ -0,0 +1,9 @@
+#version 460
+
+layout (location = 0) out vec2 outUV;
+
+void main() {
+    // One triangle covering the screen, uv runs 0..1 over the visible part
+    outUV = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(outUV * 2.0f - 1.0f, 0.0f, 1.0f);
+}
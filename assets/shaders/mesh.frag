@@ -0,0 +1,57 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "scene_data.glsl"
+
+layout(push_constant) uniform constants {
+    SceneBuffer scene;
+    ObjectBuffer objectBuffer;
+    InstanceBuffer instanceBuffer;
+    VertexBuffer vertexBuffer;
+} PushConstants;
+
+layout(set = 0, binding = 0) uniform sampler2DArrayShadow shadowMap;
+
+layout (location = 0) in vec3 inColor;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec3 inWorldPosition;
+
+layout (location = 0) out vec4 outFragColor;
+
+#define SHADOW_CASCADE_COUNT 4
+
+// 3x3 comparisons, each one bilinearly filtered by the comparison sampler
+float get_shadow(vec3 normal) {
+    SceneBuffer scene = PushConstants.scene;
+    float viewDistance = -(scene.view * vec4(inWorldPosition, 1.0f)).z;
+    uint cascade = 0;
+    while (cascade < SHADOW_CASCADE_COUNT && viewDistance > scene.shadowSplits[cascade]) {
+        cascade++;
+    }
+    if (cascade == SHADOW_CASCADE_COUNT) {
+        return 1.0f;
+    }
+
+    // Offsetting along the normal by about a texel keeps surfaces from shadowing themselves
+    vec3 position = inWorldPosition + normal * scene.shadowTexelSizes[cascade] * 1.5f;
+    vec4 shadowPosition = scene.shadowViewProj[cascade] * vec4(position, 1.0f);
+    vec2 uv = shadowPosition.xy * 0.5f + 0.5f;
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0f;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            lit += texture(shadowMap, vec4(uv + vec2(x, y) * texelSize, float(cascade), shadowPosition.z));
+        }
+    }
+    return lit / 9.0f;
+}
+
+void main() {
+    vec3 normal = normalize(inNormal);
+    vec4 lightDirection = PushConstants.scene.lightDirection;
+    float light = max(dot(normal, lightDirection.xyz), 0.0f);
+    if (lightDirection.w > 0.0f && light > 0.0f) {
+        light *= get_shadow(normal);
+    }
+    outFragColor = vec4(inColor * (0.25f + 0.75f * light), 1.0f);
+}
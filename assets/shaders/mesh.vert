@@ -0,0 +1,31 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "scene_data.glsl"
+
+layout(push_constant) uniform constants {
+    SceneBuffer scene;
+    ObjectBuffer objectBuffer;
+    InstanceBuffer instanceBuffer;
+    VertexBuffer vertexBuffer;
+} PushConstants;
+
+layout (location = 0) out vec3 outColor;
+layout (location = 1) out vec3 outNormal;
+layout (location = 2) out vec3 outWorldPosition;
+
+//! The depth pre-pass and the main pass must produce bit-identical depth for VK_COMPARE_OP_EQUAL
+invariant gl_Position;
+
+void main() {
+    uint objectIndex = PushConstants.instanceBuffer.objectIndices[gl_InstanceIndex];
+    ObjectData object = PushConstants.objectBuffer.objects[objectIndex];
+    Vertex vertex = unpack_vertex(PushConstants.vertexBuffer.vertices[gl_VertexIndex]);
+
+    vec4 worldPosition = object.model * vec4(vertex.position, 1.0f);
+
+    gl_Position = PushConstants.scene.viewProj * worldPosition;
+    outColor = object.color.rgb;
+    outNormal = mat3(object.model) * vertex.normal;
+    outWorldPosition = worldPosition.xyz;
+}
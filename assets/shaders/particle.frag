@@ -0,0 +1,19 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "particles.glsl"
+
+layout (location = 0) in vec4 inColor;
+layout (location = 1) in vec2 inCorner;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() {
+    float falloff = 1.0f - dot(inCorner, inCorner);
+    if (falloff <= 0.0f) {
+        discard;
+    }
+    // Premultiplied alpha, an alpha of 0 turns the blend additive when the particles aren't sorted
+    float alpha = inColor.a * falloff;
+    outFragColor = vec4(inColor.rgb * alpha, PushConstants.params.sorted != 0 ? alpha : 0.0f);
+}
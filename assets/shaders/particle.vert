@@ -0,0 +1,33 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "particles.glsl"
+
+layout (location = 0) out vec4 outColor;
+layout (location = 1) out vec2 outCorner;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(-1.0f, -1.0f), vec2(1.0f, -1.0f), vec2(1.0f, 1.0f),
+    vec2(-1.0f, -1.0f), vec2(1.0f, 1.0f), vec2(-1.0f, 1.0f)
+);
+
+void main() {
+    ParticleParamsBuffer params = PushConstants.params;
+    // Instances are the sorted survivors, the draw's instance count is the alive count
+    uint index = params.aliveListOut.indices[gl_InstanceIndex];
+    Particle particle = params.particles.particles[index];
+
+    float t = clamp(particle.age / particle.lifetime, 0.0f, 1.0f);
+    float size = params.size * mix(1.0f, 0.4f, t);
+
+    // Camera facing quad, the view matrix rows are the camera's right and up axes
+    mat4 view = params.scene.view;
+    vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+    vec2 corner = CORNERS[gl_VertexIndex];
+    vec3 position = particle.position + (right * corner.x + up * corner.y) * size;
+
+    gl_Position = params.scene.viewProj * vec4(position, 1.0f);
+    outColor = mix(params.startColor, params.endColor, t);
+    outCorner = corner;
+}
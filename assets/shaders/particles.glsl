@@ -0,0 +1,93 @@
+#include "scene_data.glsl"
+
+#define PARTICLE_GROUP_SIZE 64
+#define PARTICLE_SORT_GROUP_ELEMENTS 1024
+
+#define PARTICLE_STAGE_BEGIN 0
+#define PARTICLE_STAGE_END 1
+
+#define PARTICLE_SORT_LOCAL 0
+#define PARTICLE_SORT_GLOBAL_STEP 1
+#define PARTICLE_SORT_LOCAL_MERGE 2
+
+struct Particle {
+    vec3 position;
+    float age;
+    vec3 velocity;
+    float lifetime;
+};
+
+layout(buffer_reference, std430) buffer ParticleBuffer {
+    Particle particles[];
+};
+
+layout(buffer_reference, std430) buffer IndexListBuffer {
+    uint indices[];
+};
+
+layout(buffer_reference, std430) buffer SortKeyBuffer {
+    float keys[];
+};
+
+// Matches GPUParticleCounters, the indirect arguments are spelled out so nothing gets vec3 alignment
+layout(buffer_reference, std430) buffer ParticleCounterBuffer {
+    uint emitArgs[3];
+    uint simulateArgs[3];
+    uint sortArgs[3];
+    uint drawVertexCount;
+    uint drawInstanceCount;
+    uint drawFirstVertex;
+    uint drawFirstInstance;
+    uint aliveCount[2];
+    uint deadCount;
+    uint emitCount;
+    uint sortSize;
+};
+
+layout(buffer_reference, std430) readonly buffer ParticleParamsBuffer {
+    vec4 emitterPosition;
+    vec4 emitterVelocity;
+    vec4 startColor;
+    vec4 endColor;
+    SceneBuffer scene;
+    ParticleBuffer particles;
+    IndexListBuffer aliveListIn;
+    IndexListBuffer aliveListOut;
+    IndexListBuffer deadList;
+    SortKeyBuffer sortKeys;
+    ParticleCounterBuffer counters;
+    float deltaTime;
+    float gravity;
+    float drag;
+    float size;
+    float lifetime;
+    uint emitRequest;
+    uint seed;
+    uint aliveIn;
+    uint sorted;
+};
+
+layout(push_constant) uniform constants {
+    ParticleParamsBuffer params;
+    uint stage;
+    uint sortBlock;
+    uint sortStride;
+} PushConstants;
+
+// PCG hash, one random number per call
+uint pcg_hash(inout uint state) {
+    state = state * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random_float(inout uint state) {
+    return float(pcg_hash(state)) * (1.0f / 4294967296.0f);
+}
+
+vec3 random_in_sphere(inout uint state) {
+    float z = random_float(state) * 2.0f - 1.0f;
+    float angle = random_float(state) * 6.28318531f;
+    float radius = pow(random_float(state), 1.0f / 3.0f);
+    return radius * vec3(sqrt(1.0f - z * z) * vec2(cos(angle), sin(angle)), z);
+}
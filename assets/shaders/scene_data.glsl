@@ -0,0 +1,107 @@
+#extension GL_EXT_buffer_reference : require
+
+struct ObjectData {
+    mat4 model;
+    vec4 sphereBounds;
+    vec4 color;
+};
+
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+struct DrawCandidate {
+    uint objectIndex;
+    uint batchIndex;
+};
+
+// Matches PackedVertex, decoded by unpack_vertex
+struct PackedVertex {
+    uint positionXY;
+    uint positionZW;
+    uint normal;
+    uint tangent;
+    uint uv;
+};
+
+struct Vertex {
+    vec3 position;  // in the mesh's quantization cube, the model matrix maps it back
+    vec3 normal;
+    vec4 tangent;
+    vec2 uv;
+};
+
+layout(buffer_reference, std430) readonly buffer SceneBuffer {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 prevView;
+    mat4 prevProj;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+    vec4 viewportSize;
+    uvec4 pyramidInfo;
+    mat4 invViewProj;
+    mat4 prevViewProjNoJitter;
+    vec4 jitter;
+    mat4 shadowViewProj[4];
+    vec4 shadowSplits;
+    vec4 shadowTexelSizes;
+    vec4 lightDirection;
+};
+
+layout(buffer_reference, std430) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+// Object index of every drawn instance, written by culling and indexed with gl_InstanceIndex
+layout(buffer_reference, std430) readonly buffer InstanceBuffer {
+    uint objectIndices[];
+};
+
+layout(buffer_reference, std430) readonly buffer VertexBuffer {
+    PackedVertex vertices[];
+};
+
+vec3 unpack_octahedral(uint packed) {
+    vec2 encoded = unpackSnorm2x16(packed);
+    vec3 v = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    // Unfolds the lower half
+    float t = max(-v.z, 0.0f);
+    v.xy += vec2(v.x >= 0.0f ? -t : t, v.y >= 0.0f ? -t : t);
+    return normalize(v);
+}
+
+Vertex unpack_vertex(PackedVertex packed) {
+    vec2 zw = unpackSnorm2x16(packed.positionZW);
+    Vertex vertex;
+    vertex.position = vec3(unpackSnorm2x16(packed.positionXY), zw.x);
+    vertex.normal = unpack_octahedral(packed.normal);
+    vertex.tangent = vec4(unpack_octahedral(packed.tangent), zw.y);
+    vertex.uv = unpackHalf2x16(packed.uv);
+    return vertex;
+}
+
+// Inverse of unpack_octahedral, matches pack_octahedral in meshes.cpp
+uint pack_octahedral(vec3 v) {
+    v /= abs(v.x) + abs(v.y) + abs(v.z);
+    vec2 encoded = v.xy;
+    if (v.z < 0.0f) {
+        encoded = (1.0f - abs(v.yx)) * vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return packSnorm2x16(encoded);
+}
+
+PackedVertex pack_vertex(Vertex vertex) {
+    PackedVertex packed;
+    packed.positionXY = packSnorm2x16(vertex.position.xy);
+    packed.positionZW = packSnorm2x16(vec2(vertex.position.z, vertex.tangent.w));
+    packed.normal = pack_octahedral(vertex.normal);
+    packed.tangent = pack_octahedral(vertex.tangent.xyz);
+    packed.uv = packHalf2x16(vertex.uv);
+    return packed;
+}
@@ -0,0 +1,17 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "scene_data.glsl"
+
+layout(push_constant) uniform constants {
+    mat4 viewProj;
+    ObjectBuffer objectBuffer;
+    VertexBuffer vertexBuffer;
+} PushConstants;
+
+// Casters aren't culled on the GPU, every draw has a single instance whose firstInstance is the object index
+void main() {
+    ObjectData object = PushConstants.objectBuffer.objects[gl_InstanceIndex];
+    Vertex vertex = unpack_vertex(PushConstants.vertexBuffer.vertices[gl_VertexIndex]);
+    gl_Position = PushConstants.viewProj * object.model * vec4(vertex.position, 1.0f);
+}
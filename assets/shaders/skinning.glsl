@@ -0,0 +1,65 @@
+#include "scene_data.glsl"
+
+#define SKINNING_GROUP_SIZE 64
+#define NO_PARENT_JOINT 0xFFFFFFFFu
+
+#define JOINT_ROTATION_X 0
+#define JOINT_TRANSLATION_X 4
+#define JOINT_CHANNEL_COUNT 7
+
+struct SkeletonJoint {
+    mat4 inverseBind;
+    uint parent;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+// Rows of a joint's model space transform times its inverse bind matrix
+struct SkinMatrix {
+    vec4 rows[3];
+};
+
+struct SkinInfluence {
+    uint joints;   // 4 x 8 bit
+    uint weights;  // 4 x unorm8
+};
+
+// Same memory as VertexBuffer, the skinned ranges are written here
+layout(buffer_reference, std430) writeonly buffer SkinnedVertexBuffer {
+    PackedVertex vertices[];
+};
+
+// Per instance JOINT_CHANNEL_COUNT arrays of jointStride floats, see JointChannel in skinning.hpp
+layout(buffer_reference, std430) readonly buffer JointPoseBuffer {
+    float values[];
+};
+
+layout(buffer_reference, std430) readonly buffer SkeletonBuffer {
+    SkeletonJoint joints[];
+};
+
+layout(buffer_reference, std430) buffer SkinMatrixBuffer {
+    SkinMatrix matrices[];
+};
+
+layout(buffer_reference, std430) readonly buffer SkinInfluenceBuffer {
+    SkinInfluence influences[];
+};
+
+layout(push_constant) uniform constants {
+    vec4 sourceQuantization;
+    vec4 outputQuantization;
+    VertexBuffer sourceVertices;
+    SkinnedVertexBuffer outputVertices;
+    JointPoseBuffer jointPoses;
+    SkeletonBuffer skeleton;
+    SkinMatrixBuffer skinMatrices;
+    SkinInfluenceBuffer influences;
+    uint sourceVertexOffset;
+    uint outputVertexOffset;
+    uint vertexCount;
+    uint jointCount;
+    uint jointStride;
+    uint instanceCount;
+} PushConstants;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <types.hpp>
+#include <scene.hpp>
+#include <job_system.hpp>
+
+namespace bluevk {
+    //! Packed sort key, most significant first: pipeline (20 bits) | descriptor set (20 bits) | mesh (24 bits).
+    //! Sorting by it groups requests by the state they need, equal keys are merged into one instanced batch.
+    using DrawKey = uint64_t;
+
+    //! Descriptor set id 0 is reserved for draws that don't bind one
+    constexpr uint32_t NO_DESCRIPTOR_SET = 0;
+
+    DrawKey pack_draw_key(uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh);
+
+    struct DrawBatch {
+        uint32_t pipeline;
+        uint32_t descriptorSet;
+        uint32_t mesh;
+        uint32_t firstInstance;
+        uint32_t maxInstanceCount;  // every request in the batch, culling decides how many are drawn
+    };
+
+    //! Collects draw requests every frame and turns them into instanced batches.
+    //! Every request gets an instance slot in its batch's range, the per-instance data is read by
+    //! the vertex shader from a storage buffer indexed with gl_InstanceIndex.
+    class DrawList {
+       public:
+        void clear();
+        void add(uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, uint32_t objectIndex);
+        //! resize() followed by set() lets several jobs fill the list at once
+        void resize(uint32_t count);
+        void set(uint32_t index, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, uint32_t objectIndex);
+        void build();
+        //! Sorts one chunk per active thread and merges them pairwise, small lists are sorted in place
+        void build(JobSystem &jobs);
+
+        const std::vector<DrawBatch> &get_batches() const { return _batches; }
+        //! One per request, in batch order
+        const std::vector<GPUDrawCandidate> &get_candidates() const { return _candidates; }
+
+       private:
+        struct DrawRequest {
+            DrawKey key;
+            uint32_t objectIndex;
+        };
+
+        std::vector<DrawRequest> _requests{};
+        std::vector<DrawBatch> _batches{};
+        std::vector<GPUDrawCandidate> _candidates{};
+
+        static bool request_less(const DrawRequest &a, const DrawRequest &b);
+        void build_batches();
+    };
+}  // namespace bluevk
@@ -1,12 +1,49 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <VkBootstrap.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
 
 #include <types.hpp>
+#include <scene.hpp>
+#include <meshes.hpp>
+#include <mesh_lod.hpp>
+#include <particles.hpp>
+#include <skinning.hpp>
+#include <draw_list.hpp>
+#include <imgui_snapshot.hpp>
+#include <job_system.hpp>
+#include <init_graph.hpp>
 #include <vk_builders.hpp>
+#include <vk_command_cache.hpp>
 #include <vk_pipelines.hpp>
+#include <vk_memory.hpp>
+#include <vk_profiler.hpp>
+#include <vk_readback.hpp>
+#include <vk_textures.hpp>
+#include <vk_downsampler.hpp>
 
 constexpr uint32_t FRAME_OVERLAP = 2;
+//! Readbacks that can be in flight at once, captures keep theirs until the file is written
+constexpr uint32_t READBACK_SLOTS = 8;
+//! Fewer batches than this aren't worth another secondary command buffer
+constexpr uint32_t MIN_BATCHES_PER_SECONDARY = 64;
+//! The frame limiter yields instead of sleeping for the last part of the wait
+constexpr uint32_t FRAME_LIMIT_SPIN_MS = 2;
+//! Levels of the bloom chain, the first one is half the window
+constexpr uint32_t BLOOM_MIP_COUNT = 6;
+
+//! Static effects only depend on their push constants and the extent, their output is rendered once
+//! and copied in every frame. Time dependent ones are dispatched every frame.
+enum EffectUpdate : uint8_t {
+    EFFECT_STATIC,
+    EFFECT_TIME_DEPENDENT,
+};
 
 struct ComputeEffect {
     struct ComputePushConstants {
@@ -21,13 +58,49 @@ struct ComputeEffect {
     VkPipelineLayout layout;
     VkPipeline pipeline;
     ComputePushConstants data;
+    EffectUpdate update{EFFECT_STATIC};
 };
 
 namespace bluevk {
+    enum DrawFormatPolicy : uint8_t {
+        DRAW_FORMAT_PACKED,          // B10G11R11 (4 bytes) when the device can store, render and blit it
+        DRAW_FORMAT_HIGH_PRECISION,  // always R16G16B16A16 (8 bytes)
+    };
+
+    enum ValidationLevel : uint8_t {
+        VALIDATION_NONE,             // no layers and no debug messenger
+        VALIDATION_STANDARD,         // Khronos validation layer with the default messenger
+        VALIDATION_SYNCHRONIZATION,  // standard plus synchronization validation, several times slower
+    };
+
     struct BlueVKEngineParams {
         VkExtent2D windowSize = {1700, 1000};
         std::string windowTitle = "BlueVK Engine";
         bool isResizable = true;
+        uint32_t sceneObjectsPerAxis = 32;
+        uint32_t sceneLayerCount = 16;
+        DrawFormatPolicy drawFormatPolicy = DRAW_FORMAT_PACKED;
+        std::vector<std::string> texturePaths{};
+        uint32_t jobWorkerCount = 0;  // 0 = hardware concurrency - 1
+        VkDeviceSize textureUploadBudget = 16 * 1024 * 1024;
+        //! Ignored by builds without BLUEVK_DEBUG_TOOLS, those carry no validation or debug utils code at all
+        ValidationLevel validationLevel = BLUEVK_DEBUG_TOOLS ? VALIDATION_STANDARD : VALIDATION_NONE;
+        bool debugLabels = BLUEVK_DEBUG_TOOLS;  // profiler scopes show up as labels in captures
+        //! Falls back to FIFO when the surface doesn't support it, both can be changed at runtime
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        uint32_t swapchainImageCount = 3;
+        //! Presents that may be queued before the next frame samples input, needs VK_KHR_present_wait
+        uint32_t maxQueuedPresents = 1;
+        uint32_t maxFrames = 0;  // exits after this many frames, 0 = run until closed
+        float frameRateLimit = 0.0f;  // 0 = uncapped, presentation still paces the frame
+        //! An unfocused window only draws on events, on pending work and at this rate, 0 = on events only.
+        //! With a rate the thread sleeps until the next idle frame, events wait for it.
+        float idleFrameRate = 0.0f;
+        bool idleWhenUnfocused = true;
+        //! Records and presents on its own thread, simulation and UI of the next frame overlap it
+        bool renderThread = true;
+        uint32_t maxParticles = 1u << 20;  // GPU particle pool, 0 = no particles
+        uint32_t animatedInstances = 128;  // compute skinned characters, 0 = none
     };
 
     class BlueVKEngine {
@@ -43,16 +116,100 @@ namespace bluevk {
 
        private:
         struct DeletionQueue {
+            std::mutex mutex;  // pipelines are created on jobs
             std::deque<std::function<void()>> deletors;
             void push_back(std::function<void()> &&function);
             void flush();
         };
+        //! Command pools aren't thread safe, every job thread records into its own pool per frame
+        struct ThreadCommandPool {
+            VkCommandPool pool;
+            std::vector<VkCommandBuffer> secondaryBuffers{};
+            uint32_t usedSecondaryBuffers{0};
+        };
+        struct DrawStats {
+            uint32_t drawCalls{0};
+            uint32_t pipelineBinds{0};
+        };
         struct FrameData {
             VkCommandPool _commandPool;
             VkCommandBuffer _mainCommandBuffer;
+            std::vector<ThreadCommandPool> _threadCommandPools;
+            CommandCache _scenePassCommands[2];  // depth pre-pass, geometry
+            DrawStats _scenePassStats[2];
             VkFence _renderFence;
             VkSemaphore _swapchainSemaphore;
             VkSemaphore _renderSemaphore;
+            BlueVKBuffer _sceneDataBuffer;
+            BlueVKBuffer _drawCommandBuffer;
+            BlueVKBuffer _drawCandidateBuffer;
+            BlueVKBuffer _visibleInstanceBuffer;
+            BlueVKBuffer _cullStatsBuffer;
+            BlueVKBuffer _particleParamsBuffer;
+            BlueVKBuffer _jointPoseBuffer;
+            BlueVKBuffer _shadowCommandBuffer;
+        };
+        struct DrawPipeline {
+            VkPipeline pipeline;
+            VkPipeline depthEqualPipeline;  // main pass after a depth pre-pass
+            VkPipeline depthOnlyPipeline;
+        };
+        //! What the main thread's simulation and UI decide for a frame, the render thread applies a copy of it
+        struct FrameState {
+            Camera camera;
+            float renderScale;
+            bool temporalUpscale;
+            bool compositePresent;
+            float exposure;
+            int tonemapper;
+            bool bloom;
+            float bloomIntensity;
+            int computeEffect;
+            bool cacheBackground;
+            std::vector<ComputeEffect::ComputePushConstants> effectData;
+            bool depthPrepass;
+            bool occlusionCulling;
+            bool meshLods;
+            float lodErrorPixels;
+            bool particles;
+            bool particleSorting;
+            float particleEmitRate;
+            float particleLifetime;
+            bool animate;
+            bool shadows;
+            bool cacheShadows;
+            float lightYaw;
+            float lightPitch;
+            bool parallelRecording;
+            bool cacheCommands;
+            VkPresentModeKHR presentMode;
+            uint32_t swapchainImageCount;
+            uint32_t maxQueuedPresents;
+        };
+        //! Handed from the main thread to the render thread, one is filled while the other is drawn
+        struct FramePacket {
+            bool exit{false};
+            FrameState state;
+            std::chrono::high_resolution_clock::time_point inputTime{};
+            float deltaTime{0.0f};
+            VkExtent2D windowExtent{};
+            //! Scene changes and one shot requests, run on the render thread before the frame is drawn
+            std::vector<std::function<void()>> commands{};
+            ImGuiSnapshot imgui{};
+        };
+        //! What the UI shows about the render thread, published after every frame under _statusMutex
+        struct RenderStatus {
+            VkPresentModeKHR presentMode{VK_PRESENT_MODE_FIFO_KHR};
+            std::vector<VkPresentModeKHR> supportedPresentModes{};
+            uint32_t swapchainImages{0};
+            double inputToPresentCall{0.0};
+            double inputToPresented{0.0};
+            uint32_t drawBatches{0};
+            uint32_t captureFramesLeft{0};
+            bool pickValid{false};
+            float pickDepth{0.0f};
+            glm::vec3 pickWorldPosition{0.0f};
+            std::vector<double> jobScaling{};
         };
 
         static BlueVKEngine *Engine;
@@ -61,13 +218,45 @@ namespace bluevk {
         VkExtent2D _windowSize;
         std::string _windowTitle;
         bool _isResizable;
-        bool _freezRendering{false};
+        bool _quitRequested{false};
+        bool _windowFocused{true};
+        bool _idleWhenUnfocused;
+        float _idleFrameRate;
+        float _frameRateLimit;
+        std::chrono::high_resolution_clock::time_point _lastFrameStart{};
+        std::chrono::high_resolution_clock::time_point _nextFrameTime{};
+        //! Main thread side of the frame packets, the UI edits _frameState and reads _status
+        FrameState _frameState{};
+        RenderStatus _status{};
+        std::vector<std::function<void()>> _renderCommands{};
+        bool _renderThreadEnabled;
+        std::thread _renderThread;
+        //! Packet n is in _packets[n % 2]. The main thread may fill a packet once the render thread released
+        //! the one drawn two frames before it, the counters are the only thing both threads touch.
+        FramePacket _packets[2];
+        std::atomic<uint64_t> _packetsWritten{0};
+        std::atomic<uint64_t> _packetsRead{0};
+        std::atomic<bool> _renderThreadExited{false};
+        std::exception_ptr _renderError{};
+        //! Guards _publishedStatus and the texture cache and memory tracker, their windows read render state
+        std::mutex _statusMutex;
+        RenderStatus _publishedStatus{};
+        VkExtent2D _windowExtent{};  // last window size the main thread saw, SFML is only queried there
+        ImDrawData *_imguiDrawData{nullptr};
         bool _resizeRequested{false};
         float _renderScale{1.0f};
         sf::RenderWindow _window;
+        ValidationLevel _validationLevel;
+        bool _debugLabels;
+        vkb::Instance _vkbInstance;
         VkInstance _instance;
         VkDebugUtilsMessengerEXT _debugMessenger;
         VkPhysicalDevice _physicalDevice;
+        bool _textureCompressionBC{false};
+        bool _memoryBudgetExtension{false};
+        bool _presentWait{false};
+        bool _storageImageExtendedFormats{false};
+        bool _downsampleSupported{false};  // subgroup quad operations and dynamically indexed storage images
         VkDevice _device;
         VkSurfaceKHR _surface;
         VkQueue _graphicsQueue;
@@ -78,8 +267,24 @@ namespace bluevk {
         std::vector<VkImage> _swapchainImages;
         std::vector<VkImageView> _swapchainImageViews;
         VkExtent2D _swapchainExtent;
+        VkPresentModeKHR _presentMode;
+        VkPresentModeKHR _requestedPresentMode;
+        std::vector<VkPresentModeKHR> _supportedPresentModes{};
+        uint32_t _swapchainImageCount;
+        uint32_t _maxQueuedPresents;
+        uint32_t _maxFrames;
+        //! Present ids only grow, waits skip ids that belong to an old swapchain
+        uint64_t _presentId{0};
+        uint64_t _swapchainFirstPresentId{1};
+        uint64_t _lastMeasuredPresentId{0};
+        std::chrono::high_resolution_clock::time_point _frameInputTime{};
+        std::array<std::chrono::high_resolution_clock::time_point, 16> _presentInputTimes{};
+        double _inputToPresentCall{0.0};
+        double _inputToPresented{0.0};
         FrameData _frames[FRAME_OVERLAP];
-        size_t _frameNumber;
+        size_t _frameNumber{0};
+        DrawFormatPolicy _drawFormatPolicy;
+        VkFormat _drawFormat{VK_FORMAT_R16G16B16A16_SFLOAT};
         BlueVKImage _drawImage;
         VkExtent2D _drawExtent;
         DescriptorSetAllocator _mainDescriptorAllocator;
@@ -91,36 +296,270 @@ namespace bluevk {
         VkDescriptorSet _drawImageDescriptorSet;
         std::vector<ComputeEffect> _computeEffects{};
         int _currentComputeEffect{0};
+        bool _cacheBackground{true};
+        BlueVKImage _backgroundImage;
+        VkDescriptorSet _backgroundDescriptorSet;
+        uint64_t _backgroundKey{0};
+        bool _backgroundValid{false};
         VkPipelineLayout _triangleLayout;
         VkPipeline _trianglePipeline;
 
+        bool _compositePresent{true};  // fullscreen pass into the swapchain instead of blit + ImGui pass
+        float _exposure{1.0f};
+        int _tonemapper{TONEMAP_NONE};
+        //! Every level of the bloom chain is built from the composited image by one downsampler dispatch
+        bool _bloom{true};
+        float _bloomIntensity{0.05f};
+        BlueVKImage _bloomImage;
+        bool _bloomValid{false};  // in SHADER_READ_ONLY_OPTIMAL, sampled by the composite pass even with bloom off
+        Downsampler _downsampler;
+        VkSampler _compositeSampler;
+        VkDescriptorSetLayout _compositeDescriptorLayout;
+        VkDescriptorSet _compositeDescriptorSet;
+        VkPipelineLayout _compositeLayout;
+        VkPipeline _compositePipeline;
+        VkDescriptorSet _compositeHistoryDescriptorSets[2];
+
+        //! Reconstructs the swapchain resolution from the scaled draw extent with jittered frames and a history
+        bool _temporalUpscale{true};
+        BlueVKImage _historyImages[2];
+        uint32_t _historyIndex{0};  // written this frame, the other one holds last frame's result
+        bool _historyValid{false};
+        uint32_t _jitterIndex{0};
+        glm::vec2 _jitter{0.0f};
+        glm::mat4 _prevViewProjNoJitter{1.0f};
+        VkDescriptorSetLayout _upscaleDescriptorLayout;
+        VkDescriptorSet _upscaleDescriptorSets[2];
+        VkPipelineLayout _upscaleLayout;
+        VkPipeline _upscalePipeline;
+
+        JobSystem _jobs;
+        uint32_t _jobWorkerCount;
+        std::vector<double> _jobScaling{};  // draw list build time in ms per active thread count
+        std::chrono::high_resolution_clock::time_point _startupStart{};
+        bool _parallelRecording{true};
+        bool _cacheCommands{true};
+        Profiler _profiler;
+        MemoryTracker _memoryTracker;
+        TextureCache _textureCache;
+        ReadbackQueue _readback;
+        std::string _captureDirectory{"captures"};
+        int _captureFrameCount{60};
+        uint32_t _captureFramesLeft{0};
+        bool _pickRequested{false};
+        sf::Vector2i _pickPosition{};
+        bool _pickValid{false};
+        float _pickDepth{0.0f};
+        glm::vec3 _pickWorldPosition{0.0f};
+        std::vector<std::string> _texturePaths;
+        VkDeviceSize _textureUploadBudget;
+        Camera _camera;
+        bool _autoOrbit{true};
+        bool _depthPrepass{false};
+        bool _occlusionCulling{true};
+        bool _meshLods{true};
+        float _lodErrorPixels{1.0f};  // screen space error a LOD may cause
+        uint32_t _sceneObjectsPerAxis;
+        uint32_t _sceneLayerCount;
+        uint32_t _objectCount{0};
+        std::vector<SceneObject> _sceneObjects{};
+        BlueVKBuffer _objectBuffer;
+        std::vector<MeshInfo> _meshes{};
+        std::vector<MeshLodChain> _meshLodChains{};  // indexed by SceneObject::mesh
+        BlueVKBuffer _vertexBuffer;
+        BlueVKBuffer _indexBuffer;
+        DrawList _drawList;
+        std::vector<DrawPipeline> _drawPipelines{};
+        std::vector<VkDescriptorSet> _drawDescriptorSets{VK_NULL_HANDLE};  // indexed by the draw key, 0 = none
+        uint32_t _meshDrawPipeline{0};
+        glm::mat4 _prevView{1.0f};
+        float _frameDeltaTime{0.0f};
+        glm::mat4 _prevProj{1.0f};
+
+        BlueVKImage _depthImage;
+        BlueVKImage _depthPyramid;
+        std::vector<VkImageView> _depthPyramidMips;
+        VkExtent2D _depthPyramidExtent{1, 1};
+        bool _depthPyramidValid{false};
+        VkSampler _depthPyramidSampler;
+        VkDescriptorSetLayout _depthReduceDescriptorLayout;
+        std::vector<VkDescriptorSet> _depthReduceDescriptorSets;
+        VkDescriptorSetLayout _cullDescriptorLayout;
+        VkDescriptorSet _cullDescriptorSet;
+        VkPipelineLayout _depthReduceLayout;
+        VkPipeline _depthReducePipeline;
+        VkPipelineLayout _cullLayout;
+        VkPipeline _cullPipeline;
+        VkPipelineLayout _meshLayout;
+
+        //! GPU particles, see particles.hpp. Nothing about them is read back, the CPU only knows the request
+        uint32_t _maxParticles;
+        uint32_t _particleSortCapacity{0};
+        bool _particles{true};
+        bool _particleSorting{true};  // back to front with alpha blending, additive in any order otherwise
+        float _particleEmitRate{250000.0f};  // per second
+        float _particleLifetime{5.0f};
+        float _particleEmitAccumulator{0.0f};
+        uint32_t _particleFrame{0};  // its parity picks the alive list survivors are read from
+        BlueVKBuffer _particleBuffer;
+        BlueVKBuffer _particleAliveBuffers[2];
+        BlueVKBuffer _particleDeadBuffer;
+        BlueVKBuffer _particleSortKeyBuffer;
+        BlueVKBuffer _particleCounterBuffer;
+        VkPipelineLayout _particleLayout;
+        VkPipeline _particleCountersPipeline;
+        VkPipeline _particleEmitPipeline;
+        VkPipeline _particleSimulatePipeline;
+        VkPipeline _particleSortPipeline;
+        VkPipeline _particleDrawPipeline;
+
+        //! Compute skinned instances, see skinning.hpp. Each one is a mesh of its own over its skinned range
+        uint32_t _animatedInstanceCount;
+        bool _animate{true};  // off freezes the clock, poses are still sampled and skinned
+        float _animationTime{0.0f};
+        Skeleton _skeleton{};
+        AnimationClip _animationClip{};
+        std::vector<glm::vec2> _animationPlayback{};  // per instance, x = time offset, y = speed
+        uint32_t _skinSourceVertexOffset{0};
+        uint32_t _skinOutputVertexOffset{0};
+        uint32_t _skinVertexCount{0};
+        glm::vec4 _skinSourceQuantization{0.0f};
+        glm::vec4 _skinOutputQuantization{0.0f};
+        BlueVKBuffer _skeletonBuffer;
+        BlueVKBuffer _skinInfluenceBuffer;
+        BlueVKBuffer _skinMatrixBuffer;
+        VkPipelineLayout _skinningLayout;
+        VkPipeline _skinJointsPipeline;
+        VkPipeline _skinVerticesPipeline;
+
+        //! Cascaded shadow maps. Static casters are cached per cascade and only drawn again when the
+        //! cascade's projection changes, every update copies the cache and draws the dynamic casters over it
+        bool _shadows{true};
+        bool _cacheShadows{true};  // off draws every cascade from scratch every frame
+        float _lightYaw{0.54f};
+        float _lightPitch{1.04f};
+        glm::vec3 _lightDirection{0.0f};  // towards the light
+        float _shadowDistance{150.0f};
+        glm::vec4 _shadowSceneBounds{0.0f};  // sphere around every caster
+        uint32_t _dynamicObjectOffset{0};  // objects from here on move every frame, see add_skinned_instances
+        VkFormat _shadowFormat{VK_FORMAT_D32_SFLOAT};
+        ShadowCascade _shadowCascades[SHADOW_CASCADE_COUNT]{};
+        //! What this frame records, written by update_shadow_cascades
+        bool _shadowStaticDirty[SHADOW_CASCADE_COUNT]{};
+        bool _shadowComposite[SHADOW_CASCADE_COUNT]{};
+        uint32_t _shadowStaticDraws[SHADOW_CASCADE_COUNT]{};
+        uint32_t _shadowDynamicDraws[SHADOW_CASCADE_COUNT]{};
+        BlueVKImage _shadowStaticImage;  // rests in DEPTH_ATTACHMENT_OPTIMAL
+        BlueVKImage _shadowImage;        // sampled, rests in DEPTH_READ_ONLY_OPTIMAL
+        VkImageView _shadowStaticLayerViews[SHADOW_CASCADE_COUNT];
+        VkImageView _shadowLayerViews[SHADOW_CASCADE_COUNT];
+        VkSampler _shadowSampler;
+        VkDescriptorSetLayout _shadowDescriptorLayout;
+        DescriptorSetAllocator _shadowDescriptorAllocator;  // not cleared with the draw image descriptors on resize
+        VkDescriptorSet _shadowDescriptorSet;
+        VkPipelineLayout _shadowLayout;
+        VkPipeline _shadowPipeline;
+
         BlueVKEngine(BlueVKEngineParams &params);
         ~BlueVKEngine();
 
-        void init_vulkan();
+        void init_jobs();
+        void init_window();
+        void init_instance();
+        void init_device();
         void init_swapchain();
         void init_commands();
         void init_sync_structures();
         void init_imgui();
         void init_descriptors();
-        void init_pipelines();
         void init_pipelines_gradient();
         void init_pipelines_triangle();
+        void init_pipelines_depth_reduce();
+        void init_pipelines_cull();
+        void init_pipelines_mesh();
+        void init_pipelines_composite();
+        void init_pipelines_upscale();
+        void init_pipelines_particles();
+        void init_pipelines_skinning();
+        void init_pipelines_shadows();
+        void init_profiler();
+        void init_scene();
+        void init_textures();
+        void init_memory();
+        void init_readback();
+        void init_particles();
+        void init_shadows();
 
         void draw();
         void draw_background(VkCommandBuffer cmd);
+        void dispatch_effect(VkCommandBuffer cmd, const ComputeEffect &effect, VkDescriptorSet target);
+        void draw_cull(VkCommandBuffer cmd);
+        void draw_depth_prepass(VkCommandBuffer cmd);
         void draw_geometry(VkCommandBuffer cmd);
+        void draw_scene_pass(VkCommandBuffer cmd, VkRenderingInfo &renderInfo, bool depthOnly);
+        uint64_t get_scene_pass_key(FrameData &frame, bool depthOnly, uint32_t chunkCount);
+        DrawStats draw_batches(VkCommandBuffer cmd, bool depthOnly, uint32_t firstBatch, uint32_t lastBatch);
+        void draw_depth_pyramid(VkCommandBuffer cmd);
+        void update_particles(VkCommandBuffer cmd);
+        void draw_skinning(VkCommandBuffer cmd);
+        void draw_shadows(VkCommandBuffer cmd);
+        void draw_particles(VkCommandBuffer cmd);
         void draw_imgui(VkCommandBuffer cmd, VkImageView view);
+        void draw_temporal_upscale(VkCommandBuffer cmd);
+        void draw_composite(VkCommandBuffer cmd, VkImageView view, VkExtent2D sourceExtent);
+        void draw_bloom(VkCommandBuffer cmd, VkExtent2D sourceExtent);
+        void report_present_traffic();
+
+        void select_formats();
+        std::string get_draw_format_shader(const char *shader) const;
+        void report_draw_target_traffic();
 
         void create_swapchain(VkExtent2D size);
         void create_draw_images();
+        BlueVKBuffer create_buffer(size_t size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+        BlueVKBuffer upload_buffer(const void *data, size_t size, VkBufferUsageFlags usage);
+
+        void update_draw_image_descriptors();
+        void update_scene_data(FrameData &frame);
+        void build_draw_list(FrameData &frame);
+        void fill_draw_list();
+        void add_skinned_instances(std::vector<PackedVertex> &vertices, std::vector<uint32_t> &indices);
+        void sample_animations(FrameData &frame);
+        void update_shadow_cascades(FrameData &frame);
+        void measure_job_scaling();
+        void benchmark_dispatch();
+        void report_first_frame();
+        void record_readbacks(VkCommandBuffer cmd);
+        void collect_cull_stats(FrameData &frame);
 
         void resize_swapchain();
+        void pace_frame();
+        void build_ui();
+        void start_render_thread();
+        void stop_render_thread();
+        FramePacket *acquire_packet();
+        void publish_packet();
+        void render_loop();
+        void render_frame(FramePacket &packet);
+        void apply_packet(FramePacket &packet);
+        void publish_status();
+        void handle_event(const sf::Event &event);
+        bool is_idle();
+        void wait_idle();
+        void limit_frame_rate();
 
         void destroy_swapchain();
         void destroy_draw_images();
+        void destroy_buffer(const BlueVKBuffer &buffer);
 
         FrameData &get_current_frame() { return _frames[_frameNumber % FRAME_OVERLAP]; }
+        //! The region of the full resolution images the upscaler fills
+        VkExtent2D get_upscale_extent() const {
+            return VkExtent2D{std::min(_swapchainExtent.width, _drawImage.extent.width),
+                              std::min(_swapchainExtent.height, _drawImage.extent.height)};
+        }
+
+        VkCommandBuffer begin_secondary_command_buffer(FrameData &frame, const VkCommandBufferInheritanceInfo &inheritance);
 
         void immediate_submit(std::function<void(VkCommandBuffer cmd)> &&function);
     };
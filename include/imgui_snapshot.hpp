@@ -0,0 +1,24 @@
+#pragma once
+
+#include <types.hpp>
+
+#include <imgui.h>
+
+namespace bluevk {
+    //! Deep copy of ImGui's draw data, the render thread draws it while the main thread builds the next frame.
+    //! The copied draw lists are kept between captures, their buffers only grow.
+    class ImGuiSnapshot {
+       public:
+        ImGuiSnapshot() = default;
+        ImGuiSnapshot(const ImGuiSnapshot &) = delete;
+        ImGuiSnapshot &operator=(const ImGuiSnapshot &) = delete;
+        ~ImGuiSnapshot();
+
+        void capture(const ImDrawData *source);
+        ImDrawData *get() { return &_drawData; }
+
+       private:
+        ImDrawData _drawData{};
+        std::vector<ImDrawList *> _lists{};
+    };
+}  // namespace bluevk
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <types.hpp>
+#include <job_system.hpp>
+
+#include <chrono>
+
+namespace bluevk {
+    //! Startup work as a dependency graph. Steps run on the job system as soon as everything they depend on
+    //! has finished, steps that touch the window run on the thread that calls run(). Every step records when
+    //! and where it ran, the timeline is printed once the graph is done.
+    class InitGraph {
+       public:
+        using StepId = uint32_t;
+
+        //! Dependencies have to be added before the steps that use them
+        StepId add(const char *name, std::function<void()> &&function, std::vector<StepId> dependencies = {});
+        StepId add_main_thread(const char *name, std::function<void()> &&function, std::vector<StepId> dependencies = {});
+        //! Rethrows the first exception a step threw, steps depending on a failed step are skipped
+        void run(JobSystem &jobs);
+
+        //! Milliseconds from run() to the end of the last step
+        double get_duration() const { return _duration; }
+        //! Milliseconds the steps would have taken back to back
+        double get_serial_duration() const;
+        void print_timeline() const;
+
+       private:
+        struct Step {
+            std::string name;
+            std::function<void()> function;
+            std::vector<StepId> dependencies;
+            bool mainThread;
+            double start{0.0};
+            double end{0.0};
+            uint32_t threadIndex{0};
+        };
+
+        std::vector<Step> _steps{};
+        double _duration{0.0};
+    };
+}  // namespace bluevk
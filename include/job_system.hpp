@@ -0,0 +1,89 @@
+#pragma once
+
+#include <types.hpp>
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace bluevk {
+    //! Counts unfinished jobs. Jobs scheduled with a counter as their dependency start once it reaches zero.
+    class JobCounter {
+       public:
+        bool is_done() const { return _value.load(std::memory_order_acquire) == 0; }
+
+       private:
+        friend class JobSystem;
+        struct DeferredJob {
+            std::function<void()> function;
+            JobCounter *counter;
+            bool background;
+        };
+
+        std::atomic<uint32_t> _value{0};
+        std::mutex _mutex;
+        std::vector<DeferredJob> _waiting{};
+    };
+
+    //! Work-stealing scheduler: every thread owns a deque, it pushes and pops its own jobs at the back
+    //! while idle threads steal from the front of the others. The main thread is thread 0 and runs
+    //! jobs while it waits on a counter. Background jobs (file IO, decoding) go to a shared queue that
+    //! only workers take, so a waiting main thread never picks up a long running job. Workers parked by
+    //! set_active_thread_count() still take background jobs, nothing else would run them.
+    class JobSystem {
+       public:
+        void init(uint32_t workerCount);
+        void shutdown();
+
+        void schedule(std::function<void()> &&job, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+        void schedule_background(std::function<void()> &&job, JobCounter *counter = nullptr);
+        //! Splits [0, count) into jobs of at most grainSize iterations
+        void parallel_for(uint32_t count,
+                          uint32_t grainSize,
+                          const std::function<void(uint32_t begin, uint32_t end)> &body,
+                          JobCounter *counter);
+        //! The calling thread runs jobs until the counter reaches zero
+        void wait(JobCounter &counter);
+        //! Keeps the counter above zero until release(), work done outside the job system can gate jobs with it
+        void hold(JobCounter &counter);
+        void release(JobCounter &counter);
+
+        //! Threads that take part in running jobs, the main thread included. Used to measure scaling.
+        void set_active_thread_count(uint32_t count);
+        uint32_t get_active_thread_count() const { return _activeThreadCount.load(std::memory_order_relaxed); }
+        uint32_t get_thread_count() const { return (uint32_t)_queues.size(); }
+        //! 0 for the main thread, 1..N for workers, UINT32_MAX for threads the system doesn't own
+        static uint32_t get_thread_index();
+        //! Hands thread 0 to another thread (e.g. a render thread), the old one calls this with false first
+        static void set_main_thread(bool isMain);
+
+       private:
+        struct Job {
+            std::function<void()> function;
+            JobCounter *counter;
+        };
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        std::vector<std::unique_ptr<WorkQueue>> _queues{};
+        WorkQueue _backgroundQueue;
+        std::vector<std::thread> _workers{};
+        std::atomic<uint32_t> _activeThreadCount{1};
+        std::atomic<uint32_t> _queuedJobs{0};
+        std::atomic<uint32_t> _queuedBackgroundJobs{0};
+        std::atomic<uint32_t> _nextQueue{0};
+        std::mutex _sleepMutex;
+        std::condition_variable _sleepCondition;
+        bool _stopping{false};
+
+        void push(Job &&job, bool background);
+        bool try_pop(uint32_t threadIndex, bool allowBackground, Job &job);
+        bool try_pop_background(Job &job);
+        void execute(Job &job);
+        void finish(JobCounter *counter);
+        void worker_loop(uint32_t threadIndex);
+    };
+}  // namespace bluevk
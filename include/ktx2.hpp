@@ -0,0 +1,16 @@
+#pragma once
+
+#include <types.hpp>
+
+namespace bluevk {
+    struct Ktx2Image {
+        VkFormat format;
+        VkExtent2D extent;
+        std::vector<std::vector<uint8_t>> levels{};  // level 0 is the full resolution image
+    };
+
+    bool is_ktx2(const std::vector<uint8_t> &bytes);
+    //! Only 2D, single layer, non-supercompressed files are supported
+    std::optional<Ktx2Image> read_ktx2(const std::vector<uint8_t> &bytes);
+    std::vector<uint8_t> write_ktx2(const Ktx2Image &image);
+}  // namespace bluevk
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <types.hpp>
+#include <meshes.hpp>
+
+namespace bluevk {
+    constexpr uint32_t MAX_MESH_LODS = 6;
+
+    //! Index buffer of a simplified mesh, it reuses the vertices of the full detail one
+    struct MeshLod {
+        std::vector<uint32_t> indices{};
+        //! Estimated distance to the full detail surface in mesh units, the RMS distance of each collapse
+        //! to the planes it merged, summed along the chain
+        float error{0.0f};
+    };
+
+    //! Where a mesh's LODs are in the engine's mesh list, from full detail to the coarsest
+    struct MeshLodChain {
+        uint32_t firstMesh;
+        uint32_t lodCount;
+    };
+
+    //! Quadric error edge collapses (Garland & Heckbert 1997), every LOD has about half the triangles of the one
+    //! before. Vertices are only ever moved onto a neighbour, so no new vertices are needed. Vertices on borders
+    //! and attribute seams stay where they are, the chain ends early once they are most of what's left.
+    std::vector<MeshLod> generate_lod_chain(const MeshData &mesh, uint32_t maxLodCount);
+    //! Coarsest LOD whose error doesn't exceed maxError, errors grow along the chain
+    uint32_t select_lod(const MeshInfo *lods, uint32_t lodCount, float maxError);
+}  // namespace bluevk
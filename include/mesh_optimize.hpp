@@ -0,0 +1,25 @@
+#pragma once
+
+#include <types.hpp>
+#include <meshes.hpp>
+
+#include <span>
+
+namespace bluevk {
+    //! Entries of the FIFO post-transform cache analyze_vertex_cache simulates, about what current GPUs reuse
+    constexpr uint32_t VERTEX_CACHE_ANALYSIS_SIZE = 16;
+
+    struct VertexCacheStats {
+        uint32_t vertexShaderInvocations;  // cache misses
+        float acmr;                        // invocations per triangle, 0.5 at best
+        float atvr;                        // invocations per referenced vertex, 1 at best
+    };
+
+    //! Reorders triangles so vertices are reused while still in the post-transform cache
+    //! (Forsyth, "Linear-Speed Vertex Cache Optimisation"). The triangle set doesn't change.
+    void optimize_vertex_cache(std::span<uint32_t> indices, uint32_t vertexCount);
+    //! Renumbers vertices in the order the indices first reference them so fetches walk memory linearly.
+    //! Unreferenced vertices are dropped. Run it on the concatenated indices of everything sharing the vertices.
+    void optimize_vertex_fetch(std::vector<Vertex> &vertices, std::span<uint32_t> indices);
+    VertexCacheStats analyze_vertex_cache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize);
+}  // namespace bluevk
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <types.hpp>
+
+namespace bluevk {
+    //! Full precision vertex meshes are generated and processed in, the GPU only ever sees PackedVertex
+    struct Vertex {
+        glm::vec3 position;
+        float uv_x;
+        glm::vec3 normal;
+        float uv_y;
+        glm::vec4 tangent{0.0f};  // w = bitangent sign
+    };
+
+    //! Pulled in the vertex shader through the buffer device address, no vertex input state.
+    //! Positions are snorm16 inside the mesh's bounding cube (see MeshInfo::quantization), normals and tangents
+    //! are octahedral snorm16 pairs and UVs are half floats.
+    struct PackedVertex {
+        uint32_t positionXY;
+        uint32_t positionZW;  // w = bitangent sign
+        uint32_t normal;
+        uint32_t tangent;
+        uint32_t uv;
+    };
+    static_assert(sizeof(PackedVertex) == 20);
+
+    struct MeshData {
+        std::vector<Vertex> vertices{};
+        std::vector<uint32_t> indices{};
+    };
+
+    //! Location of a mesh inside the shared vertex and index buffers
+    struct MeshInfo {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+        float lodError{0.0f};  // see MeshLod::error, 0 for full detail meshes
+        glm::vec4 quantization{0.0f, 0.0f, 0.0f, 1.0f};  // xyz = center, w = half extent of the packed positions
+    };
+
+    //! Unit sized meshes spanning [-1, 1], their bounding sphere never exceeds the cube's
+    enum BuiltinMesh : uint16_t {
+        MESH_CUBE,
+        MESH_SPHERE,
+        MESH_CYLINDER,
+        BUILTIN_MESH_COUNT,
+    };
+
+    MeshData generate_cube();
+    MeshData generate_sphere(uint32_t rings, uint32_t segments);
+    MeshData generate_cylinder(uint32_t segments);
+    MeshData generate_builtin_mesh(BuiltinMesh mesh);
+
+    //! Per triangle UV derivatives averaged over each vertex and orthogonalized against its normal
+    void generate_tangents(MeshData &mesh);
+    //! quantization receives the center and half extent positions are packed relative to
+    std::vector<PackedVertex> pack_vertices(const std::vector<Vertex> &vertices, glm::vec4 &quantization);
+    //! Maps packed positions back to mesh units, applied on top of the model matrix
+    glm::mat4 get_dequantize_transform(const glm::vec4 &quantization);
+}  // namespace bluevk
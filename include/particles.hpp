@@ -0,0 +1,86 @@
+#pragma once
+
+#include <types.hpp>
+
+namespace bluevk {
+    //! Threads of the emit and simulate passes
+    constexpr uint32_t PARTICLE_GROUP_SIZE = 64;
+    //! Elements one sort workgroup keeps in shared memory, two per thread. Bitonic steps with a smaller
+    //! stride run inside a workgroup, only the larger ones need a dispatch each.
+    constexpr uint32_t PARTICLE_SORT_GROUP_ELEMENTS = 1024;
+
+    //! Particles live in one pool, alive and dead lists hold indices into it. The alive lists ping-pong:
+    //! emission appends to the survivors of last frame, simulation compacts the survivors of this frame
+    //! into the other list and writes their camera distances, which are then sorted back to front.
+    //! Every count stays on the GPU and drives the indirect dispatches and the draw, the CPU records the
+    //! same commands whatever the particle count.
+    struct GPUParticle {
+        glm::vec3 position;
+        float age;
+        glm::vec3 velocity;
+        float lifetime;
+    };
+
+    //! Also the indirect argument buffer of the particle passes
+    struct GPUParticleCounters {
+        VkDispatchIndirectCommand emitArgs;
+        VkDispatchIndirectCommand simulateArgs;
+        VkDispatchIndirectCommand sortArgs;
+        VkDrawIndirectCommand drawArgs;  // instanceCount = particles alive after simulation
+        uint32_t aliveCount[2];
+        uint32_t deadCount;
+        uint32_t emitCount;
+        uint32_t sortSize;  // alive count rounded up to a power of two, at least one sort workgroup
+    };
+
+    //! Written every frame, the shaders get its address through the push constants
+    struct GPUParticleParams {
+        glm::vec4 emitterPosition;  // w = spawn radius
+        glm::vec4 emitterVelocity;  // xyz = mean initial velocity, w = random speed added in any direction
+        glm::vec4 startColor;
+        glm::vec4 endColor;
+        VkDeviceAddress sceneData;
+        VkDeviceAddress particles;
+        VkDeviceAddress aliveListIn;   // survivors of last frame, emission appends here
+        VkDeviceAddress aliveListOut;  // survivors of this frame, sorted and drawn
+        VkDeviceAddress deadList;
+        VkDeviceAddress sortKeys;
+        VkDeviceAddress counters;
+        float deltaTime;
+        float gravity;
+        float drag;
+        float size;
+        float lifetime;  // longest lifetime, particles live between half of it and all of it
+        uint32_t emitRequest;  // clamped to the dead count on the GPU
+        uint32_t seed;
+        uint32_t aliveIn;  // index of aliveListIn's count in GPUParticleCounters::aliveCount
+        uint32_t sorted;   // 0 draws additively in any order
+    };
+
+    enum ParticleStage : uint32_t {
+        PARTICLE_STAGE_BEGIN,  // clamps emission and writes the emit and simulate arguments
+        PARTICLE_STAGE_END,    // writes the sort and draw arguments from the survivors
+    };
+
+    enum ParticleSortStage : uint32_t {
+        PARTICLE_SORT_LOCAL,        // sorts every workgroup's elements, the first pass of the sort
+        PARTICLE_SORT_GLOBAL_STEP,  // one compare and swap step with a stride of a workgroup or more
+        PARTICLE_SORT_LOCAL_MERGE,  // the remaining steps of a merge inside every workgroup
+    };
+
+    struct GPUParticlePushConstants {
+        VkDeviceAddress params;
+        uint32_t stage;  // ParticleStage or ParticleSortStage
+        uint32_t sortBlock;   // bitonic k, size of the sequences being merged
+        uint32_t sortStride;  // bitonic j
+    };
+
+    //! Sort buffers are padded to a power of two so the bitonic network fits any alive count
+    inline uint32_t get_particle_sort_capacity(uint32_t maxParticles) {
+        uint32_t capacity = PARTICLE_SORT_GROUP_ELEMENTS;
+        while (capacity < maxParticles) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+}  // namespace bluevk
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <types.hpp>
+
+namespace bluevk {
+    constexpr uint32_t SHADOW_CASCADE_COUNT = 4;
+    constexpr uint32_t SHADOW_MAP_SIZE = 2048;
+    //! A cascade covers this much more than its frustum slice, the camera moves inside the margin without
+    //! its static casters being rendered again
+    constexpr float SHADOW_CASCADE_MARGIN = 1.25f;
+
+    struct Camera {
+        glm::vec3 target{0.0f, 0.0f, 0.0f};
+        float distance{60.0f};
+        float yaw{0.0f};
+        float pitch{0.25f};
+        float fovy{70.0f};
+        float zNear{0.1f};
+        float zFar{1000.0f};
+
+        glm::vec3 get_position() const;
+        glm::mat4 get_view() const;
+        //! Reverse-Z: the near plane maps to depth 1 and the far plane to depth 0
+        glm::mat4 get_projection(float aspect) const;
+    };
+
+    struct GPUSceneData {
+        glm::mat4 view;
+        glm::mat4 proj;
+        glm::mat4 viewProj;
+        glm::mat4 prevView;
+        glm::mat4 prevProj;
+        glm::vec4 frustumPlanes[6];
+        glm::vec4 cameraPosition;
+        glm::vec4 viewportSize;  // xy = current draw extent, zw = draw extent of the depth pyramid
+        glm::uvec4 pyramidInfo;  // xy = pyramid level 0 size, z = mip count, w = occlusion culling enabled
+        //! Temporal upscaling reprojects with the matrices the jitter wasn't applied to
+        glm::mat4 invViewProj;
+        glm::mat4 prevViewProjNoJitter;
+        glm::vec4 jitter;  // xy = sub-pixel offset of this frame in draw extent pixels
+        glm::mat4 shadowViewProj[SHADOW_CASCADE_COUNT];
+        glm::vec4 shadowSplits;      // view distance each cascade ends at
+        glm::vec4 shadowTexelSizes;  // world space size of a texel of each cascade
+        glm::vec4 lightDirection;    // xyz = towards the light, w = shadows enabled
+    };
+
+    struct GPUObjectData {
+        glm::mat4 model;
+        glm::vec4 sphereBounds;  // xyz = world space center, w = radius
+        glm::vec4 color;
+    };
+
+    //! Matches VkDrawIndexedIndirectCommand, one per draw batch. instanceCount is filled in by culling
+    struct GPUDrawCommand {
+        uint32_t indexCount;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t firstInstance;
+    };
+
+    struct GPUDrawCandidate {
+        uint32_t objectIndex;
+        uint32_t batchIndex;
+    };
+
+    struct GPUCullStats {
+        uint32_t visibleCount;
+        uint32_t frustumCulled;
+        uint32_t occlusionCulled;
+        uint32_t trianglesCulled;
+        uint32_t fragmentsSaved;
+    };
+
+    struct GPUMeshPushConstants {
+        VkDeviceAddress sceneData;
+        VkDeviceAddress objectBuffer;
+        VkDeviceAddress instanceBuffer;
+        VkDeviceAddress vertexBuffer;
+    };
+
+    struct GPUShadowPushConstants {
+        glm::mat4 viewProj;
+        VkDeviceAddress objectBuffer;
+        VkDeviceAddress vertexBuffer;
+    };
+
+    struct GPUCullPushConstants {
+        VkDeviceAddress sceneData;
+        VkDeviceAddress objectBuffer;
+        VkDeviceAddress candidateBuffer;
+        VkDeviceAddress drawCommandBuffer;
+        VkDeviceAddress instanceBuffer;
+        VkDeviceAddress cullStatsBuffer;
+        uint32_t candidateCount;
+    };
+
+    struct DepthReducePushConstants {
+        glm::ivec2 inputSize;
+        glm::ivec2 outputSize;
+    };
+
+    struct TemporalUpscalePushConstants {
+        VkDeviceAddress sceneData;
+        glm::ivec2 inputSize;
+        glm::ivec2 outputSize;
+        uint32_t reset;  // history is discarded, e.g. after a resize
+    };
+
+    enum Tonemapper : uint32_t {
+        TONEMAP_NONE,
+        TONEMAP_REINHARD,
+        TONEMAP_ACES,
+    };
+
+    struct CompositePushConstants {
+        glm::vec2 uvScale;
+        float exposure;
+        uint32_t tonemapper;
+        glm::vec2 bloomSourceSize;
+        float bloomIntensity;
+        uint32_t bloomLevels;
+    };
+
+    //! Reverse-Z orthographic light projection around a region of the light's view plane. Depth covers the
+    //! whole scene, so it only changes with the light and casters never get clipped.
+    struct ShadowCascade {
+        glm::mat4 viewProj{1.0f};
+        glm::vec2 center{0.0f};  // light view space, snapped to texels
+        float halfSize{0.0f};
+        float splitFar{0.0f};
+        bool staticValid{false};  // the cached static casters match the projection
+        bool hadDynamic{false};   // dynamic casters were drawn over the cache last time it was composited
+    };
+
+    struct SceneObject {
+        GPUObjectData data;
+        uint32_t mesh;
+    };
+
+    void extract_frustum_planes(const glm::mat4 &viewProj, glm::vec4 planes[6]);
+
+    glm::mat4 get_light_view(const glm::vec3 &lightDirection);
+    //! Blends logarithmic and uniform splits between the camera's near plane and shadowDistance
+    void compute_cascade_splits(float zNear, float shadowDistance, float lambda, float splits[SHADOW_CASCADE_COUNT]);
+    //! World space bounding sphere of the view frustum between two view distances. Its radius doesn't
+    //! depend on where the camera is, so the sphere only moves with it.
+    glm::vec4 get_frustum_slice_sphere(const Camera &camera, float aspect, float nearDistance, float farDistance);
+    //! Re-centers the cascade once the slice's sphere leaves its region, true when its static casters have
+    //! to be rendered again. sceneBounds is the world space sphere around every caster.
+    bool update_shadow_cascade(ShadowCascade &cascade, const glm::mat4 &lightView, const glm::vec4 &sliceSphere, const glm::vec4 &sceneBounds);
+    //! Whether a world space sphere overlaps the cascade's region in the light's view plane
+    bool shadow_cascade_overlaps(const ShadowCascade &cascade, const glm::mat4 &lightView, const glm::vec4 &sphere);
+
+    //! A few large occluders in front of a dense grid of small cubes, spheres and cylinders
+    std::vector<SceneObject> generate_dense_scene(uint32_t objectsPerAxis, uint32_t layerCount);
+}  // namespace bluevk
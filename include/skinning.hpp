@@ -0,0 +1,92 @@
+#pragma once
+
+#include <types.hpp>
+#include <meshes.hpp>
+
+namespace bluevk {
+    //! Joint arrays are padded to a multiple of this, so the per joint loops vectorize without a scalar tail
+    constexpr uint32_t JOINT_SIMD_WIDTH = 8;
+    constexpr uint32_t NO_PARENT_JOINT = UINT32_MAX;
+
+    struct Skeleton {
+        std::vector<uint32_t> parents{};  // a parent always comes before its children
+        std::vector<glm::mat4> inverseBind{};
+
+        uint32_t get_joint_count() const { return (uint32_t)parents.size(); }
+        uint32_t get_joint_stride() const { return (get_joint_count() + JOINT_SIMD_WIDTH - 1) / JOINT_SIMD_WIDTH * JOINT_SIMD_WIDTH; }
+    };
+
+    //! Components of a local joint transform. A pose is JOINT_CHANNEL_COUNT arrays of jointStride floats,
+    //! one per channel, which is also how the skinning shader reads it.
+    enum JointChannel : uint32_t {
+        JOINT_ROTATION_X,
+        JOINT_ROTATION_Y,
+        JOINT_ROTATION_Z,
+        JOINT_ROTATION_W,
+        JOINT_TRANSLATION_X,
+        JOINT_TRANSLATION_Y,
+        JOINT_TRANSLATION_Z,
+        JOINT_CHANNEL_COUNT,
+    };
+
+    //! Keys are resampled to a fixed rate, one key index and blend factor then serve every joint.
+    //! Key k is a pose at keys[k * JOINT_CHANNEL_COUNT * jointStride], the last key repeats the first one.
+    struct AnimationClip {
+        float sampleRate{30.0f};
+        uint32_t keyCount{0};
+        uint32_t jointStride{0};
+        std::vector<float> keys{};
+
+        float get_duration() const { return (keyCount - 1) / sampleRate; }
+    };
+
+    //! Matches the skinning shader's influence, 4 joints of 8 bits and 4 unorm8 weights summing to 1
+    struct SkinInfluence {
+        uint32_t joints;
+        uint32_t weights;
+    };
+
+    struct SkinnedMeshData {
+        MeshData mesh{};
+        std::vector<SkinInfluence> influences{};  // one per vertex
+        Skeleton skeleton{};
+        float reach{0.0f};  // no pose moves a vertex farther than this from the root
+    };
+
+    //! Threads of both skinning passes
+    constexpr uint32_t SKINNING_GROUP_SIZE = 64;
+
+    //! Animation is sampled on the CPU into a pose per instance. One dispatch turns every instance's
+    //! poses into skin matrices, a second one skins every instance's vertices into its own range of the
+    //! scene vertex buffer, where all later passes draw it from like any other mesh.
+    struct GPUSkeletonJoint {
+        glm::mat4 inverseBind;
+        uint32_t parent;
+        uint32_t padding[3];
+    };
+
+    struct GPUSkinningPushConstants {
+        glm::vec4 sourceQuantization;  // bind pose vertices
+        glm::vec4 outputQuantization;  // skinned vertices, covers the skeleton's reach
+        VkDeviceAddress sourceVertices;
+        VkDeviceAddress outputVertices;
+        VkDeviceAddress jointPoses;
+        VkDeviceAddress skeleton;
+        VkDeviceAddress skinMatrices;  // 3x4 rows, jointStride per instance
+        VkDeviceAddress influences;
+        uint32_t sourceVertexOffset;
+        uint32_t outputVertexOffset;  // instance i starts vertexCount * i vertices after it
+        uint32_t vertexCount;
+        uint32_t jointCount;
+        uint32_t jointStride;
+        uint32_t instanceCount;
+    };
+
+    //! A tapered, capped tube along +y from the root, bent by a chain of jointCount joints
+    SkinnedMeshData generate_skinned_tube(uint32_t jointCount, uint32_t rings, uint32_t segments, float length, float radius);
+    //! Looping sway of every joint, the joints further up the chain lag behind
+    AnimationClip generate_sway_clip(const Skeleton &skeleton, float duration, float sampleRate);
+
+    //! Writes the looped clip's pose at time to pose, see JointChannel for the layout
+    void sample_clip(const AnimationClip &clip, float time, float *pose);
+}  // namespace bluevk
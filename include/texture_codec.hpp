@@ -0,0 +1,24 @@
+#pragma once
+
+#include <types.hpp>
+
+namespace bluevk {
+    constexpr uint32_t BC_BLOCK_SIZE = 16;
+
+    std::vector<uint8_t> downsample_rgba8(const std::vector<uint8_t> &pixels, VkExtent2D extent, VkExtent2D &outExtent);
+
+    bool is_bc_format(VkFormat format);
+    size_t get_image_size(VkFormat format, VkExtent2D extent);
+
+    //! BC7 is encoded with mode 6 only (single subset, 4-bit indices), which is what the offline
+    //! converter writes. The decoder handles mode 6 and reports other modes as unsupported.
+    void encode_bc7_block(const uint8_t rgba[16 * 4], uint8_t block[16]);
+    bool decode_bc7_block(const uint8_t block[16], uint8_t rgba[16 * 4]);
+
+    //! BC5 stores the red and green channels as two BC4 blocks
+    void encode_bc5_block(const uint8_t rgba[16 * 4], uint8_t block[16]);
+    void decode_bc5_block(const uint8_t block[16], uint8_t rgba[16 * 4]);
+
+    std::vector<uint8_t> compress_image(const std::vector<uint8_t> &rgba, VkExtent2D extent, VkFormat format);
+    std::vector<uint8_t> decompress_image(const std::vector<uint8_t> &blocks, VkExtent2D extent, VkFormat format);
+}  // namespace bluevk
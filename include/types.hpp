@@ -13,6 +13,7 @@
 
 #include <fmt/core.h>
 
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
 namespace bluevk {
@@ -22,14 +23,49 @@ namespace bluevk {
         VmaAllocation allocation;
         VkExtent2D extent;
         VkFormat format;
+        uint32_t mipLevels{1};
     };
+    struct BlueVKBuffer {
+        VkBuffer buffer;
+        VmaAllocation allocation;
+        VmaAllocationInfo info;
+    };
+}
+
+//! Build configuration, set by CMake. BLUEVK_DEBUG_TOOLS=0 compiles out validation, the debug messenger and
+//! debug labels. BLUEVK_VK_CHECK_LEVEL: 2 aborts with the failing call and its location, 1 with the result
+//! only, 0 ignores results.
+#ifndef BLUEVK_DEBUG_TOOLS
+#define BLUEVK_DEBUG_TOOLS 1
+#endif
+#ifndef BLUEVK_VK_CHECK_LEVEL
+#define BLUEVK_VK_CHECK_LEVEL 2
+#endif
+
+namespace bluevk {
+    //! Kept out of line so call sites only pay for the compare and a call on the cold path
+    [[noreturn]] void vk_check_failed(VkResult result, const char *call, const char *file, int line);
 }
 
-#define VK_CHECK(x)                                                        \
-    do {                                                                   \
-        VkResult err = x;                                                  \
-        if (err) {                                                         \
-            fmt::print("Detected Vulkan error: {}", string_VkResult(err)); \
-            abort();                                                       \
-        }                                                                  \
+#if BLUEVK_VK_CHECK_LEVEL >= 2
+#define VK_CHECK(x)                                                     \
+    do {                                                                \
+        VkResult err = x;                                               \
+        if (err) [[unlikely]] {                                         \
+            bluevk::vk_check_failed(err, #x, __FILE__, __LINE__);       \
+        }                                                               \
+    } while (0)
+#elif BLUEVK_VK_CHECK_LEVEL == 1
+#define VK_CHECK(x)                                                     \
+    do {                                                                \
+        VkResult err = x;                                               \
+        if (err) [[unlikely]] {                                         \
+            bluevk::vk_check_failed(err, nullptr, nullptr, 0);          \
+        }                                                               \
+    } while (0)
+#else
+#define VK_CHECK(x) \
+    do {            \
+        (void)(x);  \
     } while (0)
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <types.hpp>
+
+namespace bluevk {
+    VkDeviceAddress get_buffer_device_address(VkDevice device, VkBuffer buffer);
+
+    void memory_barrier(VkCommandBuffer cmd,
+                        VkPipelineStageFlags2 srcStageMask,
+                        VkAccessFlags2 srcAccessMask,
+                        VkPipelineStageFlags2 dstStageMask,
+                        VkAccessFlags2 dstAccessMask);
+
+    void copy_buffer_to_buffer(VkCommandBuffer cmd,
+                               VkBuffer source,
+                               VkBuffer destination,
+                               VkDeviceSize size,
+                               VkDeviceSize srcOffset = 0,
+                               VkDeviceSize dstOffset = 0);
+}  // namespace bluevk
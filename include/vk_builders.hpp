@@ -37,6 +37,8 @@ namespace bluevk {
         ImageBuilder &set_format(VkFormat format);
         ImageBuilder &set_extent(VkExtent2D extent);
         ImageBuilder &set_usage(VkImageUsageFlags usage);
+        ImageBuilder &set_mip_levels(uint32_t mipLevels);
+        ImageBuilder &set_array_layers(uint32_t arrayLayers);
         VkImage build(VkDevice device);
         VkImage vmaBuild(VmaAllocator allocator, VmaAllocationCreateInfo *allocCreateInfo, VmaAllocation *alloc, VmaAllocationInfo *allocInfo);
     };
@@ -56,8 +58,41 @@ namespace bluevk {
         ImageViewBuilder &set_image(VkImage image);
         ImageViewBuilder &set_format(VkFormat format);
         ImageViewBuilder &set_subresource_range_aspect(VkImageAspectFlags aspectMask);
+        ImageViewBuilder &set_mip_range(uint32_t baseMipLevel, uint32_t levelCount);
+        ImageViewBuilder &set_view_type(VkImageViewType viewType);
+        ImageViewBuilder &set_layer_range(uint32_t baseArrayLayer, uint32_t layerCount);
         VkImageView build(VkDevice device);
     };
+    struct BufferBuilder {
+        VkBufferCreateInfo info{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .pNext = nullptr,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        };
+        BufferBuilder &set_size(VkDeviceSize size);
+        BufferBuilder &set_usage(VkBufferUsageFlags usage);
+        VkBuffer vmaBuild(VmaAllocator allocator, VmaAllocationCreateInfo *allocCreateInfo, VmaAllocation *alloc, VmaAllocationInfo *allocInfo);
+    };
+    struct SamplerBuilder {
+        VkSamplerCreateInfo info{
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .pNext = nullptr,
+            .magFilter = VK_FILTER_NEAREST,
+            .minFilter = VK_FILTER_NEAREST,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .minLod = 0.0f,
+            .maxLod = VK_LOD_CLAMP_NONE,
+        };
+        SamplerBuilder &set_filter(VkFilter magFilter, VkFilter minFilter);
+        SamplerBuilder &set_mipmap_mode(VkSamplerMipmapMode mode);
+        SamplerBuilder &set_address_mode(VkSamplerAddressMode mode);
+        //! Turns the sampler into a depth comparison sampler, sampler*Shadow in GLSL
+        SamplerBuilder &set_compare_op(VkCompareOp op);
+        VkSampler build(VkDevice device);
+    };
     struct FenceBuilder {
         VkFenceCreateInfo info{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
         FenceBuilder &set_create_flags(VkFenceCreateFlags flags);
@@ -70,7 +105,7 @@ namespace bluevk {
     };
     struct DescriptorSetLayoutBuilder {
         std::vector<VkDescriptorSetLayoutBinding> bindings{};
-        DescriptorSetLayoutBuilder &add_binding(uint32_t binding, VkDescriptorType type);
+        DescriptorSetLayoutBuilder &add_binding(uint32_t binding, VkDescriptorType type, uint32_t count = 1);
         DescriptorSetLayoutBuilder &clear();
         VkDescriptorSetLayout build(VkDevice device, VkShaderStageFlags shaderStages);
     };
@@ -81,4 +116,13 @@ namespace bluevk {
         void destroy_pool(VkDevice device);
         VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout);
     };
+    struct DescriptorSetWriter {
+        std::deque<VkDescriptorImageInfo> imageInfos{};
+        std::deque<VkDescriptorBufferInfo> bufferInfos{};
+        std::vector<VkWriteDescriptorSet> writes{};
+        DescriptorSetWriter &write_image(uint32_t binding, VkImageView view, VkSampler sampler, VkImageLayout layout, VkDescriptorType type, uint32_t arrayElement = 0);
+        DescriptorSetWriter &write_buffer(uint32_t binding, VkBuffer buffer, VkDeviceSize size, VkDeviceSize offset, VkDescriptorType type);
+        DescriptorSetWriter &clear();
+        void update(VkDevice device, VkDescriptorSet set);
+    };
 }  // namespace bluevk
\ No newline at end of file
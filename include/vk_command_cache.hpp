@@ -0,0 +1,40 @@
+#pragma once
+
+#include <types.hpp>
+#include <vk_builders.hpp>
+
+namespace bluevk {
+    //! FNV-1a over the raw bytes of every input a recording depends on
+    struct InputHash {
+        uint64_t value{14695981039346656037ull};
+
+        void add_bytes(const void *data, size_t size);
+        template <typename T>
+        InputHash &add(const T &input) {
+            add_bytes(&input, sizeof(T));
+            return *this;
+        }
+    };
+
+    //! Secondary command buffers that are kept across frames and recorded again only when the key of
+    //! the inputs they were recorded from changes. Every buffer has its own pool, so several buffers can
+    //! be recorded on different threads at once. A cache belongs to one frame in flight: its buffers are
+    //! only touched again after that frame's fence has signaled.
+    struct CommandCache {
+        VkDevice device;
+        CommandPoolBuilder poolBuilder;
+        uint64_t key{0};
+        bool valid{false};
+        std::vector<VkCommandPool> pools{};
+        std::vector<VkCommandBuffer> buffers{};
+        uint32_t count{0};
+
+        void init(VkDevice device, uint32_t queueFamilyIndex);
+        void destroy();
+        //! Sizes the cache for count buffers, returns true if they have to be recorded again
+        bool acquire(uint64_t key, uint32_t count);
+        //! Thread safe for distinct indices
+        VkCommandBuffer begin(uint32_t index, const VkCommandBufferInheritanceInfo &inheritance);
+        void invalidate() { valid = false; }
+    };
+}  // namespace bluevk
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <types.hpp>
+
+//! Every device level function the engine calls. The dispatch table and its loader are generated from this list,
+//! a new Vulkan call only has to be added here.
+#define BLUEVK_DEVICE_FUNCTIONS(X) \
+    X(vkAcquireNextImageKHR)        \
+    X(vkAllocateCommandBuffers)     \
+    X(vkAllocateDescriptorSets)     \
+    X(vkBeginCommandBuffer)         \
+    X(vkCmdBeginRendering)          \
+    X(vkCmdBindDescriptorSets)      \
+    X(vkCmdBindIndexBuffer)         \
+    X(vkCmdBindPipeline)            \
+    X(vkCmdBlitImage2)              \
+    X(vkCmdCopyBuffer2)             \
+    X(vkCmdCopyBufferToImage2)      \
+    X(vkCmdCopyImage2)              \
+    X(vkCmdCopyImageToBuffer2)      \
+    X(vkCmdDispatch)                \
+    X(vkCmdDispatchIndirect)        \
+    X(vkCmdDraw)                    \
+    X(vkCmdDrawIndexedIndirect)     \
+    X(vkCmdDrawIndirect)            \
+    X(vkCmdEndRendering)            \
+    X(vkCmdExecuteCommands)         \
+    X(vkCmdFillBuffer)              \
+    X(vkCmdPipelineBarrier2)        \
+    X(vkCmdPushConstants)           \
+    X(vkCmdResetQueryPool)          \
+    X(vkCmdSetScissor)              \
+    X(vkCmdSetViewport)             \
+    X(vkCmdWriteTimestamp2)         \
+    X(vkCreateCommandPool)          \
+    X(vkCreateComputePipelines)     \
+    X(vkCreateDescriptorPool)       \
+    X(vkCreateDescriptorSetLayout)  \
+    X(vkCreateFence)                \
+    X(vkCreateGraphicsPipelines)    \
+    X(vkCreateImage)                \
+    X(vkCreateImageView)            \
+    X(vkCreatePipelineLayout)       \
+    X(vkCreateQueryPool)            \
+    X(vkCreateSampler)              \
+    X(vkCreateSemaphore)            \
+    X(vkCreateShaderModule)         \
+    X(vkDestroyCommandPool)         \
+    X(vkDestroyDescriptorPool)      \
+    X(vkDestroyDescriptorSetLayout) \
+    X(vkDestroyDevice)              \
+    X(vkDestroyFence)               \
+    X(vkDestroyImage)               \
+    X(vkDestroyImageView)           \
+    X(vkDestroyPipeline)            \
+    X(vkDestroyPipelineLayout)      \
+    X(vkDestroyQueryPool)           \
+    X(vkDestroySampler)             \
+    X(vkDestroySemaphore)           \
+    X(vkDestroyShaderModule)        \
+    X(vkDestroySwapchainKHR)        \
+    X(vkDeviceWaitIdle)             \
+    X(vkEndCommandBuffer)           \
+    X(vkGetBufferDeviceAddress)     \
+    X(vkGetQueryPoolResults)        \
+    X(vkQueuePresentKHR)            \
+    X(vkQueueSubmit2)               \
+    X(vkQueueWaitIdle)              \
+    X(vkResetCommandBuffer)         \
+    X(vkResetCommandPool)           \
+    X(vkResetDescriptorPool)        \
+    X(vkResetFences)                \
+    X(vkUpdateDescriptorSets)       \
+    X(vkWaitForFences)
+
+//! Extension functions the engine can run without, they stay nullptr when the extension isn't enabled
+#define BLUEVK_OPTIONAL_DEVICE_FUNCTIONS(X) \
+    X(vkCmdBeginDebugUtilsLabelEXT)         \
+    X(vkCmdEndDebugUtilsLabelEXT)           \
+    X(vkWaitForPresentKHR)
+
+namespace bluevk {
+    //! Device level entry points fetched once with vkGetDeviceProcAddr. Calling through them skips the
+    //! loader's exported trampolines, which look up the device's dispatch table on every call.
+    struct DeviceDispatch {
+#define BLUEVK_DECLARE_FUNCTION(name) PFN_##name name{nullptr};
+        BLUEVK_DEVICE_FUNCTIONS(BLUEVK_DECLARE_FUNCTION)
+        BLUEVK_OPTIONAL_DEVICE_FUNCTIONS(BLUEVK_DECLARE_FUNCTION)
+#undef BLUEVK_DECLARE_FUNCTION
+
+        void load(VkDevice device);
+    };
+
+    //! The engine creates a single device, the table is loaded right after it
+    extern DeviceDispatch vkd;
+}  // namespace bluevk
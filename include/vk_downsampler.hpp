@@ -0,0 +1,87 @@
+#pragma once
+
+#include <types.hpp>
+#include <vk_builders.hpp>
+
+namespace bluevk {
+    //! Levels one dispatch writes below its source, takes 4096 down to 1
+    constexpr uint32_t DOWNSAMPLE_MAX_MIPS = 12;
+    //! Above this the last workgroup can't take mip 6 down on its own, dispatches stop at mip 6 instead
+    constexpr uint32_t DOWNSAMPLE_MAX_SOURCE_SIZE = 4096;
+    //! Dispatches that can be in flight without a barrier between them, each one owns an atomic counter
+    constexpr uint32_t DOWNSAMPLE_COUNTER_COUNT = 64;
+    constexpr uint32_t DOWNSAMPLE_SETS_PER_POOL = 32;
+
+    struct GPUDownsamplePushConstants {
+        VkDeviceAddress counter;
+        glm::ivec2 sourceSize;
+        uint32_t mipCount;
+        uint32_t groupCount;
+    };
+
+    //! Builds a whole mip chain in one compute dispatch instead of a blit and a barrier per level, see
+    //! downsample.comp. Views and descriptor sets only live for the frame that records them.
+    class Downsampler {
+       public:
+        void init(VkDevice device, VmaAllocator allocator, uint32_t frameCount);
+        void destroy();
+        //! Call once the frame slot's fence has signaled, before recording into it again
+        void update(VkCommandBuffer cmd, uint32_t frameIndex);
+
+        //! RGBA16F and RGBA8 unorm, every other format needs its own shader variant
+        bool is_format_supported(VkFormat format) const;
+        //! Same contract as the blit based generate_mipmaps: expects every level in TRANSFER_DST_OPTIMAL
+        //! and leaves them all in SHADER_READ_ONLY_OPTIMAL
+        void generate_mipmaps(VkCommandBuffer cmd, const BlueVKImage &image, uint32_t baseMipLevel, uint32_t levelCount);
+        //! Fills every level of destination from sourceExtent of source, level 0 is half of it. Level n is only
+        //! written up to sourceExtent >> (n + 1). Destination ends up in SHADER_READ_ONLY_OPTIMAL.
+        void downsample(VkCommandBuffer cmd,
+                        VkImageView source,
+                        VkImageLayout sourceLayout,
+                        VkExtent2D sourceExtent,
+                        const BlueVKImage &destination);
+
+        uint32_t get_dispatch_count() const { return _dispatchCount; }
+
+       private:
+        struct FrameResources {
+            std::vector<DescriptorSetAllocator> pools{};
+            uint32_t usedSets{0};
+            std::vector<VkImageView> views{};
+        };
+
+        VkDevice _device;
+        VmaAllocator _allocator;
+        VkSampler _sampler;
+        VkDescriptorSetLayout _descriptorLayout;
+        VkPipelineLayout _layout;
+        VkPipeline _rgba16fPipeline;
+        VkPipeline _rgba8Pipeline;
+        BlueVKBuffer _counterBuffer;
+        bool _countersCleared{false};
+        uint32_t _nextCounter{0};
+        uint32_t _dispatchCount{0};
+
+        std::vector<FrameResources> _frames{};
+        uint32_t _frameSlot{0};
+
+        VkImageView create_view(const BlueVKImage &image, uint32_t mip);
+        VkDescriptorSet allocate_set();
+        //! Levels firstMip to firstMip + levelCount - 1 of destination are in GENERAL, all of them
+        //! end up in SHADER_READ_ONLY_OPTIMAL
+        void record_chain(VkCommandBuffer cmd,
+                          VkImageView source,
+                          VkImageLayout sourceLayout,
+                          VkExtent2D sourceExtent,
+                          const BlueVKImage &destination,
+                          uint32_t firstMip,
+                          uint32_t levelCount);
+        void dispatch(VkCommandBuffer cmd,
+                      VkImageView source,
+                      VkImageLayout sourceLayout,
+                      VkExtent2D sourceExtent,
+                      const BlueVKImage &destination,
+                      uint32_t firstMip,
+                      uint32_t mipCount);
+    };
+}  // namespace bluevk
@@ -4,10 +4,37 @@
 
 namespace bluevk {
     void transition_image(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout);
+    void transition_image_mips(VkCommandBuffer cmd,
+                               VkImage image,
+                               VkImageLayout currentLayout,
+                               VkImageLayout newLayout,
+                               uint32_t baseMipLevel,
+                               uint32_t levelCount);
 
     void copy_image_to_image(VkCommandBuffer cmd,
                              VkImage source,
                              VkImage destination,
                              VkExtent2D srcSize,
                              VkExtent2D dstSize);
+
+    //! Copies every level of same sized images, expects TRANSFER_SRC_OPTIMAL and TRANSFER_DST_OPTIMAL
+    void copy_image_mips(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D extent, uint32_t levelCount);
+
+    void copy_buffer_to_image(VkCommandBuffer cmd,
+                              VkBuffer source,
+                              VkImage destination,
+                              VkExtent2D extent,
+                              uint32_t mipLevel,
+                              VkDeviceSize bufferOffset = 0);
+
+    //! Tightly packed rows, expects TRANSFER_SRC_OPTIMAL
+    void copy_image_to_buffer(VkCommandBuffer cmd,
+                              VkImage source,
+                              VkBuffer destination,
+                              VkOffset2D offset,
+                              VkExtent2D extent,
+                              VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+
+    //! Expects every level in TRANSFER_DST_OPTIMAL and leaves them all in SHADER_READ_ONLY_OPTIMAL
+    void generate_mipmaps(VkCommandBuffer cmd, VkImage image, VkExtent2D baseExtent, uint32_t baseMipLevel, uint32_t levelCount);
 }  // namespace bluevk
\ No newline at end of file
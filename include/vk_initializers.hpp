@@ -7,11 +7,14 @@ namespace bluevk {
     VkCommandBufferSubmitInfo command_buffer_submit_info(VkCommandBuffer cmd);
     VkSemaphoreSubmitInfo semaphore_submit_info(VkPipelineStageFlags2 stageMask, VkSemaphore semaphore);
     VkSubmitInfo2 submit_info(VkCommandBufferSubmitInfo* cmd, VkSemaphoreSubmitInfo* signalSemaphoreInfo, VkSemaphoreSubmitInfo* waitSemaphoreInfo);
+    //! Secondary buffers recorded inside a dynamic rendering scope, colorFormat may be null for depth only passes
+    VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info(const VkFormat* colorFormat, VkFormat depthFormat);
+    VkCommandBufferInheritanceInfo inheritance_info(VkCommandBufferInheritanceRenderingInfo* renderingInfo);
 
     VkImageSubresourceRange image_subresource_range(VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT);
 
     VkRenderingAttachmentInfo attachment_info(VkImageView view, VkClearValue* clear, VkImageLayout layout);
-    VkRenderingAttachmentInfo depth_attachment_info(VkImageView view, VkImageLayout layout);
+    VkRenderingAttachmentInfo depth_attachment_info(VkImageView view, VkImageLayout layout, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR);
     VkRenderingInfo rendering_info(VkExtent2D renderExtent, VkRenderingAttachmentInfo* colorAttachment, VkRenderingAttachmentInfo* depthAttachment);
 
     VkPipelineShaderStageCreateInfo pipeline_shader_stage_create_info(VkShaderStageFlagBits stage, VkShaderModule shaderModule, const char* entry = "main");
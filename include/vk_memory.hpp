@@ -0,0 +1,59 @@
+#pragma once
+
+#include <types.hpp>
+#include <vk_profiler.hpp>
+
+namespace bluevk {
+    //! Allocations that defragmentation may move carry one of these as their VMA user data.
+    //! move() creates a resource bound to the destination, records the copy and switches over to it.
+    //! It returns a function releasing the old resource, which runs once no frame in flight can use it.
+    //! Returning an empty function leaves the allocation where it is.
+    struct MovableResource {
+        std::function<std::function<void()>(VkCommandBuffer cmd, VmaAllocation destination)> move;
+    };
+
+    //! Per-heap budgets every frame, full VMA statistics periodically, and incremental defragmentation:
+    //! at most one pass is in flight, it is ended only after every frame that could touch the moved
+    //! resources has retired.
+    struct MemoryTracker {
+        static constexpr uint32_t STATISTICS_INTERVAL = 30;
+        static constexpr uint32_t DEFRAGMENTATION_COOLDOWN = 600;
+
+        VmaAllocator allocator;
+        uint32_t frameCount;
+        bool budgetExtension;
+        std::vector<VkMemoryHeapFlags> heapFlags{};
+        std::vector<VmaBudget> budgets{};
+        VmaTotalStatistics statistics{};
+        float fragmentation{0.0f};
+        uint64_t statisticsFrame{0};
+
+        bool autoDefragment{true};
+        float defragmentThreshold{0.3f};
+        VkDeviceSize maxBytesPerPass{32 * 1024 * 1024};
+        uint32_t maxAllocationsPerPass{64};
+        bool defragmentRequested{false};
+        VmaDefragmentationContext defragmentation{VK_NULL_HANDLE};
+        VmaDefragmentationPassMoveInfo pass{};
+        bool passInFlight{false};
+        uint64_t passFrame{0};
+        uint64_t lastDefragmentationFrame{0};
+        std::vector<std::function<void()>> passReleases{};
+        uint32_t defragmentationRuns{0};
+        uint32_t defragmentationPasses{0};
+        VmaDefragmentationStats defragmentationTotals{};
+
+        void init(VkPhysicalDevice physicalDevice, VmaAllocator allocator, uint32_t frameCount, bool budgetExtension);
+        void destroy();
+        //! Called after the frame's fence has been waited on
+        void update(VkCommandBuffer cmd, uint64_t frameNumber);
+        void report(Profiler &profiler) const;
+        void draw_imgui();
+        void print_report();
+
+       private:
+        void begin_pass(VkCommandBuffer cmd, uint64_t frameNumber);
+        VkResult end_pass();
+        void finish_defragmentation(uint64_t frameNumber);
+    };
+}  // namespace bluevk
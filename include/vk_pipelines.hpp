@@ -38,6 +38,7 @@ namespace bluevk {
         void clear();
         GraphicsPipelineBuilder &set_layout(VkPipelineLayout layout);
         GraphicsPipelineBuilder &set_shaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
+        GraphicsPipelineBuilder &set_vertex_shader(VkShaderModule vertexShader);
         GraphicsPipelineBuilder &set_input_topology(VkPrimitiveTopology topology);
         GraphicsPipelineBuilder &set_polygon_mode(VkPolygonMode mode);
         GraphicsPipelineBuilder &set_cull_mode(VkCullModeFlags cullMode, VkFrontFace frontFace);
@@ -47,9 +48,13 @@ namespace bluevk {
         GraphicsPipelineBuilder &set_pipeline_layout(VkPipelineLayout layout);
         GraphicsPipelineBuilder &disable_depthtest();
         GraphicsPipelineBuilder &enable_depthtest(bool depthWriteEnable, VkCompareOp op);
+        //! Factors are in the direction of the depth test, negative pushes away from the viewer with reverse-Z
+        GraphicsPipelineBuilder &enable_depth_bias(float constantFactor, float slopeFactor);
         GraphicsPipelineBuilder &disable_blending();
         GraphicsPipelineBuilder &enable_blending_additive();
         GraphicsPipelineBuilder &enable_blending_alphablend();
+        //! Color = src + dst * (1 - src alpha), the shader multiplies its color by alpha
+        GraphicsPipelineBuilder &enable_blending_premultiplied();
         VkPipeline build(VkDevice device);
     };
 }  // namespace bluevk
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <types.hpp>
+
+#include <mutex>
+
+namespace bluevk {
+    struct Profiler {
+        struct Entry {
+            std::string name;
+            double last{0.0};
+            double total{0.0};
+            uint64_t samples{0};
+        };
+        struct FrameQueries {
+            VkQueryPool pool;
+            uint32_t queryCount;
+            std::vector<std::pair<std::string, uint32_t>> scopes;
+            std::vector<uint32_t> openScopes;
+        };
+        static constexpr uint32_t MAX_QUERIES_PER_FRAME = 128;
+
+        float timestampPeriod;
+        uint64_t timestampMask;
+        bool gpuTimings{false};  // off without timestamp support on the graphics queue, scopes only label then
+        bool debugLabels{false};  // scopes are also recorded as debug utils labels
+        std::vector<FrameQueries> frames{};
+        FrameQueries *current{nullptr};
+        std::mutex entryMutex;  // timings and counters are recorded from the main and the render thread
+        std::vector<Entry> timings{};
+        std::vector<Entry> counters{};
+
+        void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount);
+        void destroy(VkDevice device);
+        void begin_frame(VkDevice device, VkCommandBuffer cmd, uint32_t frameIndex);
+        void begin_scope(VkCommandBuffer cmd, const std::string &name);
+        void end_scope(VkCommandBuffer cmd);
+        void set_timing(const std::string &name, double milliseconds);
+        void set_counter(const std::string &name, double value);
+        double get_average(const std::string &name);
+        void draw_imgui();
+        void print_report();
+    };
+}  // namespace bluevk
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <types.hpp>
+#include <job_system.hpp>
+
+#include <mutex>
+
+namespace bluevk {
+    struct ReadbackResult {
+        const void *data;
+        VkDeviceSize size;
+        VkFormat format;    // VK_FORMAT_UNDEFINED for buffers
+        VkExtent2D extent;  // rows are tightly packed
+        uint64_t frame;     // frame the copy was recorded in
+    };
+    using ReadbackCallback = std::function<void(const ReadbackResult &result)>;
+
+    //! Copies images and buffers into a ring of host visible buffers without ever waiting on the GPU.
+    //! A copy recorded in a frame is handed back once that frame slot comes around again, its fence has
+    //! signaled by then. Requests are dropped when every slot is in flight instead of stalling the frame.
+    //! Captures are written to disk by background jobs that hold on to their slot until the file is done.
+    class ReadbackQueue {
+       public:
+        void init(VkDevice device, VmaAllocator allocator, uint32_t slotCount, JobSystem *jobs);
+        //! Blocks until every capture is on disk, writer jobs run on parked workers too so this can't starve
+        void destroy();
+
+        //! The image is moved to TRANSFER_SRC_OPTIMAL for the copy and back to layout afterwards
+        bool read_image(VkCommandBuffer cmd,
+                        const BlueVKImage &image,
+                        VkImageLayout layout,
+                        VkOffset2D offset,
+                        VkExtent2D extent,
+                        ReadbackCallback &&callback);
+        bool read_buffer(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, ReadbackCallback &&callback);
+        //! Written as <path>.pfm for float color formats, <path>.ppm for 8 bit ones and <path>.bin otherwise
+        bool capture_image(VkCommandBuffer cmd,
+                           const BlueVKImage &image,
+                           VkImageLayout layout,
+                           VkExtent2D extent,
+                           const std::string &path);
+        //! Call once the frame slot's fence has signaled, before recording into it again
+        void update(uint32_t frameIndex, uint64_t frameNumber);
+
+        uint32_t get_slots_in_flight();
+        uint64_t get_dropped_count() const { return _droppedCount.load(std::memory_order_relaxed); }
+        uint64_t get_written_count() const { return _writtenCount.load(std::memory_order_relaxed); }
+        uint64_t get_pending_writes() const { return _pendingWrites.load(std::memory_order_relaxed); }
+
+       private:
+        enum class SlotState {
+            Free,
+            Copying,  // recorded, waiting for its frame's fence
+            Writing,  // owned by a disk writer job
+        };
+        struct Slot {
+            BlueVKBuffer buffer{};
+            VkDeviceSize capacity{0};
+            SlotState state{SlotState::Free};
+            uint32_t frameIndex{0};
+            ReadbackResult result{};
+            ReadbackCallback callback{};
+            std::string path{};
+        };
+
+        VkDevice _device;
+        VmaAllocator _allocator;
+        JobSystem *_jobs;
+        uint32_t _frameIndex{0};
+        uint64_t _frameNumber{0};
+
+        std::mutex _slotMutex;
+        std::vector<Slot> _slots{};
+        JobCounter _writeJobs;
+
+        std::atomic<uint64_t> _droppedCount{0};
+        std::atomic<uint64_t> _writtenCount{0};
+        std::atomic<uint64_t> _pendingWrites{0};
+
+        Slot *acquire(VkDeviceSize size);
+        Slot *record_image_copy(VkCommandBuffer cmd, const BlueVKImage &image, VkImageLayout layout, VkOffset2D offset, VkExtent2D extent);
+        void record_host_barrier(VkCommandBuffer cmd);
+        void write(Slot &slot);
+    };
+}  // namespace bluevk
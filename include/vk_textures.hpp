@@ -0,0 +1,117 @@
+#pragma once
+
+#include <types.hpp>
+#include <job_system.hpp>
+#include <vk_memory.hpp>
+#include <vk_downsampler.hpp>
+
+#include <unordered_map>
+
+namespace bluevk {
+    using TextureHandle = uint32_t;
+    constexpr TextureHandle INVALID_TEXTURE = UINT32_MAX;
+
+    //! Streams textures: files are read, hashed and decoded as background jobs, then uploaded
+    //! within a per-frame byte budget. A small mip tail is uploaded first so the texture can be
+    //! sampled right away, the full resolution levels follow.
+    //! Regular images are decoded to RGBA8 and the GPU regenerates the whole chain, in one downsampler
+    //! dispatch or with blits without one. KTX2 files (BC7/BC5 from the offline converter) carry their
+    //! own mips and are uploaded as they are.
+    //! Without BC support the blocks are decoded to RGBA8 on the worker instead.
+    class TextureCache {
+       public:
+        enum class TextureState {
+            Loading,
+            Failed,
+            Partial,
+            Resident,
+        };
+        struct Texture {
+            std::string path;
+            uint64_t contentHash{0};
+            TextureState state{TextureState::Loading};
+            TextureHandle aliasOf{INVALID_TEXTURE};
+            BlueVKImage image{};
+            uint32_t residentMip{0};
+            VkDeviceSize memoryBytes{0};
+            VkDeviceSize uncompressedBytes{0};  // RGBA8 size of the same mip chain
+            std::unique_ptr<MovableResource> movable{};
+        };
+        static constexpr uint32_t MIP_TAIL_SIZE = 64;
+
+        void init(VkDevice device,
+                  VkPhysicalDevice physicalDevice,
+                  VmaAllocator allocator,
+                  bool textureCompressionBC,
+                  uint32_t frameCount,
+                  JobSystem *jobs,
+                  VkDeviceSize uploadBudget,
+                  Downsampler *downsampler);
+        void destroy();
+
+        TextureHandle load(const std::string &path);
+        TextureHandle reload(const std::string &path);
+        void update(VkCommandBuffer cmd, uint32_t frameIndex);
+
+        const Texture &get(TextureHandle handle) const;
+        bool is_usable(TextureHandle handle) const;
+        VkSampler get_sampler() const { return _sampler; }
+        bool is_bc_supported() const { return _bcSupported; }
+        VkDeviceSize get_memory_bytes() const;
+        VkDeviceSize get_uncompressed_bytes() const;
+        //! Decodes or uploads are still outstanding
+        bool has_pending_work();
+        void draw_imgui();
+
+       private:
+        enum class UploadStage {
+            MipTail,
+            Full,
+        };
+        struct DecodedTexture {
+            TextureHandle handle;
+            uint64_t contentHash;
+            TextureHandle aliasOf{INVALID_TEXTURE};
+            bool failed{false};
+            UploadStage stage{UploadStage::MipTail};
+            VkFormat format{VK_FORMAT_R8G8B8A8_UNORM};
+            VkExtent2D extent;
+            uint32_t mipLevels{1};
+            uint32_t tailMip{0};
+            bool generateMips{false};
+            std::vector<std::vector<uint8_t>> levels{};  // indexed by mip, empty levels are generated on the GPU
+        };
+
+        VkDevice _device;
+        VmaAllocator _allocator;
+        VkSampler _sampler;
+        VkDeviceSize _uploadBudget;
+        bool _bcSupported{false};
+        JobSystem *_jobs;
+        JobCounter _decodeJobs;
+        Downsampler *_downsampler{nullptr};
+
+        std::vector<Texture> _textures{};
+        std::unordered_map<std::string, TextureHandle> _pathLookup{};
+
+        std::mutex _cacheMutex;
+        std::unordered_map<std::string, TextureHandle> _cache{};
+
+        std::mutex _decodedMutex;
+        std::deque<DecodedTexture> _decoded{};
+        std::deque<DecodedTexture> _pendingUploads{};
+
+        std::vector<std::vector<std::function<void()>>> _pendingFrees{};
+        uint64_t _uploadedBytes{0};
+
+        TextureHandle request(const std::string &path);
+        void decode(TextureHandle handle, const std::string &path);
+        bool decode_image(DecodedTexture &decoded, const std::string &path, const std::vector<uint8_t> &bytes);
+        bool decode_ktx2(DecodedTexture &decoded, const std::string &path, const std::vector<uint8_t> &bytes);
+        VkDeviceSize get_stage_bytes(const DecodedTexture &decoded) const;
+        VkImageUsageFlags get_usage(VkFormat format) const;
+        void upload(VkCommandBuffer cmd, uint32_t frameSlot, DecodedTexture &decoded);
+        void recreate_view(Texture &texture, uint32_t frameSlot);
+        std::function<void()> move(TextureHandle handle, VkCommandBuffer cmd, VmaAllocation destination);
+    };
+}  // namespace bluevk
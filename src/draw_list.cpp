@@ -0,0 +1,99 @@
+#include <draw_list.hpp>
+
+#include <algorithm>
+
+namespace bluevk {
+    //! Below this many requests per chunk the jobs cost more than they save
+    constexpr uint32_t MIN_PARALLEL_SORT_CHUNK = 4096;
+
+    DrawKey pack_draw_key(uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh) {
+        return ((DrawKey)(pipeline & 0xFFFFF) << 44) |
+               ((DrawKey)(descriptorSet & 0xFFFFF) << 24) |
+               (DrawKey)(mesh & 0xFFFFFF);
+    }
+
+    void DrawList::clear() {
+        _requests.clear();
+    }
+    void DrawList::add(uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, uint32_t objectIndex) {
+        _requests.push_back(DrawRequest{
+            .key = pack_draw_key(pipeline, descriptorSet, mesh),
+            .objectIndex = objectIndex,
+        });
+    }
+    void DrawList::resize(uint32_t count) {
+        _requests.resize(count);
+    }
+    void DrawList::set(uint32_t index, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, uint32_t objectIndex) {
+        _requests[index] = DrawRequest{
+            .key = pack_draw_key(pipeline, descriptorSet, mesh),
+            .objectIndex = objectIndex,
+        };
+    }
+    //! Object index as the tie breaker keeps the instance order stable between frames
+    bool DrawList::request_less(const DrawRequest &a, const DrawRequest &b) {
+        return a.key < b.key || (a.key == b.key && a.objectIndex < b.objectIndex);
+    }
+    void DrawList::build() {
+        std::sort(_requests.begin(), _requests.end(), request_less);
+        build_batches();
+    }
+    void DrawList::build(JobSystem &jobs) {
+        uint32_t count = (uint32_t)_requests.size();
+        uint32_t chunkCount = std::min(jobs.get_active_thread_count(), count / MIN_PARALLEL_SORT_CHUNK);
+        if (chunkCount <= 1) {
+            build();
+            return;
+        }
+
+        uint32_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        JobCounter counter{};
+        for (uint32_t begin = 0; begin < count; begin += chunkSize) {
+            uint32_t end = std::min(begin + chunkSize, count);
+            jobs.schedule([this, begin, end]() {
+                std::sort(_requests.begin() + begin, _requests.begin() + end, request_less);
+            },
+                          &counter);
+        }
+        jobs.wait(counter);
+
+        //! Every pass merges neighbouring sorted runs, doubling their length
+        for (uint32_t width = chunkSize; width < count; width *= 2) {
+            for (uint32_t begin = 0; begin + width < count; begin += 2 * width) {
+                uint32_t middle = begin + width;
+                uint32_t end = std::min(begin + 2 * width, count);
+                jobs.schedule([this, begin, middle, end]() {
+                    std::inplace_merge(_requests.begin() + begin,
+                                       _requests.begin() + middle,
+                                       _requests.begin() + end,
+                                       request_less);
+                },
+                              &counter);
+            }
+            jobs.wait(counter);
+        }
+        build_batches();
+    }
+    void DrawList::build_batches() {
+        _batches.clear();
+        _candidates.clear();
+        _candidates.reserve(_requests.size());
+        for (uint32_t i = 0; i < _requests.size(); i++) {
+            const DrawRequest &request = _requests[i];
+            if (i == 0 || request.key != _requests[i - 1].key) {
+                _batches.push_back(DrawBatch{
+                    .pipeline = (uint32_t)(request.key >> 44),
+                    .descriptorSet = (uint32_t)(request.key >> 24) & 0xFFFFF,
+                    .mesh = (uint32_t)request.key & 0xFFFFFF,
+                    .firstInstance = i,
+                    .maxInstanceCount = 0,
+                });
+            }
+            _batches.back().maxInstanceCount++;
+            _candidates.push_back(GPUDrawCandidate{
+                .objectIndex = request.objectIndex,
+                .batchIndex = (uint32_t)_batches.size() - 1,
+            });
+        }
+    }
+}  // namespace bluevk
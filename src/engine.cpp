@@ -2,8 +2,14 @@
 #include <vk_mem_alloc.h>
 
 #include <engine.hpp>
+#include <vk_dispatch.hpp>
 
 #include <thread>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <limits>
 
 #include <imgui.h>
 #include <imgui-SFML.h>
@@ -12,8 +18,11 @@
 #include <VkBootstrap.h>
 
 #include <vk_builders.hpp>
+#include <vk_buffers.hpp>
 #include <vk_initializers.hpp>
 #include <vk_images.hpp>
+#include <mesh_lod.hpp>
+#include <mesh_optimize.hpp>
 
 namespace bluevk {
     BlueVKEngine *BlueVKEngine::Engine = nullptr;
@@ -32,126 +41,394 @@ namespace bluevk {
     void BlueVKEngine::Shutdown() {
         delete Engine;
     }
+    static uint32_t get_draw_format_size(VkFormat format) {
+        return format == VK_FORMAT_R16G16B16A16_SFLOAT ? 8 : 4;
+    }
+    //! Radical inverse of index in the given base, low discrepancy in [0, 1)
+    static float halton(uint32_t index, uint32_t base) {
+        float result = 0.0f;
+        float fraction = 1.0f;
+        while (index > 0) {
+            fraction /= base;
+            result += fraction * (index % base);
+            index /= base;
+        }
+        return result;
+    }
     void BlueVKEngine::run() {
         sf::Clock deltaClock{};
         sf::Event event;
-        bool render = true;
-        while (_window.isOpen()) {
-            float dt = deltaClock.getElapsedTime().asSeconds();
+        start_render_thread();
+        while (!_quitRequested) {
+            //! Waits for the render thread to finish the frame before the previous one, input is sampled after
+            FramePacket *packet = acquire_packet();
+            if (packet == nullptr) {
+                break;
+            }
+            bool idle = is_idle();
+            if (idle) {
+                wait_idle();
+            } else {
+                limit_frame_rate();
+            }
+            float dt = deltaClock.restart().asSeconds();
             while (_window.pollEvent(event)) {
-                ImGui::SFML::ProcessEvent(event);
-
-                switch (event.type) {
-                    case sf::Event::Closed: {
-                        _window.close();
-                        render = false;
-                    } break;
-                    case sf::Event::KeyPressed:
-                        switch (event.key.code) {
-                            case sf::Keyboard::Escape: {
-                                _window.close();
-                                render = false;
-                            } break;
-                            default:
-                                break;
-                        }
-                        break;
-                    case sf::Event::LostFocus:
-                        _freezRendering = true;
-                        break;
-                    case sf::Event::GainedFocus:
-                        _freezRendering = false;
-                        break;
-                    default:
-                        break;
-                }
+                handle_event(event);
             }
-            if (_freezRendering) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
-            } else if (render) {
-                if (_resizeRequested) {
-                    resize_swapchain();
+            packet->inputTime = std::chrono::high_resolution_clock::now();
+            packet->deltaTime = dt;
+            _lastFrameStart = packet->inputTime;
+            if (_quitRequested) {
+                break;
+            }
+
+            if (_autoOrbit) {
+                _frameState.camera.yaw = std::remainder(_frameState.camera.yaw + dt * 0.2f, 2.0f * 3.14159265f);
+            }
+            if (!idle) {
+                //! Idle frames include the time spent waiting for events
+                _profiler.set_timing("CPU Frame", dt * 1000.0);
+            }
+            {
+                std::lock_guard<std::mutex> lock{_statusMutex};
+                _status = _publishedStatus;
+            }
+
+            ImGui_ImplVulkan_NewFrame();
+            ImGui::NewFrame();
+            build_ui();
+            ImGui::EndFrame();
+            ImGui::Render();
+
+            sf::Vector2u windowSize = _window.getSize();
+            packet->windowExtent = VkExtent2D{windowSize.x, windowSize.y};
+            packet->state = _frameState;
+            packet->commands.swap(_renderCommands);
+            packet->imgui.capture(ImGui::GetDrawData());
+            publish_packet();
+
+            if (_maxFrames > 0 && _packetsWritten.load(std::memory_order_relaxed) >= _maxFrames) {
+                _quitRequested = true;
+            }
+        }
+        //! The surface belongs to the window, it is only closed once the render thread stopped presenting
+        stop_render_thread();
+        _window.close();
+        if (_renderError) {
+            std::rethrow_exception(_renderError);
+        }
+    }
+    void BlueVKEngine::build_ui() {
+        if (ImGui::Begin("Background")) {
+            ImGui::SliderFloat("Render Scale", &_frameState.renderScale, 0.3f, 1.f);
+            ImGui::Text("Draw Format: %s", string_VkFormat(_drawFormat));
+            ImGui::Checkbox("Temporal Upscale", &_frameState.temporalUpscale);
+            ImGui::Checkbox("Composite Present", &_frameState.compositePresent);
+            if (_frameState.compositePresent) {
+                ImGui::SliderFloat("Exposure", &_frameState.exposure, 0.1f, 4.0f);
+                ImGui::Combo("Tonemapper", &_frameState.tonemapper, "None\0Reinhard\0ACES\0");
+                if (_downsampleSupported) {
+                    ImGui::Checkbox("Bloom", &_frameState.bloom);
+                    ImGui::SliderFloat("Bloom Intensity", &_frameState.bloomIntensity, 0.0f, 0.2f);
                 }
+            }
 
-                ImGui_ImplVulkan_NewFrame();
-                ImGui::NewFrame();
+            const ComputeEffect &selected = _computeEffects[_frameState.computeEffect];
+            ComputeEffect::ComputePushConstants &data = _frameState.effectData[_frameState.computeEffect];
 
-                if (ImGui::Begin("Background")) {
-                    ImGui::SliderFloat("Render Scale", &_renderScale, 0.3f, 1.f);
+            ImGui::Text("Selected effect: %s", selected.name);
 
-                    ComputeEffect &selected = _computeEffects[_currentComputeEffect];
+            ImGui::SliderInt("Effect Index", &_frameState.computeEffect, 0, _computeEffects.size() - 1);
+            ImGui::Text("Update: %s", selected.update == EFFECT_STATIC ? "static" : "time dependent");
+            ImGui::Checkbox("Cache Static Background", &_frameState.cacheBackground);
 
-                    ImGui::Text("Selected effect: %s", selected.name);
+            ImGui::InputFloat4("data1", (float *)&data.data1);
+            ImGui::InputFloat4("data2", (float *)&data.data2);
+            ImGui::InputFloat4("data3", (float *)&data.data3);
+            ImGui::InputFloat4("data4", (float *)&data.data4);
 
-                    ImGui::SliderInt("Effect Index", &_currentComputeEffect, 0, _computeEffects.size() - 1);
+            ImGui::End();
+        }
 
-                    ImGui::InputFloat4("data1", (float *)&selected.data.data1);
-                    ImGui::InputFloat4("data2", (float *)&selected.data.data2);
-                    ImGui::InputFloat4("data3", (float *)&selected.data.data3);
-                    ImGui::InputFloat4("data4", (float *)&selected.data.data4);
+        if (ImGui::Begin("Scene")) {
+            ImGui::Text("Objects: %u in %u batches", _objectCount, _status.drawBatches);
+            ImGui::Checkbox("Depth Pre-pass", &_frameState.depthPrepass);
+            ImGui::Checkbox("Occlusion Culling", &_frameState.occlusionCulling);
+            ImGui::Checkbox("Mesh LODs", &_frameState.meshLods);
+            ImGui::SliderFloat("LOD Error (px)", &_frameState.lodErrorPixels, 0.25f, 8.0f);
+            if (_maxParticles > 0) {
+                ImGui::Separator();
+                ImGui::Text("Particle Pool: %u", _maxParticles);
+                ImGui::Checkbox("Particles", &_frameState.particles);
+                ImGui::Checkbox("Sort Particles", &_frameState.particleSorting);
+                ImGui::SliderFloat("Emit Rate (/s)", &_frameState.particleEmitRate, 0.0f, 1000000.0f, "%.0f");
+                ImGui::SliderFloat("Particle Lifetime (s)", &_frameState.particleLifetime, 0.5f, 10.0f);
+                ImGui::Separator();
+            }
+            if (_animatedInstanceCount > 0) {
+                ImGui::Text("Skinned Instances: %u x %u vertices", _animatedInstanceCount, _skinVertexCount);
+                ImGui::Checkbox("Animate", &_frameState.animate);
+                ImGui::Separator();
+            }
+            ImGui::Checkbox("Shadows", &_frameState.shadows);
+            ImGui::Checkbox("Cache Static Shadows", &_frameState.cacheShadows);
+            ImGui::SliderFloat("Light Yaw", &_frameState.lightYaw, -3.14159f, 3.14159f);
+            ImGui::SliderFloat("Light Pitch", &_frameState.lightPitch, 0.2f, 1.5f);
+            ImGui::Separator();
+            ImGui::Checkbox("Auto Orbit", &_autoOrbit);
+            ImGui::SliderFloat("Yaw", &_frameState.camera.yaw, -3.14159f, 3.14159f);
+            ImGui::SliderFloat("Pitch", &_frameState.camera.pitch, -1.5f, 1.5f);
+            ImGui::SliderFloat("Distance", &_frameState.camera.distance, 5.0f, 200.0f);
+        }
+        ImGui::End();
 
-                    ImGui::End();
-                }
+        if (ImGui::Begin("Jobs")) {
+            int activeThreads = (int)_jobs.get_active_thread_count();
+            ImGui::Text("Threads: %u (%s + %u workers)",
+                        _jobs.get_thread_count(),
+                        _renderThreadEnabled ? "render thread" : "main",
+                        _jobs.get_thread_count() - 1);
+            if (ImGui::SliderInt("Active Threads", &activeThreads, 1, (int)_jobs.get_thread_count())) {
+                _jobs.set_active_thread_count((uint32_t)activeThreads);
+            }
+            ImGui::Checkbox("Parallel Recording", &_frameState.parallelRecording);
+            ImGui::Checkbox("Cache Recorded Passes", &_frameState.cacheCommands);
+            if (ImGui::Button("Measure Scaling")) {
+                _renderCommands.push_back([this]() { measure_job_scaling(); });
+            }
+            const std::vector<double> &jobScaling = _status.jobScaling;
+            for (uint32_t i = 0; i < jobScaling.size(); i++) {
+                ImGui::Text("%u thread(s): %.3f ms (%.2fx)", i + 1, jobScaling[i], jobScaling[0] / jobScaling[i]);
+            }
+        }
+        ImGui::End();
 
-                ImGui::EndFrame();
-                ImGui::Render();
+        if (ImGui::Begin("Presentation")) {
+            if (ImGui::BeginCombo("Present Mode", string_VkPresentModeKHR(_frameState.presentMode))) {
+                for (VkPresentModeKHR mode : _status.supportedPresentModes) {
+                    if (ImGui::Selectable(string_VkPresentModeKHR(mode), mode == _frameState.presentMode)) {
+                        _frameState.presentMode = mode;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            int imageCount = (int)_frameState.swapchainImageCount;
+            if (ImGui::SliderInt("Swapchain Images", &imageCount, 2, 4)) {
+                _frameState.swapchainImageCount = (uint32_t)imageCount;
+            }
+            ImGui::Text("Images: %u, %s", _status.swapchainImages, string_VkPresentModeKHR(_status.presentMode));
+            if (_presentWait) {
+                int maxQueuedPresents = (int)_frameState.maxQueuedPresents;
+                if (ImGui::SliderInt("Max Queued Presents", &maxQueuedPresents, 1, 3)) {
+                    _frameState.maxQueuedPresents = (uint32_t)maxQueuedPresents;
+                }
+            } else {
+                ImGui::Text("No VK_KHR_present_wait, frames are not paced");
+            }
+            ImGui::Text("Input to present call: %.2f ms", _status.inputToPresentCall);
+            if (_presentWait) {
+                ImGui::Text("Input to presented: %.2f ms", _status.inputToPresented);
+            }
+            ImGui::SliderFloat("Frame Rate Limit", &_frameRateLimit, 0.0f, 240.0f, _frameRateLimit > 0.0f ? "%.0f fps" : "Off");
+            ImGui::Checkbox("Idle When Unfocused", &_idleWhenUnfocused);
+            ImGui::SliderFloat("Idle Frame Rate", &_idleFrameRate, 0.0f, 30.0f, _idleFrameRate > 0.0f ? "%.1f fps" : "Events Only");
+        }
+        ImGui::End();
 
-                draw();
+        if (ImGui::Begin("Capture")) {
+            if (ImGui::Button("Screenshot")) {
+                std::filesystem::create_directories(_captureDirectory);
+                _renderCommands.push_back([this]() { _captureFramesLeft = 1; });
+            }
+            ImGui::SliderInt("Frames", &_captureFrameCount, 1, 600);
+            if (ImGui::Button(_status.captureFramesLeft > 0 ? "Stop" : "Record")) {
+                std::filesystem::create_directories(_captureDirectory);
+                uint32_t frames = _status.captureFramesLeft > 0 ? 0 : (uint32_t)_captureFrameCount;
+                _renderCommands.push_back([this, frames]() { _captureFramesLeft = frames; });
             }
+            ImGui::Text("Directory: %s", _captureDirectory.c_str());
+            ImGui::Text("Slots in flight: %u / %u", _readback.get_slots_in_flight(), READBACK_SLOTS);
+            ImGui::Text("Written: %llu, pending: %llu, dropped: %llu",
+                        (unsigned long long)_readback.get_written_count(),
+                        (unsigned long long)_readback.get_pending_writes(),
+                        (unsigned long long)_readback.get_dropped_count());
+            ImGui::Separator();
+            ImGui::Text("Right click to pick");
+            if (_status.pickValid) {
+                ImGui::Text("Depth: %.6f", _status.pickDepth);
+                ImGui::Text("World: %.2f %.2f %.2f", _status.pickWorldPosition.x, _status.pickWorldPosition.y, _status.pickWorldPosition.z);
+            }
+        }
+        ImGui::End();
+
+        {
+            std::lock_guard<std::mutex> lock{_statusMutex};
+            _textureCache.draw_imgui();
+            _memoryTracker.draw_imgui();
         }
+        _profiler.draw_imgui();
     }
     BlueVKEngine::BlueVKEngine(BlueVKEngineParams &params) {
+        _startupStart = std::chrono::high_resolution_clock::now();
         fmt::println("Constructoring BlueVKEngine!");
         _windowSize = params.windowSize;
         _windowTitle = params.windowTitle;
         _isResizable = params.isResizable;
+        _sceneObjectsPerAxis = params.sceneObjectsPerAxis;
+        _sceneLayerCount = params.sceneLayerCount;
+        _drawFormatPolicy = params.drawFormatPolicy;
+        _texturePaths = params.texturePaths;
+        _jobWorkerCount = params.jobWorkerCount;
+        _textureUploadBudget = params.textureUploadBudget;
+        _validationLevel = params.validationLevel;
+        _debugLabels = params.debugLabels;
+        _requestedPresentMode = params.presentMode;
+        _swapchainImageCount = params.swapchainImageCount;
+        _maxQueuedPresents = std::max(params.maxQueuedPresents, 1u);
+        _maxFrames = params.maxFrames;
+        _frameRateLimit = std::max(params.frameRateLimit, 0.0f);
+        _idleFrameRate = std::max(params.idleFrameRate, 0.0f);
+        _idleWhenUnfocused = params.idleWhenUnfocused;
+        _renderThreadEnabled = params.renderThread;
+        _maxParticles = params.maxParticles;
+        _animatedInstanceCount = params.animatedInstances;
+        init_jobs();
+
+        //! Everything past the device only needs the device, pipelines compile while the swapchain,
+        //! command pools and ImGui's font texture are created. Steps that submit to the graphics queue
+        //! (ImGui's font upload, the scene uploads) are ordered since the queue isn't externally synchronized
+        InitGraph graph{};
+        InitGraph::StepId instance = graph.add("Instance", [this]() { init_instance(); });
+        InitGraph::StepId window = graph.add_main_thread("Window", [this]() { init_window(); });
+        InitGraph::StepId device = graph.add_main_thread("Device", [this]() { init_device(); }, {instance, window});
+        InitGraph::StepId swapchain = graph.add("Swapchain", [this]() { init_swapchain(); }, {device});
+        InitGraph::StepId commands = graph.add("Commands", [this]() { init_commands(); }, {device});
+        InitGraph::StepId sync = graph.add("Sync Structures", [this]() { init_sync_structures(); }, {device});
+        InitGraph::StepId imgui = graph.add("ImGui", [this]() { init_imgui(); }, {device});
+        InitGraph::StepId descriptors = graph.add("Descriptors", [this]() { init_descriptors(); }, {device});
+        InitGraph::StepId drawImageDescriptors = graph.add("Draw Image Descriptors", [this]() { update_draw_image_descriptors(); }, {swapchain, descriptors});
+        //! Shader loading and pipeline compilation are independent, every pipeline group is its own step
+        graph.add("Pipelines: Gradient", [this]() { init_pipelines_gradient(); }, {descriptors});
+        graph.add("Pipelines: Triangle", [this]() { init_pipelines_triangle(); }, {descriptors});
+        graph.add("Pipelines: Depth Reduce", [this]() { init_pipelines_depth_reduce(); }, {descriptors});
+        graph.add("Pipelines: Cull", [this]() { init_pipelines_cull(); }, {descriptors});
+        graph.add("Pipelines: Mesh", [this]() { init_pipelines_mesh(); }, {descriptors});
+        graph.add("Pipelines: Composite", [this]() { init_pipelines_composite(); }, {descriptors});
+        graph.add("Pipelines: Upscale", [this]() { init_pipelines_upscale(); }, {descriptors});
+        graph.add("Pipelines: Particles", [this]() { init_pipelines_particles(); }, {descriptors});
+        graph.add("Pipelines: Skinning", [this]() { init_pipelines_skinning(); }, {descriptors});
+        graph.add("Pipelines: Shadows", [this]() { init_pipelines_shadows(); }, {descriptors});
+        InitGraph::StepId profiler = graph.add("Profiler", [this]() { init_profiler(); }, {device});
+        InitGraph::StepId benchmark = graph.add("Dispatch Benchmark", [this]() { benchmark_dispatch(); }, {commands, profiler});
+        InitGraph::StepId scene = graph.add("Scene", [this]() { init_scene(); }, {commands, sync, imgui, benchmark});
+        InitGraph::StepId particles = graph.add("Particles", [this]() { init_particles(); }, {scene});
+        graph.add("Shadows", [this]() { init_shadows(); }, {scene, descriptors, drawImageDescriptors, particles});
+        graph.add("Textures", [this]() { init_textures(); }, {device});
+        graph.add("Memory", [this]() { init_memory(); }, {device});
+        graph.add("Readback", [this]() { init_readback(); }, {device});
+        graph.run(_jobs);
+
+        graph.print_timeline();
+        _profiler.set_counter("Startup: Init (ms)", graph.get_duration());
+        _profiler.set_counter("Startup: Init Serial (ms)", graph.get_serial_duration());
+    }
+    BlueVKEngine::~BlueVKEngine() {
+        fmt::println("Destroying BlueVKEngine!");
+        vkd.vkDeviceWaitIdle(_device);
+        _profiler.print_report();
+        _memoryTracker.print_report();
+        _mainDeletionQueue.flush();
+        _jobs.shutdown();
+    }
+    void BlueVKEngine::init_jobs() {
+        uint32_t workerCount = _jobWorkerCount;
+        if (workerCount == 0) {
+            workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        }
+        _jobs.init(workerCount);
+        fmt::println("[BlueVK]::[JOBS]: {} worker threads", workerCount);
+    }
+    void BlueVKEngine::init_window() {
         _window.create(sf::VideoMode{_windowSize.width, _windowSize.height},
                        _windowTitle,
                        _isResizable
                            ? sf::Style::Default
                            : sf::Style::Close | sf::Style::Titlebar,
                        sf::ContextSettings(0));
-        init_vulkan();
-        init_swapchain();
-        init_commands();
-        init_sync_structures();
-        init_imgui();
-        init_descriptors();
-        init_pipelines();
-    }
-    BlueVKEngine::~BlueVKEngine() {
-        fmt::println("Destroying BlueVKEngine!");
-        vkDeviceWaitIdle(_device);
-        _mainDeletionQueue.flush();
+        //! ImGui-SFML creates its textures through SFML, it stays on the thread that owns the window
+        if (!ImGui::SFML::Init(_window)) {
+            throw std::runtime_error(fmt::format("[BlueVK]::[ERROR]: Failed to init ImGui for SFML window!\n"));
+        }
+        ImGui::CreateContext();
+        ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+        _mainDeletionQueue.push_back([&]() {
+            ImGui::SFML::Shutdown();
+            ImGui::DestroyContext();
+        });
     }
-    void BlueVKEngine::init_vulkan() {
-        vkb::Result<vkb::Instance> instanceReturn =
-            vkb::InstanceBuilder{}
-                .set_app_name(_windowTitle.c_str())
-                .set_engine_name("BlueVK Engine")
-                .require_api_version(1, 3, 0)
-                .request_validation_layers(true)
-                .use_default_debug_messenger()
-                .build();
+    void BlueVKEngine::init_instance() {
+        vkb::InstanceBuilder instanceBuilder{};
+        instanceBuilder.set_app_name(_windowTitle.c_str())
+            .set_engine_name("BlueVK Engine")
+            .require_api_version(1, 3, 0);
+#if BLUEVK_DEBUG_TOOLS
+        if (_validationLevel != VALIDATION_NONE) {
+            instanceBuilder.request_validation_layers(true)
+                .use_default_debug_messenger();
+            if (_validationLevel == VALIDATION_SYNCHRONIZATION) {
+                instanceBuilder.add_validation_feature_enable(VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT);
+            }
+        } else if (_debugLabels) {
+            //! The messenger enables debug utils by itself, labels alone only need the extension
+            vkb::Result<vkb::SystemInfo> systemInfo = vkb::SystemInfo::get_system_info();
+            _debugLabels = systemInfo.has_value() && systemInfo.value().debug_utils_available;
+            if (_debugLabels) {
+                instanceBuilder.enable_extension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+            }
+        }
+#else
+        _validationLevel = VALIDATION_NONE;
+        _debugLabels = false;
+#endif
+        vkb::Result<vkb::Instance> instanceReturn = instanceBuilder.build();
         if (!instanceReturn.has_value()) {
             throw std::runtime_error(fmt::format("[BlueVK]::[ERROR]: Failed to create a vulkan instance!"));
         }
-        vkb::Instance vkbInstance = instanceReturn.value();
-        _instance = vkbInstance;
-        _debugMessenger = vkbInstance.debug_messenger;
+        _vkbInstance = instanceReturn.value();
+        _instance = _vkbInstance.instance;
+        _debugMessenger = _vkbInstance.debug_messenger;
+        fmt::println("[BlueVK]::[CONFIG]: Validation {}, debug labels {}, VK_CHECK level {}",
+                     _validationLevel == VALIDATION_NONE       ? "off"
+                     : _validationLevel == VALIDATION_STANDARD ? "standard"
+                                                               : "standard + synchronization",
+                     _debugLabels ? "on" : "off",
+                     BLUEVK_VK_CHECK_LEVEL);
+        _mainDeletionQueue.push_back([&]() {
+            if (_debugMessenger != VK_NULL_HANDLE) {
+                vkb::destroy_debug_utils_messenger(_instance, _debugMessenger);
+            }
+            vkDestroyInstance(_instance, nullptr);
+        });
+    }
+    void BlueVKEngine::init_device() {
         _window.createVulkanSurface(_instance, _surface);
         VkPhysicalDeviceVulkan13Features features13{
             .synchronization2 = true,
             .dynamicRendering = true,
         };
         VkPhysicalDeviceVulkan12Features features12{
+            .drawIndirectCount = true,
             .descriptorIndexing = true,
             .bufferDeviceAddress = true,
         };
+        VkPhysicalDeviceFeatures features{
+            .multiDrawIndirect = true,
+            .drawIndirectFirstInstance = true,
+        };
         vkb::Result<vkb::PhysicalDevice> physicalDeviceReturn =
-            vkb::PhysicalDeviceSelector{vkbInstance}
+            vkb::PhysicalDeviceSelector{_vkbInstance}
                 .set_minimum_version(1, 3)
+                .set_required_features(features)
                 .set_required_features_13(features13)
                 .set_required_features_12(features12)
                 .set_surface(_surface)
@@ -161,6 +438,44 @@ namespace bluevk {
                                                  physicalDeviceReturn.error().value()));
         }
         vkb::PhysicalDevice vkbPhysicalDevice = physicalDeviceReturn.value();
+        //! Optional, KTX2 textures are decoded to RGBA8 on the CPU without it
+        _textureCompressionBC = vkbPhysicalDevice.enable_features_if_present(VkPhysicalDeviceFeatures{
+            .textureCompressionBC = true,
+        });
+        //! Needed to write packed float draw images from compute shaders
+        _storageImageExtendedFormats = vkbPhysicalDevice.enable_features_if_present(VkPhysicalDeviceFeatures{
+            .shaderStorageImageExtendedFormats = true,
+        });
+        //! Optional, the single pass downsampler reduces 2x2 blocks with quad operations and picks its
+        //! destination mip from an image array. Textures fall back to blits and bloom is off without it.
+        VkPhysicalDeviceSubgroupProperties subgroupProperties{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
+        };
+        VkPhysicalDeviceProperties2 properties2{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &subgroupProperties,
+        };
+        vkGetPhysicalDeviceProperties2(vkbPhysicalDevice.physical_device, &properties2);
+        _downsampleSupported = (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+                               (subgroupProperties.supportedOperations & VK_SUBGROUP_FEATURE_QUAD_BIT) &&
+                               vkbPhysicalDevice.enable_features_if_present(VkPhysicalDeviceFeatures{
+                                   .shaderStorageImageArrayDynamicIndexing = true,
+                               });
+        if (!_downsampleSupported) {
+            fmt::println("[BlueVK]::[WARNING]: Compute subgroup quad operations are not supported, mips are generated with blits and bloom is disabled");
+        }
+        _memoryBudgetExtension = vkbPhysicalDevice.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        //! Optional, frames are only paced by the frame fence without it (lavapipe, most X11 setups)
+        _presentWait = vkbPhysicalDevice.enable_extension_if_present(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+                       vkbPhysicalDevice.enable_extension_if_present(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) &&
+                       vkbPhysicalDevice.enable_extension_features_if_present(VkPhysicalDevicePresentIdFeaturesKHR{
+                           .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+                           .presentId = true,
+                       }) &&
+                       vkbPhysicalDevice.enable_extension_features_if_present(VkPhysicalDevicePresentWaitFeaturesKHR{
+                           .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+                           .presentWait = true,
+                       });
         vkb::Result<vkb::Device> deviceReturn = vkb::DeviceBuilder{vkbPhysicalDevice}.build();
         if (!deviceReturn.has_value()) {
             throw std::runtime_error(fmt::format("[BlueVK]::[ERROR]: Failed to build device:\n{}",
@@ -169,6 +484,8 @@ namespace bluevk {
         vkb::Device vkbDevice = deviceReturn.value();
         _physicalDevice = vkbPhysicalDevice;
         _device = vkbDevice;
+        vkd.load(_device);
+        _presentWait &= vkd.vkWaitForPresentKHR != nullptr;
         _graphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
         _graphicsQueueIndex = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
         VmaAllocatorCreateInfo allocatorInfo{
@@ -176,31 +493,46 @@ namespace bluevk {
             .physicalDevice = _physicalDevice,
             .device = _device,
             .instance = _instance,
+            .vulkanApiVersion = VK_API_VERSION_1_3,
         };
+        if (_memoryBudgetExtension) {
+            allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        }
         vmaCreateAllocator(&allocatorInfo, &_vmaAllocator);
+        select_formats();
         _mainDeletionQueue.push_back([&]() {
             vmaDestroyAllocator(_vmaAllocator);
             vkDestroySurfaceKHR(_instance, _surface, nullptr);
-            vkDestroyDevice(_device, nullptr);
-            destroy_draw_images();
-            destroy_swapchain();
-            vkb::destroy_debug_utils_messenger(_instance, _debugMessenger);
-            vkDestroyInstance(_instance, nullptr);
+            vkd.vkDestroyDevice(_device, nullptr);
         });
     }
     void BlueVKEngine::init_swapchain() {
         create_swapchain(_windowSize);
         create_draw_images();
+        _mainDeletionQueue.push_back([&]() {
+            destroy_draw_images();
+            destroy_swapchain();
+        });
     }
     void BlueVKEngine::init_commands() {
         CommandPoolBuilder poolBuilder = CommandPoolBuilder{}
                                              .set_create_flags(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)
                                              .set_queue_family_index(_graphicsQueueIndex);
+        CommandPoolBuilder threadPoolBuilder = CommandPoolBuilder{}
+                                                   .set_create_flags(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT)
+                                                   .set_queue_family_index(_graphicsQueueIndex);
         for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
             _frames[i]._commandPool = poolBuilder.build(_device);
             _frames[i]._mainCommandBuffer = CommandBufferAllocator{}
                                                 .set_command_pool(_frames[i]._commandPool)
                                                 .allocate(_device);
+            _frames[i]._threadCommandPools.resize(_jobs.get_thread_count());
+            for (ThreadCommandPool &threadPool : _frames[i]._threadCommandPools) {
+                threadPool.pool = threadPoolBuilder.build(_device);
+            }
+            for (CommandCache &cache : _frames[i]._scenePassCommands) {
+                cache.init(_device, _graphicsQueueIndex);
+            }
         }
         _immCommandPool = poolBuilder.build(_device);
         _immCommandBuffer = CommandBufferAllocator{}
@@ -208,9 +540,15 @@ namespace bluevk {
                                 .allocate(_device);
         _mainDeletionQueue.push_back([&]() {
             for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
-                vkDestroyCommandPool(_device, _frames[i]._commandPool, nullptr);
+                vkd.vkDestroyCommandPool(_device, _frames[i]._commandPool, nullptr);
+                for (ThreadCommandPool &threadPool : _frames[i]._threadCommandPools) {
+                    vkd.vkDestroyCommandPool(_device, threadPool.pool, nullptr);
+                }
+                for (CommandCache &cache : _frames[i]._scenePassCommands) {
+                    cache.destroy();
+                }
             }
-            vkDestroyCommandPool(_device, _immCommandPool, nullptr);
+            vkd.vkDestroyCommandPool(_device, _immCommandPool, nullptr);
         });
     }
     void BlueVKEngine::init_sync_structures() {
@@ -223,11 +561,11 @@ namespace bluevk {
         _immFence = fenceBuilder.build(_device);
         _mainDeletionQueue.push_back([&]() {
             for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
-                vkDestroyFence(_device, _frames[i]._renderFence, nullptr);
-                vkDestroySemaphore(_device, _frames[i]._renderSemaphore, nullptr);
-                vkDestroySemaphore(_device, _frames[i]._swapchainSemaphore, nullptr);
+                vkd.vkDestroyFence(_device, _frames[i]._renderFence, nullptr);
+                vkd.vkDestroySemaphore(_device, _frames[i]._renderSemaphore, nullptr);
+                vkd.vkDestroySemaphore(_device, _frames[i]._swapchainSemaphore, nullptr);
             }
-            vkDestroyFence(_device, _immFence, nullptr);
+            vkd.vkDestroyFence(_device, _immFence, nullptr);
         });
     }
     void BlueVKEngine::init_imgui() {
@@ -253,20 +591,15 @@ namespace bluevk {
             .pPoolSizes = poolSizes.data(),
         };
         VkDescriptorPool imguiPool;
-        VK_CHECK(vkCreateDescriptorPool(_device, &poolInfo, nullptr, &imguiPool));
-        if (!ImGui::SFML::Init(_window)) {
-            throw std::runtime_error(fmt::format("[BlueVK]::[ERROR]: Failed to init ImGui for SFML window!\n"));
-        }
-        ImGui::CreateContext();
-        ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+        VK_CHECK(vkd.vkCreateDescriptorPool(_device, &poolInfo, nullptr, &imguiPool));
         ImGui_ImplVulkan_InitInfo initInfo{.Instance = _instance,
                                            .PhysicalDevice = _physicalDevice,
                                            .Device = _device,
                                            .QueueFamily = _graphicsQueueIndex,
                                            .Queue = _graphicsQueue,
                                            .DescriptorPool = imguiPool,
-                                           .MinImageCount = 3,
-                                           .ImageCount = 3,
+                                           .MinImageCount = std::max(_swapchainImageCount, 2u),
+                                           .ImageCount = std::max(_swapchainImageCount, 2u),
                                            .MSAASamples = VK_SAMPLE_COUNT_1_BIT,
                                            .UseDynamicRendering = true,
                                            .ColorAttachmentFormat = _swapchainImageFormat};
@@ -275,47 +608,70 @@ namespace bluevk {
         ImGui_ImplVulkan_CreateFontsTexture();
         _mainDeletionQueue.push_back([&]() {
             //! I think ImGui_ImplVulkan_Shutdown is already
-            // vkDestroyDescriptorPool(_device, _imguiPool, nullptr);
+            // vkd.vkDestroyDescriptorPool(_device, _imguiPool, nullptr);
             ImGui_ImplVulkan_Shutdown();
-            ImGui::SFML::Shutdown();
-            ImGui::DestroyContext();
         });
     }
     void BlueVKEngine::init_descriptors() {
         _drawImageDescriptorLayout = DescriptorSetLayoutBuilder{}
                                          .add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
                                          .build(_device, VK_SHADER_STAGE_COMPUTE_BIT);
+        _depthReduceDescriptorLayout = DescriptorSetLayoutBuilder{}
+                                           .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                                           .add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+                                           .build(_device, VK_SHADER_STAGE_COMPUTE_BIT);
+        _cullDescriptorLayout = DescriptorSetLayoutBuilder{}
+                                    .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                                    .build(_device, VK_SHADER_STAGE_COMPUTE_BIT);
+        _compositeDescriptorLayout = DescriptorSetLayoutBuilder{}
+                                         .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                                         .add_binding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                                         .build(_device, VK_SHADER_STAGE_FRAGMENT_BIT);
+        _upscaleDescriptorLayout = DescriptorSetLayoutBuilder{}
+                                       .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                                       .add_binding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                                       .add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                                       .add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+                                       .build(_device, VK_SHADER_STAGE_COMPUTE_BIT);
+        _shadowDescriptorLayout = DescriptorSetLayoutBuilder{}
+                                      .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                                      .build(_device, VK_SHADER_STAGE_FRAGMENT_BIT);
 
-        std::vector<VkDescriptorPoolSize> sizes = {{.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 10}};
-        _drawImageDescriptorSet = _mainDescriptorAllocator
-                                      .init_pool(_device, 10, sizes)
-                                      .allocate(_device, _drawImageDescriptorLayout);
-
-        VkDescriptorImageInfo imgInfo{
-            .imageView = _drawImage.view,
-            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
-        };
-
-        VkWriteDescriptorSet drawImageWrite{
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .pNext = nullptr,
-            .dstSet = _drawImageDescriptorSet,
-            .dstBinding = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-            .pImageInfo = &imgInfo,
+        std::vector<VkDescriptorPoolSize> sizes = {
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 32},
+            {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 32},
         };
+        _mainDescriptorAllocator.init_pool(_device, 64, sizes);
 
-        vkUpdateDescriptorSets(_device, 1, &drawImageWrite, 0, nullptr);
+        _depthPyramidSampler = SamplerBuilder{}
+                                   .set_filter(VK_FILTER_NEAREST, VK_FILTER_NEAREST)
+                                   .set_mipmap_mode(VK_SAMPLER_MIPMAP_MODE_NEAREST)
+                                   .set_address_mode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE)
+                                   .build(_device);
+        _compositeSampler = SamplerBuilder{}
+                                .set_filter(VK_FILTER_LINEAR, VK_FILTER_LINEAR)
+                                .set_address_mode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE)
+                                .build(_device);
+        //! Reverse-Z: a fragment is lit when it is at least as close to the light as the stored depth
+        _shadowSampler = SamplerBuilder{}
+                             .set_filter(VK_FILTER_LINEAR, VK_FILTER_LINEAR)
+                             .set_address_mode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE)
+                             .set_compare_op(VK_COMPARE_OP_GREATER_OR_EQUAL)
+                             .build(_device);
 
         _mainDeletionQueue.push_back([&]() {
             _mainDescriptorAllocator.destroy_pool(_device);
+            vkd.vkDestroySampler(_device, _shadowSampler, nullptr);
+            vkd.vkDestroyDescriptorSetLayout(_device, _shadowDescriptorLayout, nullptr);
+            vkd.vkDestroySampler(_device, _depthPyramidSampler, nullptr);
+            vkd.vkDestroySampler(_device, _compositeSampler, nullptr);
+            vkd.vkDestroyDescriptorSetLayout(_device, _compositeDescriptorLayout, nullptr);
+            vkd.vkDestroyDescriptorSetLayout(_device, _upscaleDescriptorLayout, nullptr);
+            vkd.vkDestroyDescriptorSetLayout(_device, _drawImageDescriptorLayout, nullptr);
+            vkd.vkDestroyDescriptorSetLayout(_device, _depthReduceDescriptorLayout, nullptr);
+            vkd.vkDestroyDescriptorSetLayout(_device, _cullDescriptorLayout, nullptr);
         });
     }
-    void BlueVKEngine::init_pipelines() {
-        init_pipelines_gradient();
-        init_pipelines_triangle();
-    }
     void BlueVKEngine::init_pipelines_gradient() {
         VkPipelineLayout pipelineLayout = PipelineLayoutBuilder{}
                                               .add_pc_range(VkPushConstantRange{
@@ -325,38 +681,40 @@ namespace bluevk {
                                               })
                                               .add_set_layout(_drawImageDescriptorLayout)
                                               .build(_device);
-        VkShaderModule computeShader = load_shader_module(_device, "assets/shaders/gradient_color.comp.spv");
+        VkShaderModule computeShader = load_shader_module(_device, get_draw_format_shader("gradient_color.comp").c_str());
         VkPipeline gradientPipeline = ComputePipelineBuilder{}
                                           .set_layout(pipelineLayout)
                                           .set_shader(computeShader)
                                           .build(_device);
-        vkDestroyShaderModule(_device, computeShader, nullptr);
+        vkd.vkDestroyShaderModule(_device, computeShader, nullptr);
 
-        computeShader = load_shader_module(_device, "assets/shaders/sky.comp.spv");
+        computeShader = load_shader_module(_device, get_draw_format_shader("sky.comp").c_str());
         VkPipeline skyPipeline = ComputePipelineBuilder{}
                                      .set_layout(pipelineLayout)
                                      .set_shader(computeShader)
                                      .build(_device);
-        vkDestroyShaderModule(_device, computeShader, nullptr);
+        vkd.vkDestroyShaderModule(_device, computeShader, nullptr);
 
         _computeEffects.push_back(ComputeEffect{
             .name = "Gradient Effect",
             .layout = pipelineLayout,
             .pipeline = gradientPipeline,
             .data = {glm::vec4(1, 0, 0, 1), glm::vec4(0, 0, 1, 1)},
+            .update = EFFECT_STATIC,
         });
         _computeEffects.push_back(ComputeEffect{
             .name = "Night Sky Effect",
             .layout = pipelineLayout,
             .pipeline = skyPipeline,
             .data = {glm::vec4(0.1, 0.2, 0.4, 0.97)},
+            .update = EFFECT_STATIC,
         });
 
         _mainDeletionQueue.push_back([&]() {
-            vkDestroyPipelineLayout(_device, _computeEffects[0].layout, nullptr);
+            vkd.vkDestroyPipelineLayout(_device, _computeEffects[0].layout, nullptr);
 
             for (uint32_t i = 0; i < _computeEffects.size(); i++) {
-                vkDestroyPipeline(_device, _computeEffects[i].pipeline, nullptr);
+                vkd.vkDestroyPipeline(_device, _computeEffects[i].pipeline, nullptr);
             }
         });
     }
@@ -375,209 +733,2637 @@ namespace bluevk {
                                 .disable_blending()
                                 .disable_depthtest()
                                 .set_color_attachment_format(_drawImage.format)
-                                .set_depth_format(VK_FORMAT_UNDEFINED)
+                                .set_depth_format(_depthImage.format)
                                 .build(_device);
 
-        vkDestroyShaderModule(_device, vertShader, nullptr);
-        vkDestroyShaderModule(_device, fragShader, nullptr);
+        vkd.vkDestroyShaderModule(_device, vertShader, nullptr);
+        vkd.vkDestroyShaderModule(_device, fragShader, nullptr);
 
         _mainDeletionQueue.push_back([&]() {
-            vkDestroyPipelineLayout(_device, _triangleLayout, nullptr);
-            vkDestroyPipeline(_device, _trianglePipeline, nullptr);
+            vkd.vkDestroyPipelineLayout(_device, _triangleLayout, nullptr);
+            vkd.vkDestroyPipeline(_device, _trianglePipeline, nullptr);
         });
     }
-    void BlueVKEngine::draw() {
-        FrameData &frame = get_current_frame();
+    void BlueVKEngine::init_pipelines_depth_reduce() {
+        _depthReduceLayout = PipelineLayoutBuilder{}
+                                 .add_pc_range(VkPushConstantRange{
+                                     .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                                     .offset = 0,
+                                     .size = sizeof(DepthReducePushConstants),
+                                 })
+                                 .add_set_layout(_depthReduceDescriptorLayout)
+                                 .build(_device);
+        VkShaderModule computeShader = load_shader_module(_device, "assets/shaders/depth_reduce.comp.spv");
+        _depthReducePipeline = ComputePipelineBuilder{}
+                                   .set_layout(_depthReduceLayout)
+                                   .set_shader(computeShader)
+                                   .build(_device);
+        vkd.vkDestroyShaderModule(_device, computeShader, nullptr);
 
-        uint32_t swapchainImageIndex;
-        VkResult nextImageResult = vkAcquireNextImageKHR(_device, _swapchain, 1000000000, frame._swapchainSemaphore, VK_NULL_HANDLE, &swapchainImageIndex);
-        if (nextImageResult == VK_ERROR_OUT_OF_DATE_KHR) {
-            _resizeRequested = true;
-            return;
-        } else {
-            VK_CHECK(nextImageResult);
-        }
-        VkImage swapchainImage = _swapchainImages[swapchainImageIndex];
-        // _drawExtent = _drawImage.extent;
-        _drawExtent.width = std::min(_swapchainExtent.width, _drawImage.extent.width) * _renderScale;
-        _drawExtent.height = std::min(_swapchainExtent.height, _drawImage.extent.height) * _renderScale;
+        _mainDeletionQueue.push_back([&]() {
+            vkd.vkDestroyPipelineLayout(_device, _depthReduceLayout, nullptr);
+            vkd.vkDestroyPipeline(_device, _depthReducePipeline, nullptr);
+        });
+    }
+    void BlueVKEngine::init_pipelines_cull() {
+        _cullLayout = PipelineLayoutBuilder{}
+                          .add_pc_range(VkPushConstantRange{
+                              .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                              .offset = 0,
+                              .size = sizeof(GPUCullPushConstants),
+                          })
+                          .add_set_layout(_cullDescriptorLayout)
+                          .build(_device);
+        VkShaderModule computeShader = load_shader_module(_device, "assets/shaders/cull.comp.spv");
+        _cullPipeline = ComputePipelineBuilder{}
+                            .set_layout(_cullLayout)
+                            .set_shader(computeShader)
+                            .build(_device);
+        vkd.vkDestroyShaderModule(_device, computeShader, nullptr);
 
-        VK_CHECK(vkResetFences(_device, 1, &frame._renderFence));
-        VkCommandBuffer cmd = frame._mainCommandBuffer;
-        VK_CHECK(vkResetCommandBuffer(cmd, 0));
-        VkCommandBufferBeginInfo cmdBeginInfo = command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-        VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+        _mainDeletionQueue.push_back([&]() {
+            vkd.vkDestroyPipelineLayout(_device, _cullLayout, nullptr);
+            vkd.vkDestroyPipeline(_device, _cullPipeline, nullptr);
+        });
+    }
+    void BlueVKEngine::init_pipelines_mesh() {
+        VkShaderModule vertShader = load_shader_module(_device, "assets/shaders/mesh.vert.spv");
+        VkShaderModule fragShader = load_shader_module(_device, "assets/shaders/mesh.frag.spv");
 
-        transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        //! Set 0 holds the shadow maps, the fragment stage reads the light from the scene data
+        _meshLayout = PipelineLayoutBuilder{}
+                          .add_pc_range(VkPushConstantRange{
+                              .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                              .offset = 0,
+                              .size = sizeof(GPUMeshPushConstants),
+                          })
+                          .add_set_layout(_shadowDescriptorLayout)
+                          .build(_device);
 
-        draw_background(cmd);
+        GraphicsPipelineBuilder builder{};
+        builder.set_layout(_meshLayout)
+            .set_shaders(vertShader, fragShader)
+            .set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+            .set_polygon_mode(VK_POLYGON_MODE_FILL)
+            .set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE)
+            .set_multisampling_none()
+            .disable_blending()
+            .enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL)
+            .set_color_attachment_format(_drawImage.format)
+            .set_depth_format(_depthImage.format);
+        DrawPipeline meshPipeline{};
+        meshPipeline.pipeline = builder.build(_device);
 
-        transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        //! After a depth pre-pass only the front-most surface passes and nothing needs to be written
+        meshPipeline.depthEqualPipeline = builder.enable_depthtest(false, VK_COMPARE_OP_EQUAL).build(_device);
 
-        draw_geometry(cmd);
+        builder.clear();
+        meshPipeline.depthOnlyPipeline = builder.set_layout(_meshLayout)
+                                    .set_vertex_shader(vertShader)
+                                    .set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+                                    .set_polygon_mode(VK_POLYGON_MODE_FILL)
+                                    .set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE)
+                                    .set_multisampling_none()
+                                    .disable_blending()
+                                    .enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL)
+                                    .set_depth_format(_depthImage.format)
+                                    .build(_device);
 
-        transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-        transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        copy_image_to_image(cmd, _drawImage.image, swapchainImage, _drawExtent, _drawExtent);
-        transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        vkd.vkDestroyShaderModule(_device, vertShader, nullptr);
+        vkd.vkDestroyShaderModule(_device, fragShader, nullptr);
 
-        draw_imgui(cmd, _swapchainImageViews[swapchainImageIndex]);
+        _meshDrawPipeline = (uint32_t)_drawPipelines.size();
+        _drawPipelines.push_back(meshPipeline);
 
-        transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        _mainDeletionQueue.push_back([&]() {
+            vkd.vkDestroyPipelineLayout(_device, _meshLayout, nullptr);
+            for (const DrawPipeline &drawPipeline : _drawPipelines) {
+                vkd.vkDestroyPipeline(_device, drawPipeline.pipeline, nullptr);
+                vkd.vkDestroyPipeline(_device, drawPipeline.depthEqualPipeline, nullptr);
+                vkd.vkDestroyPipeline(_device, drawPipeline.depthOnlyPipeline, nullptr);
+            }
+        });
+    }
+    void BlueVKEngine::init_pipelines_composite() {
+        VkShaderModule vertShader = load_shader_module(_device, "assets/shaders/fullscreen.vert.spv");
+        VkShaderModule fragShader = load_shader_module(_device, "assets/shaders/composite.frag.spv");
 
-        VK_CHECK(vkEndCommandBuffer(cmd));
-        VkCommandBufferSubmitInfo cmdInfo = command_buffer_submit_info(cmd);
-        VkSemaphoreSubmitInfo waitInfo = semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, frame._swapchainSemaphore);
-        VkSemaphoreSubmitInfo signalInfo = semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, frame._renderSemaphore);
-        VkSubmitInfo2 submit = submit_info(&cmdInfo, &signalInfo, &waitInfo);
-        VK_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, frame._renderFence));
-        VkPresentInfoKHR presentInfo{
-            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-            .pNext = nullptr,
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = &frame._renderSemaphore,
-            .swapchainCount = 1,
-            .pSwapchains = &_swapchain,
-            .pImageIndices = &swapchainImageIndex,
-        };
-        VkResult presentResult = vkQueuePresentKHR(_graphicsQueue, &presentInfo);
-        if (presentResult == VK_ERROR_OUT_OF_DATE_KHR) {
-            _resizeRequested = true;
-            return;
-        } else {
-            VK_CHECK(presentResult);
-        }
+        _compositeLayout = PipelineLayoutBuilder{}
+                               .add_pc_range(VkPushConstantRange{
+                                   .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   .offset = 0,
+                                   .size = sizeof(CompositePushConstants),
+                               })
+                               .add_set_layout(_compositeDescriptorLayout)
+                               .build(_device);
+        _compositePipeline = GraphicsPipelineBuilder{}
+                                 .set_layout(_compositeLayout)
+                                 .set_shaders(vertShader, fragShader)
+                                 .set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+                                 .set_polygon_mode(VK_POLYGON_MODE_FILL)
+                                 .set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE)
+                                 .set_multisampling_none()
+                                 .disable_blending()
+                                 .disable_depthtest()
+                                 .set_color_attachment_format(_swapchainImageFormat)
+                                 .set_depth_format(VK_FORMAT_UNDEFINED)
+                                 .build(_device);
 
-        _frameNumber++;
-        VK_CHECK(vkWaitForFences(_device, 1, &frame._renderFence, true, 1000000000));
+        vkd.vkDestroyShaderModule(_device, vertShader, nullptr);
+        vkd.vkDestroyShaderModule(_device, fragShader, nullptr);
+
+        _mainDeletionQueue.push_back([&]() {
+            vkd.vkDestroyPipelineLayout(_device, _compositeLayout, nullptr);
+            vkd.vkDestroyPipeline(_device, _compositePipeline, nullptr);
+        });
     }
-    void BlueVKEngine::draw_background(VkCommandBuffer cmd) {
-        ComputeEffect &effect = _computeEffects[_currentComputeEffect];
+    void BlueVKEngine::init_pipelines_upscale() {
+        _upscaleLayout = PipelineLayoutBuilder{}
+                             .add_pc_range(VkPushConstantRange{
+                                 .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                                 .offset = 0,
+                                 .size = sizeof(TemporalUpscalePushConstants),
+                             })
+                             .add_set_layout(_upscaleDescriptorLayout)
+                             .build(_device);
+        VkShaderModule computeShader = load_shader_module(_device, "assets/shaders/temporal_upscale.comp.spv");
+        _upscalePipeline = ComputePipelineBuilder{}
+                               .set_layout(_upscaleLayout)
+                               .set_shader(computeShader)
+                               .build(_device);
+        vkd.vkDestroyShaderModule(_device, computeShader, nullptr);
 
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, effect.pipeline);
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, effect.layout, 0, 1, &_drawImageDescriptorSet, 0, nullptr);
+        _mainDeletionQueue.push_back([&]() {
+            vkd.vkDestroyPipelineLayout(_device, _upscaleLayout, nullptr);
+            vkd.vkDestroyPipeline(_device, _upscalePipeline, nullptr);
+        });
+    }
+    void BlueVKEngine::init_pipelines_particles() {
+        //! One layout for every particle pass, all of them only take the parameter buffer's address
+        _particleLayout = PipelineLayoutBuilder{}
+                              .add_pc_range(VkPushConstantRange{
+                                  .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                  .offset = 0,
+                                  .size = sizeof(GPUParticlePushConstants),
+                              })
+                              .build(_device);
+        auto build_compute = [this](const char *path) {
+            VkShaderModule computeShader = load_shader_module(_device, path);
+            VkPipeline pipeline = ComputePipelineBuilder{}
+                                      .set_layout(_particleLayout)
+                                      .set_shader(computeShader)
+                                      .build(_device);
+            vkd.vkDestroyShaderModule(_device, computeShader, nullptr);
+            return pipeline;
+        };
+        _particleCountersPipeline = build_compute("assets/shaders/particle_counters.comp.spv");
+        _particleEmitPipeline = build_compute("assets/shaders/particle_emit.comp.spv");
+        _particleSimulatePipeline = build_compute("assets/shaders/particle_simulate.comp.spv");
+        _particleSortPipeline = build_compute("assets/shaders/particle_sort.comp.spv");
 
-        vkCmdPushConstants(cmd, effect.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(effect.data), &effect.data);
+        VkShaderModule vertShader = load_shader_module(_device, "assets/shaders/particle.vert.spv");
+        VkShaderModule fragShader = load_shader_module(_device, "assets/shaders/particle.frag.spv");
+        //! Tested against the scene's depth without writing it, particles don't occlude each other
+        _particleDrawPipeline = GraphicsPipelineBuilder{}
+                                    .set_layout(_particleLayout)
+                                    .set_shaders(vertShader, fragShader)
+                                    .set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+                                    .set_polygon_mode(VK_POLYGON_MODE_FILL)
+                                    .set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE)
+                                    .set_multisampling_none()
+                                    .enable_blending_premultiplied()
+                                    .enable_depthtest(false, VK_COMPARE_OP_GREATER_OR_EQUAL)
+                                    .set_color_attachment_format(_drawImage.format)
+                                    .set_depth_format(_depthImage.format)
+                                    .build(_device);
+        vkd.vkDestroyShaderModule(_device, vertShader, nullptr);
+        vkd.vkDestroyShaderModule(_device, fragShader, nullptr);
 
-        vkCmdDispatch(cmd, std::ceil(_drawExtent.width / 16.0), std::ceil(_drawExtent.height / 16.0), 1);
+        _mainDeletionQueue.push_back([&]() {
+            vkd.vkDestroyPipelineLayout(_device, _particleLayout, nullptr);
+            vkd.vkDestroyPipeline(_device, _particleCountersPipeline, nullptr);
+            vkd.vkDestroyPipeline(_device, _particleEmitPipeline, nullptr);
+            vkd.vkDestroyPipeline(_device, _particleSimulatePipeline, nullptr);
+            vkd.vkDestroyPipeline(_device, _particleSortPipeline, nullptr);
+            vkd.vkDestroyPipeline(_device, _particleDrawPipeline, nullptr);
+        });
     }
-    void BlueVKEngine::draw_geometry(VkCommandBuffer cmd) {
-        VkRenderingAttachmentInfo colorAttachment = attachment_info(_drawImage.view, nullptr, VK_IMAGE_LAYOUT_GENERAL);
+    void BlueVKEngine::init_pipelines_skinning() {
+        //! Both passes read the same push constants, the joint pass only uses the pose and skeleton part
+        _skinningLayout = PipelineLayoutBuilder{}
+                              .add_pc_range(VkPushConstantRange{
+                                  .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                                  .offset = 0,
+                                  .size = sizeof(GPUSkinningPushConstants),
+                              })
+                              .build(_device);
+        auto build_compute = [this](const char *path) {
+            VkShaderModule computeShader = load_shader_module(_device, path);
+            VkPipeline pipeline = ComputePipelineBuilder{}
+                                      .set_layout(_skinningLayout)
+                                      .set_shader(computeShader)
+                                      .build(_device);
+            vkd.vkDestroyShaderModule(_device, computeShader, nullptr);
+            return pipeline;
+        };
+        _skinJointsPipeline = build_compute("assets/shaders/skin_joints.comp.spv");
+        _skinVerticesPipeline = build_compute("assets/shaders/skin_vertices.comp.spv");
 
-        VkRenderingInfo renderInfo = rendering_info(_drawExtent, &colorAttachment, nullptr);
-        vkCmdBeginRendering(cmd, &renderInfo);
+        _mainDeletionQueue.push_back([&]() {
+            vkd.vkDestroyPipelineLayout(_device, _skinningLayout, nullptr);
+            vkd.vkDestroyPipeline(_device, _skinJointsPipeline, nullptr);
+            vkd.vkDestroyPipeline(_device, _skinVerticesPipeline, nullptr);
+        });
+    }
+    void BlueVKEngine::init_pipelines_shadows() {
+        VkShaderModule vertShader = load_shader_module(_device, "assets/shaders/shadow.vert.spv");
 
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _trianglePipeline);
+        _shadowLayout = PipelineLayoutBuilder{}
+                            .add_pc_range(VkPushConstantRange{
+                                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                                .offset = 0,
+                                .size = sizeof(GPUShadowPushConstants),
+                            })
+                            .build(_device);
 
-        VkViewport viewport{
-            .x = 0,
-            .y = 0,
-            .width = (float)_drawExtent.width,
-            .height = (float)_drawExtent.height,
-            .minDepth = 0.0f,
-            .maxDepth = 1.0f,
-        };
-        VkRect2D scissor{
-            .offset = VkOffset2D{0, 0},
-            .extent = _drawExtent,
-        };
-        vkCmdSetViewport(cmd, 0, 1, &viewport);
-        vkCmdSetScissor(cmd, 0, 1, &scissor);
+        //! Depth only, the bias pushes casters away from the light (towards 0 with reverse-Z) against acne
+        _shadowPipeline = GraphicsPipelineBuilder{}
+                              .set_layout(_shadowLayout)
+                              .set_vertex_shader(vertShader)
+                              .set_input_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+                              .set_polygon_mode(VK_POLYGON_MODE_FILL)
+                              .set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE)
+                              .set_multisampling_none()
+                              .disable_blending()
+                              .enable_depthtest(true, VK_COMPARE_OP_GREATER_OR_EQUAL)
+                              .enable_depth_bias(-1.25f, -1.75f)
+                              .set_depth_format(_shadowFormat)
+                              .build(_device);
 
-        vkCmdDraw(cmd, 3, 1, 0, 0);
+        vkd.vkDestroyShaderModule(_device, vertShader, nullptr);
 
-        vkCmdEndRendering(cmd);
-    }
-    void BlueVKEngine::draw_imgui(VkCommandBuffer cmd, VkImageView view) {
-        VkRenderingAttachmentInfo colorAttachment = attachment_info(view, nullptr, VK_IMAGE_LAYOUT_GENERAL);
-        VkRenderingInfo renderInfo = rendering_info(_swapchainExtent, &colorAttachment, nullptr);
-        vkCmdBeginRendering(cmd, &renderInfo);
-        ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
-        vkCmdEndRendering(cmd);
+        _mainDeletionQueue.push_back([&]() {
+            vkd.vkDestroyPipelineLayout(_device, _shadowLayout, nullptr);
+            vkd.vkDestroyPipeline(_device, _shadowPipeline, nullptr);
+        });
     }
-    void BlueVKEngine::create_swapchain(VkExtent2D size) {
-        _swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    void BlueVKEngine::init_profiler() {
+        _profiler.init(_device, _physicalDevice, _graphicsQueueIndex, FRAME_OVERLAP);
+        _profiler.debugLabels = _debugLabels && vkd.vkCmdBeginDebugUtilsLabelEXT != nullptr;
+        _profiler.set_counter("Config: Validation Level", _validationLevel);
+        _profiler.set_counter("Config: Debug Labels", _profiler.debugLabels);
+        _profiler.set_counter("Config: GPU Timings", _profiler.gpuTimings);
 
-        vkb::Result<vkb::Swapchain> swapchainReturn =
-            vkb::SwapchainBuilder{_physicalDevice, _device, _surface}
-                .set_desired_format(VkSurfaceFormatKHR{.format = _swapchainImageFormat,
-                                                       .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR})
-                .set_desired_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)
-                .set_desired_extent(size.width, size.height)
-                .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-                .build();
-        if (!swapchainReturn.has_value()) {
-            throw std::runtime_error(fmt::format("[BLueVK]::[ERROR]: Failed to create a swapchain:\n{}", swapchainReturn.error().value()));
+        _mainDeletionQueue.push_back([&]() {
+            _profiler.destroy(_device);
+        });
+    }
+    void BlueVKEngine::init_textures() {
+        if (_downsampleSupported) {
+            _downsampler.init(_device, _vmaAllocator, FRAME_OVERLAP);
+        }
+        _textureCache.init(_device,
+                           _physicalDevice,
+                           _vmaAllocator,
+                           _textureCompressionBC,
+                           FRAME_OVERLAP,
+                           &_jobs,
+                           _textureUploadBudget,
+                           _downsampleSupported ? &_downsampler : nullptr);
+        for (const std::string &path : _texturePaths) {
+            _textureCache.load(path);
         }
-        vkb::Swapchain vkbSwapchain = swapchainReturn.value();
 
-        _swapchain = vkbSwapchain;
-        _swapchainExtent = vkbSwapchain.extent;
-        _swapchainImages = vkbSwapchain.get_images().value();
-        _swapchainImageViews = vkbSwapchain.get_image_views().value();
+        _mainDeletionQueue.push_back([&]() {
+            if (_downsampleSupported) {
+                _downsampler.destroy();
+            }
+            _textureCache.destroy();
+        });
     }
-    void BlueVKEngine::create_draw_images() {
-        _drawImage.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-        _drawImage.extent = _windowSize;
-        VmaAllocationCreateInfo allocCreateInfo{
-            .usage = VMA_MEMORY_USAGE_GPU_ONLY,
-            .requiredFlags = VkMemoryPropertyFlags{VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT},
-        };
-        _drawImage.image = ImageBuilder{}
-                               .set_extent(_windowSize)
-                               .set_format(_drawImage.format)
-                               .set_usage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
-                                          VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-                                          VK_IMAGE_USAGE_STORAGE_BIT |
-                                          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
-                               .vmaBuild(_vmaAllocator, &allocCreateInfo, &_drawImage.allocation, nullptr);
-        _drawImage.view = ImageViewBuilder{}
-                              .set_format(_drawImage.format)
-                              .set_image(_drawImage.image)
-                              .build(_device);
+    void BlueVKEngine::init_memory() {
+        _memoryTracker.init(_physicalDevice, _vmaAllocator, FRAME_OVERLAP, _memoryBudgetExtension);
+
+        _mainDeletionQueue.push_back([&]() {
+            _memoryTracker.destroy();
+        });
     }
-    void BlueVKEngine::resize_swapchain() {
-        vkDeviceWaitIdle(_device);
-        vkQueueWaitIdle(_graphicsQueue);
+    void BlueVKEngine::init_readback() {
+        _readback.init(_device, _vmaAllocator, READBACK_SLOTS, &_jobs);
 
-        destroy_swapchain();
-        destroy_draw_images();
+        _mainDeletionQueue.push_back([&]() {
+            _readback.destroy();
+        });
+    }
+    void BlueVKEngine::init_particles() {
+        if (_maxParticles == 0) {
+            _particles = false;
+            return;
+        }
+        //! Every particle starts out dead, the alive lists and sort keys are padded for the bitonic sort
+        _particleSortCapacity = get_particle_sort_capacity(_maxParticles);
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        _particleBuffer = create_buffer(_maxParticles * sizeof(GPUParticle), usage, VMA_MEMORY_USAGE_GPU_ONLY);
+        for (BlueVKBuffer &aliveBuffer : _particleAliveBuffers) {
+            aliveBuffer = create_buffer(_particleSortCapacity * sizeof(uint32_t), usage, VMA_MEMORY_USAGE_GPU_ONLY);
+        }
+        _particleSortKeyBuffer = create_buffer(_particleSortCapacity * sizeof(float), usage, VMA_MEMORY_USAGE_GPU_ONLY);
 
-        sf::Vector2u newSize = _window.getSize();
+        std::vector<uint32_t> deadList(_maxParticles);
+        for (uint32_t i = 0; i < _maxParticles; i++) {
+            deadList[i] = i;
+        }
+        _particleDeadBuffer = upload_buffer(deadList.data(), deadList.size() * sizeof(uint32_t), usage);
+        GPUParticleCounters counters{
+            .deadCount = _maxParticles,
+        };
+        _particleCounterBuffer = upload_buffer(&counters, sizeof(counters), usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
 
-        create_swapchain(VkExtent2D{newSize.x, newSize.y});
-        create_draw_images();
+        for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+            _frames[i]._particleParamsBuffer = create_buffer(sizeof(GPUParticleParams), usage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
 
-        _resizeRequested = false;
-    }
-    void BlueVKEngine::destroy_swapchain() {
-        vkDestroySwapchainKHR(_device, _swapchain, nullptr);
+        fmt::println("[BlueVK]::[PARTICLES]: {} particles, {:.1f} MB",
+                     _maxParticles,
+                     (_maxParticles * (sizeof(GPUParticle) + sizeof(uint32_t)) +
+                      _particleSortCapacity * (2 * sizeof(uint32_t) + sizeof(float))) /
+                         (1024.0 * 1024.0));
+
+        _mainDeletionQueue.push_back([&]() {
+            destroy_buffer(_particleBuffer);
+            destroy_buffer(_particleAliveBuffers[0]);
+            destroy_buffer(_particleAliveBuffers[1]);
+            destroy_buffer(_particleDeadBuffer);
+            destroy_buffer(_particleSortKeyBuffer);
+            destroy_buffer(_particleCounterBuffer);
+            for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+                destroy_buffer(_frames[i]._particleParamsBuffer);
+            }
+        });
+    }
+    void BlueVKEngine::init_shadows() {
+        //! Static casters are cached in their own array, every cascade update copies its layer into the
+        //! sampled array before the dynamic casters are drawn over it
+        VmaAllocationCreateInfo allocCreateInfo{
+            .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+            .requiredFlags = VkMemoryPropertyFlags{VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT},
+        };
+        VkExtent2D extent{SHADOW_MAP_SIZE, SHADOW_MAP_SIZE};
+        for (BlueVKImage *image : {&_shadowStaticImage, &_shadowImage}) {
+            image->format = _shadowFormat;
+            image->extent = extent;
+        }
+        _shadowStaticImage.image = ImageBuilder{}
+                                       .set_extent(extent)
+                                       .set_format(_shadowFormat)
+                                       .set_array_layers(SHADOW_CASCADE_COUNT)
+                                       .set_usage(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT)
+                                       .vmaBuild(_vmaAllocator, &allocCreateInfo, &_shadowStaticImage.allocation, nullptr);
+        _shadowImage.image = ImageBuilder{}
+                                 .set_extent(extent)
+                                 .set_format(_shadowFormat)
+                                 .set_array_layers(SHADOW_CASCADE_COUNT)
+                                 .set_usage(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                            VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                            VK_IMAGE_USAGE_SAMPLED_BIT)
+                                 .vmaBuild(_vmaAllocator, &allocCreateInfo, &_shadowImage.allocation, nullptr);
+        _shadowImage.view = ImageViewBuilder{}
+                                .set_format(_shadowFormat)
+                                .set_image(_shadowImage.image)
+                                .set_subresource_range_aspect(VK_IMAGE_ASPECT_DEPTH_BIT)
+                                .set_view_type(VK_IMAGE_VIEW_TYPE_2D_ARRAY)
+                                .set_layer_range(0, SHADOW_CASCADE_COUNT)
+                                .build(_device);
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            _shadowStaticLayerViews[i] = ImageViewBuilder{}
+                                             .set_format(_shadowFormat)
+                                             .set_image(_shadowStaticImage.image)
+                                             .set_subresource_range_aspect(VK_IMAGE_ASPECT_DEPTH_BIT)
+                                             .set_layer_range(i, 1)
+                                             .build(_device);
+            _shadowLayerViews[i] = ImageViewBuilder{}
+                                       .set_format(_shadowFormat)
+                                       .set_image(_shadowImage.image)
+                                       .set_subresource_range_aspect(VK_IMAGE_ASPECT_DEPTH_BIT)
+                                       .set_layer_range(i, 1)
+                                       .build(_device);
+        }
+
+        //! Cascade depth ranges cover every caster in the scene
+        glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+        glm::vec3 boundsMax{std::numeric_limits<float>::lowest()};
+        for (const SceneObject &object : _sceneObjects) {
+            glm::vec4 sphere = object.data.sphereBounds;
+            boundsMin = glm::min(boundsMin, glm::vec3{sphere} - sphere.w);
+            boundsMax = glm::max(boundsMax, glm::vec3{sphere} + sphere.w);
+        }
+        _shadowSceneBounds = glm::vec4{(boundsMin + boundsMax) * 0.5f, glm::length(boundsMax - boundsMin) * 0.5f};
+
+        //! Every cascade has room for a draw per object, static ones first and dynamic ones after them
+        for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+            _frames[i]._shadowCommandBuffer = create_buffer(SHADOW_CASCADE_COUNT * _objectCount * sizeof(GPUDrawCommand),
+                                                            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                                            VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        //! Lives as long as the shadow maps, the main pool is cleared and refilled on every resize
+        std::vector<VkDescriptorPoolSize> sizes = {
+            {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1},
+        };
+        _shadowDescriptorAllocator.init_pool(_device, 1, sizes);
+        _shadowDescriptorSet = _shadowDescriptorAllocator.allocate(_device, _shadowDescriptorLayout);
+        DescriptorSetWriter{}
+            .write_image(0, _shadowImage.view, _shadowSampler, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+            .update(_device, _shadowDescriptorSet);
+
+        //! The mesh pass samples the shadow maps even with shadows off, they have to be readable from the start
+        immediate_submit([&](VkCommandBuffer cmd) {
+            transition_image(cmd, _shadowStaticImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+            transition_image(cmd, _shadowImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+        });
+
+        fmt::println("[BlueVK]::[SHADOWS]: {} cascades of {}x{}, {:.1f} MB",
+                     SHADOW_CASCADE_COUNT,
+                     SHADOW_MAP_SIZE,
+                     SHADOW_MAP_SIZE,
+                     2.0 * SHADOW_CASCADE_COUNT * SHADOW_MAP_SIZE * SHADOW_MAP_SIZE * sizeof(float) / (1024.0 * 1024.0));
+
+        _mainDeletionQueue.push_back([&]() {
+            for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+                vkd.vkDestroyImageView(_device, _shadowStaticLayerViews[i], nullptr);
+                vkd.vkDestroyImageView(_device, _shadowLayerViews[i], nullptr);
+            }
+            vkd.vkDestroyImageView(_device, _shadowImage.view, nullptr);
+            _shadowDescriptorAllocator.destroy_pool(_device);
+            vmaDestroyImage(_vmaAllocator, _shadowStaticImage.image, _shadowStaticImage.allocation);
+            vmaDestroyImage(_vmaAllocator, _shadowImage.image, _shadowImage.allocation);
+            for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+                destroy_buffer(_frames[i]._shadowCommandBuffer);
+            }
+        });
+    }
+    void BlueVKEngine::init_scene() {
+        //! Every mesh lives in one vertex and one index buffer, batches only differ in their offsets
+        //! LODs are extra index ranges over the same vertices, each one is a mesh of its own for the draw list
+        std::vector<PackedVertex> vertices{};
+        std::vector<uint32_t> indices{};
+        _sceneObjects = generate_dense_scene(_sceneObjectsPerAxis, _sceneLayerCount);
+        size_t floatVertexBytes = 0;
+        VertexCacheStats cacheBefore{};
+        VertexCacheStats cacheAfter{};
+        uint32_t fullDetailTriangles = 0;
+        auto meshStart = std::chrono::high_resolution_clock::now();
+        for (uint16_t mesh = 0; mesh < BUILTIN_MESH_COUNT; mesh++) {
+            MeshData builtin = generate_builtin_mesh((BuiltinMesh)mesh);
+            std::vector<MeshLod> lods = generate_lod_chain(builtin, MAX_MESH_LODS);
+            _meshLodChains.push_back(MeshLodChain{
+                .firstMesh = (uint32_t)_meshes.size(),
+                .lodCount = (uint32_t)lods.size(),
+            });
+
+            //! Full detail is what the measurements compare, it is what most objects draw
+            uint32_t vertexCount = (uint32_t)builtin.vertices.size();
+            VertexCacheStats before = analyze_vertex_cache(lods[0].indices, vertexCount, VERTEX_CACHE_ANALYSIS_SIZE);
+            std::vector<uint32_t> meshIndices{};
+            for (MeshLod &lod : lods) {
+                optimize_vertex_cache(lod.indices, vertexCount);
+                meshIndices.insert(meshIndices.end(), lod.indices.begin(), lod.indices.end());
+            }
+            optimize_vertex_fetch(builtin.vertices, meshIndices);
+            VertexCacheStats after = analyze_vertex_cache(std::span{meshIndices}.first(lods[0].indices.size()),
+                                                          (uint32_t)builtin.vertices.size(),
+                                                          VERTEX_CACHE_ANALYSIS_SIZE);
+            cacheBefore.vertexShaderInvocations += before.vertexShaderInvocations;
+            cacheAfter.vertexShaderInvocations += after.vertexShaderInvocations;
+            fullDetailTriangles += (uint32_t)(lods[0].indices.size() / 3);
+            floatVertexBytes += builtin.vertices.size() * sizeof(Vertex);
+
+            glm::vec4 quantization{};
+            std::vector<PackedVertex> packed = pack_vertices(builtin.vertices, quantization);
+            std::string chain{};
+            uint32_t firstIndex = (uint32_t)indices.size();
+            for (const MeshLod &lod : lods) {
+                _meshes.push_back(MeshInfo{
+                    .firstIndex = firstIndex,
+                    .indexCount = (uint32_t)lod.indices.size(),
+                    .vertexOffset = (int32_t)vertices.size(),
+                    .lodError = lod.error,
+                    .quantization = quantization,
+                });
+                firstIndex += (uint32_t)lod.indices.size();
+                chain += fmt::format("{}{} ({:.4f})", chain.empty() ? "" : " -> ", lod.indices.size() / 3, lod.error);
+            }
+            indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+            vertices.insert(vertices.end(), packed.begin(), packed.end());
+            fmt::println("[BlueVK]::[LOD]: Mesh {}: {} triangles", mesh, chain);
+            fmt::println("[BlueVK]::[MESH]: Mesh {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+                         mesh, before.acmr, after.acmr, before.atvr, after.atvr);
+        }
+        std::chrono::duration<double, std::milli> meshTime = std::chrono::high_resolution_clock::now() - meshStart;
+        fmt::println("[BlueVK]::[MESH]: Generated, simplified and optimized in {:.2f} ms", meshTime.count());
+
+        //! Vertex bandwidth is estimated as one fetch of the whole vertex per simulated cache miss,
+        //! against the float32 layout in the original triangle order
+        size_t packedVertexBytes = vertices.size() * sizeof(PackedVertex);
+        double fetchedBefore = (double)cacheBefore.vertexShaderInvocations * sizeof(Vertex);
+        double fetchedAfter = (double)cacheAfter.vertexShaderInvocations * sizeof(PackedVertex);
+        fmt::println("[BlueVK]::[MESH]: Vertex memory {:.1f} KB float32 -> {:.1f} KB packed ({:.1f}% smaller)",
+                     floatVertexBytes / 1024.0, packedVertexBytes / 1024.0,
+                     100.0 * (1.0 - (double)packedVertexBytes / floatVertexBytes));
+        fmt::println("[BlueVK]::[MESH]: Vertex fetch per full detail instance {:.0f} -> {:.0f} bytes, {:.1f}% less, ACMR {:.3f} -> {:.3f}",
+                     fetchedBefore / BUILTIN_MESH_COUNT, fetchedAfter / BUILTIN_MESH_COUNT,
+                     100.0 * (1.0 - fetchedAfter / fetchedBefore),
+                     (double)cacheBefore.vertexShaderInvocations / fullDetailTriangles,
+                     (double)cacheAfter.vertexShaderInvocations / fullDetailTriangles);
+
+        _dynamicObjectOffset = (uint32_t)_sceneObjects.size();
+        add_skinned_instances(vertices, indices);
+
+        _vertexBuffer = upload_buffer(vertices.data(),
+                                      vertices.size() * sizeof(PackedVertex),
+                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+        _indexBuffer = upload_buffer(indices.data(),
+                                     indices.size() * sizeof(uint32_t),
+                                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+        _objectCount = (uint32_t)_sceneObjects.size();
+
+        std::vector<GPUObjectData> objects(_objectCount);
+        for (uint32_t i = 0; i < _objectCount; i++) {
+            //! Packed positions are dequantized by the model matrix, culling keeps using the CPU side bounds
+            objects[i] = _sceneObjects[i].data;
+            const MeshInfo &mesh = _meshes[_meshLodChains[_sceneObjects[i].mesh].firstMesh];
+            objects[i].model = objects[i].model * get_dequantize_transform(mesh.quantization);
+        }
+        _objectBuffer = upload_buffer(objects.data(),
+                                      objects.size() * sizeof(GPUObjectData),
+                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+
+        for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+            _frames[i]._sceneDataBuffer = create_buffer(sizeof(GPUSceneData),
+                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                        VMA_MEMORY_USAGE_CPU_TO_GPU);
+            //! Written by the draw list every frame, there is at most one batch per object
+            _frames[i]._drawCommandBuffer = create_buffer(_objectCount * sizeof(GPUDrawCommand),
+                                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                              VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                                              VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                          VMA_MEMORY_USAGE_CPU_TO_GPU);
+            _frames[i]._drawCandidateBuffer = create_buffer(_objectCount * sizeof(GPUDrawCandidate),
+                                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                            VMA_MEMORY_USAGE_CPU_TO_GPU);
+            _frames[i]._visibleInstanceBuffer = create_buffer(_objectCount * sizeof(uint32_t),
+                                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                                  VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                              VMA_MEMORY_USAGE_GPU_ONLY);
+            //! Host visible so the culling statistics can be read back once the frame's fence is signaled
+            _frames[i]._cullStatsBuffer = create_buffer(sizeof(GPUCullStats),
+                                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                        VMA_MEMORY_USAGE_GPU_TO_CPU);
+            memset(_frames[i]._cullStatsBuffer.info.pMappedData, 0, sizeof(GPUCullStats));
+        }
+
+        _mainDeletionQueue.push_back([&]() {
+            destroy_buffer(_vertexBuffer);
+            destroy_buffer(_indexBuffer);
+            destroy_buffer(_objectBuffer);
+            for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+                destroy_buffer(_frames[i]._sceneDataBuffer);
+                destroy_buffer(_frames[i]._drawCommandBuffer);
+                destroy_buffer(_frames[i]._drawCandidateBuffer);
+                destroy_buffer(_frames[i]._visibleInstanceBuffer);
+                destroy_buffer(_frames[i]._cullStatsBuffer);
+            }
+        });
+    }
+    void BlueVKEngine::add_skinned_instances(std::vector<PackedVertex> &vertices, std::vector<uint32_t> &indices) {
+        if (_animatedInstanceCount == 0) {
+            return;
+        }
+        //! There is no skinned asset to load yet, a procedural tube and clip stand in for one.
+        //! Only the triangle order is optimized, a fetch reorder would have to move the influences too.
+        SkinnedMeshData skinned = generate_skinned_tube(8, 32, 12, 4.0f, 0.3f);
+        optimize_vertex_cache(skinned.mesh.indices, (uint32_t)skinned.mesh.vertices.size());
+        _skeleton = std::move(skinned.skeleton);
+        _animationClip = generate_sway_clip(_skeleton, 4.0f, 30.0f);
+        _skinVertexCount = (uint32_t)skinned.mesh.vertices.size();
+
+        //! The bind pose is never drawn, the skinned ranges after it are written by the skinning pass
+        //! every frame before anything reads them
+        std::vector<PackedVertex> packed = pack_vertices(skinned.mesh.vertices, _skinSourceQuantization);
+        _skinSourceVertexOffset = (uint32_t)vertices.size();
+        vertices.insert(vertices.end(), packed.begin(), packed.end());
+        _skinOutputVertexOffset = (uint32_t)vertices.size();
+        vertices.resize(vertices.size() + (size_t)_animatedInstanceCount * _skinVertexCount);
+        _skinOutputQuantization = glm::vec4{0.0f, 0.0f, 0.0f, skinned.reach};
+        uint32_t firstIndex = (uint32_t)indices.size();
+        indices.insert(indices.end(), skinned.mesh.indices.begin(), skinned.mesh.indices.end());
+
+        //! Rows on the floor in front of the walls, every instance plays the clip at its own phase and speed
+        constexpr uint32_t INSTANCES_PER_ROW = 16;
+        _animationPlayback.resize(_animatedInstanceCount);
+        for (uint32_t i = 0; i < _animatedInstanceCount; i++) {
+            _meshLodChains.push_back(MeshLodChain{
+                .firstMesh = (uint32_t)_meshes.size(),
+                .lodCount = 1,
+            });
+            _meshes.push_back(MeshInfo{
+                .firstIndex = firstIndex,
+                .indexCount = (uint32_t)skinned.mesh.indices.size(),
+                .vertexOffset = (int32_t)(_skinOutputVertexOffset + i * _skinVertexCount),
+                .quantization = _skinOutputQuantization,
+            });
+
+            float random = (float)((i * 2654435761u) >> 8) / (float)(1u << 24);
+            uint32_t column = i % INSTANCES_PER_ROW;
+            uint32_t row = i / INSTANCES_PER_ROW;
+            glm::vec3 position{((float)column - (INSTANCES_PER_ROW - 1) * 0.5f) * 3.5f, -9.5f, 13.5f + row * 0.9f};
+            float yaw = random * 6.2831853f;
+            glm::mat4 model{1.0f};
+            model[0] = glm::vec4{std::cos(yaw), 0.0f, -std::sin(yaw), 0.0f};
+            model[2] = glm::vec4{std::sin(yaw), 0.0f, std::cos(yaw), 0.0f};
+            model[3] = glm::vec4{position, 1.0f};
+            _sceneObjects.push_back(SceneObject{
+                .data = GPUObjectData{
+                    .model = model,
+                    .sphereBounds = glm::vec4{position, skinned.reach},
+                    .color = glm::vec4{0.9f, 0.45f + 0.3f * random, 0.2f, 1.0f},
+                },
+                .mesh = (uint32_t)_meshLodChains.size() - 1,
+            });
+            _animationPlayback[i] = glm::vec2{random * _animationClip.get_duration(), 0.75f + 0.5f * random};
+        }
+
+        std::vector<GPUSkeletonJoint> joints(_skeleton.get_joint_count());
+        for (uint32_t joint = 0; joint < joints.size(); joint++) {
+            joints[joint] = GPUSkeletonJoint{
+                .inverseBind = _skeleton.inverseBind[joint],
+                .parent = _skeleton.parents[joint],
+            };
+        }
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        _skeletonBuffer = upload_buffer(joints.data(), joints.size() * sizeof(GPUSkeletonJoint), usage);
+        _skinInfluenceBuffer = upload_buffer(skinned.influences.data(), skinned.influences.size() * sizeof(SkinInfluence), usage);
+        uint32_t jointStride = _skeleton.get_joint_stride();
+        _skinMatrixBuffer = create_buffer((size_t)_animatedInstanceCount * jointStride * 3 * sizeof(glm::vec4),
+                                          usage,
+                                          VMA_MEMORY_USAGE_GPU_ONLY);
+        for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+            _frames[i]._jointPoseBuffer = create_buffer((size_t)_animatedInstanceCount * JOINT_CHANNEL_COUNT * jointStride * sizeof(float),
+                                                        usage,
+                                                        VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        fmt::println("[BlueVK]::[SKINNING]: {} instances of {} vertices and {} joints, {:.1f} KB of skinned vertices",
+                     _animatedInstanceCount,
+                     _skinVertexCount,
+                     _skeleton.get_joint_count(),
+                     (double)_animatedInstanceCount * _skinVertexCount * sizeof(PackedVertex) / 1024.0);
+
+        _mainDeletionQueue.push_back([&]() {
+            destroy_buffer(_skeletonBuffer);
+            destroy_buffer(_skinInfluenceBuffer);
+            destroy_buffer(_skinMatrixBuffer);
+            for (uint32_t i = 0; i < FRAME_OVERLAP; i++) {
+                destroy_buffer(_frames[i]._jointPoseBuffer);
+            }
+        });
+    }
+    void BlueVKEngine::draw() {
+        FrameData &frame = get_current_frame();
+
+        uint32_t swapchainImageIndex;
+        VkResult nextImageResult = vkd.vkAcquireNextImageKHR(_device, _swapchain, 1000000000, frame._swapchainSemaphore, VK_NULL_HANDLE, &swapchainImageIndex);
+        if (nextImageResult == VK_ERROR_OUT_OF_DATE_KHR) {
+            _resizeRequested = true;
+            return;
+        } else {
+            VK_CHECK(nextImageResult);
+        }
+        VkImage swapchainImage = _swapchainImages[swapchainImageIndex];
+        // _drawExtent = _drawImage.extent;
+        _drawExtent.width = std::min(_swapchainExtent.width, _drawImage.extent.width) * _renderScale;
+        _drawExtent.height = std::min(_swapchainExtent.height, _drawImage.extent.height) * _renderScale;
+
+        collect_cull_stats(frame);
+        update_shadow_cascades(frame);
+        update_scene_data(frame);
+        build_draw_list(frame);
+        sample_animations(frame);
+
+        VK_CHECK(vkd.vkResetFences(_device, 1, &frame._renderFence));
+        VkCommandBuffer cmd = frame._mainCommandBuffer;
+        VK_CHECK(vkd.vkResetCommandBuffer(cmd, 0));
+        //! The frame's fence is signaled, so every secondary buffer recorded for it has finished executing
+        for (ThreadCommandPool &threadPool : frame._threadCommandPools) {
+            VK_CHECK(vkd.vkResetCommandPool(_device, threadPool.pool, 0));
+            threadPool.usedSecondaryBuffers = 0;
+        }
+        _readback.update(_frameNumber % FRAME_OVERLAP, _frameNumber);
+        VkCommandBufferBeginInfo cmdBeginInfo = command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        VK_CHECK(vkd.vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+
+        _profiler.begin_frame(_device, cmd, _frameNumber % FRAME_OVERLAP);
+
+        {
+            //! Their windows are drawn on the main thread
+            std::lock_guard<std::mutex> lock{_statusMutex};
+            _profiler.begin_scope(cmd, "Texture Uploads");
+            if (_downsampleSupported) {
+                _downsampler.update(cmd, _frameNumber % FRAME_OVERLAP);
+            }
+            _textureCache.update(cmd, _frameNumber % FRAME_OVERLAP);
+            _profiler.end_scope(cmd);
+            _profiler.set_counter("Texture VRAM (MB)", _textureCache.get_memory_bytes() / (1024.0 * 1024.0));
+            _profiler.set_counter("Texture VRAM as RGBA8 (MB)", _textureCache.get_uncompressed_bytes() / (1024.0 * 1024.0));
+
+            _profiler.begin_scope(cmd, "Defragmentation");
+            _memoryTracker.update(cmd, _frameNumber);
+            _profiler.end_scope(cmd);
+            _memoryTracker.report(_profiler);
+        }
+
+        _profiler.begin_scope(cmd, "Culling");
+        draw_cull(cmd);
+        _profiler.end_scope(cmd);
+
+        if (_animatedInstanceCount > 0) {
+            _profiler.begin_scope(cmd, "Skinning");
+            draw_skinning(cmd);
+            _profiler.end_scope(cmd);
+        }
+
+        if (_shadows) {
+            draw_shadows(cmd);
+        }
+
+        if (_particles) {
+            _profiler.begin_scope(cmd, "Particle Simulation");
+            update_particles(cmd);
+            _profiler.end_scope(cmd);
+        }
+
+        transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+        _profiler.begin_scope(cmd, "Background");
+        draw_background(cmd);
+        _profiler.end_scope(cmd);
+
+        transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        transition_image(cmd, _depthImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+        if (_depthPrepass) {
+            _profiler.begin_scope(cmd, "Depth Pre-pass");
+            draw_depth_prepass(cmd);
+            _profiler.end_scope(cmd);
+        }
+
+        _profiler.begin_scope(cmd, "Geometry");
+        draw_geometry(cmd);
+        _profiler.end_scope(cmd);
+
+        if (_particles) {
+            _profiler.begin_scope(cmd, "Particles");
+            draw_particles(cmd);
+            _profiler.end_scope(cmd);
+        }
+
+        transition_image(cmd, _depthImage.image, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+
+        _profiler.begin_scope(cmd, "Depth Pyramid");
+        draw_depth_pyramid(cmd);
+        _profiler.end_scope(cmd);
+
+        _profiler.begin_scope(cmd, "Readback");
+        record_readbacks(cmd);
+        _profiler.end_scope(cmd);
+
+        //! With temporal upscaling the reconstructed full resolution image is presented instead of the draw image
+        VkExtent2D presentExtent = _drawExtent;
+        if (_temporalUpscale) {
+            transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+            _profiler.begin_scope(cmd, "Temporal Upscale");
+            draw_temporal_upscale(cmd);
+            _profiler.end_scope(cmd);
+            presentExtent = get_upscale_extent();
+        }
+
+        if (_compositePresent) {
+            if (!_temporalUpscale) {
+                transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            }
+            transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+            if (_bloom && _downsampleSupported) {
+                _profiler.begin_scope(cmd, "Bloom");
+                draw_bloom(cmd, presentExtent);
+                _profiler.end_scope(cmd);
+                _bloomValid = true;
+            } else if (!_bloomValid) {
+                //! Still bound by the composite pass, it has to be in the layout the descriptors say
+                transition_image_mips(cmd, _bloomImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, _bloomImage.mipLevels);
+                _bloomValid = true;
+            }
+            _profiler.set_counter("Downsample Dispatches", _downsampleSupported ? _downsampler.get_dispatch_count() : 0);
+
+            _profiler.begin_scope(cmd, "Composite + ImGui");
+            draw_composite(cmd, _swapchainImageViews[swapchainImageIndex], presentExtent);
+            _profiler.end_scope(cmd);
+        } else {
+            VkImage source = _temporalUpscale ? _historyImages[_historyIndex].image : _drawImage.image;
+            VkImageLayout sourceLayout = _temporalUpscale ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+            _profiler.begin_scope(cmd, "Present Blit");
+            transition_image(cmd, source, sourceLayout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            copy_image_to_image(cmd, source, swapchainImage, presentExtent, presentExtent);
+            transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+            if (_temporalUpscale) {
+                //! Read as history next frame
+                transition_image(cmd, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+            }
+            _profiler.end_scope(cmd);
+
+            _profiler.begin_scope(cmd, "ImGui");
+            draw_imgui(cmd, _swapchainImageViews[swapchainImageIndex]);
+            _profiler.end_scope(cmd);
+        }
+        report_present_traffic();
+        report_draw_target_traffic();
+
+        transition_image(cmd, swapchainImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+        VK_CHECK(vkd.vkEndCommandBuffer(cmd));
+        VkCommandBufferSubmitInfo cmdInfo = command_buffer_submit_info(cmd);
+        VkSemaphoreSubmitInfo waitInfo = semaphore_submit_info(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, frame._swapchainSemaphore);
+        VkSemaphoreSubmitInfo signalInfo = semaphore_submit_info(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, frame._renderSemaphore);
+        VkSubmitInfo2 submit = submit_info(&cmdInfo, &signalInfo, &waitInfo);
+        VK_CHECK(vkd.vkQueueSubmit2(_graphicsQueue, 1, &submit, frame._renderFence));
+        _presentId++;
+        _presentInputTimes[_presentId % _presentInputTimes.size()] = _frameInputTime;
+        VkPresentIdKHR presentIdInfo{
+            .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+            .pNext = nullptr,
+            .swapchainCount = 1,
+            .pPresentIds = &_presentId,
+        };
+        VkPresentInfoKHR presentInfo{
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .pNext = _presentWait ? &presentIdInfo : nullptr,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &frame._renderSemaphore,
+            .swapchainCount = 1,
+            .pSwapchains = &_swapchain,
+            .pImageIndices = &swapchainImageIndex,
+        };
+        VkResult presentResult = vkd.vkQueuePresentKHR(_graphicsQueue, &presentInfo);
+        std::chrono::duration<double, std::milli> inputToPresentCall = std::chrono::high_resolution_clock::now() - _frameInputTime;
+        _inputToPresentCall = inputToPresentCall.count();
+        _profiler.set_timing("Input to Present Call", _inputToPresentCall);
+        if (presentResult == VK_ERROR_OUT_OF_DATE_KHR) {
+            _resizeRequested = true;
+            return;
+        } else {
+            VK_CHECK(presentResult);
+        }
+
+        _frameNumber++;
+        VK_CHECK(vkd.vkWaitForFences(_device, 1, &frame._renderFence, true, 1000000000));
+    }
+    void BlueVKEngine::draw_background(VkCommandBuffer cmd) {
+        ComputeEffect &effect = _computeEffects[_currentComputeEffect];
+
+        if (!_cacheBackground || effect.update == EFFECT_TIME_DEPENDENT) {
+            dispatch_effect(cmd, effect, _drawImageDescriptorSet);
+            _profiler.set_counter("Background Dispatches", 1);
+            return;
+        }
+
+        //! The effect writes every pixel of the extent, same inputs give the same image
+        uint64_t key = InputHash{}
+                           .add(effect.pipeline)
+                           .add(effect.data)
+                           .add(_drawExtent)
+                           .value;
+        bool dirty = !_backgroundValid || key != _backgroundKey;
+        if (dirty) {
+            transition_image(cmd, _backgroundImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+            dispatch_effect(cmd, effect, _backgroundDescriptorSet);
+            transition_image(cmd, _backgroundImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            _backgroundKey = key;
+            _backgroundValid = true;
+        }
+        _profiler.set_counter("Background Dispatches", dirty ? 1 : 0);
+
+        transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        copy_image_to_image(cmd, _backgroundImage.image, _drawImage.image, _drawExtent, _drawExtent);
+        transition_image(cmd, _drawImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+    }
+    void BlueVKEngine::dispatch_effect(VkCommandBuffer cmd, const ComputeEffect &effect, VkDescriptorSet target) {
+        vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, effect.pipeline);
+        vkd.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, effect.layout, 0, 1, &target, 0, nullptr);
+
+        vkd.vkCmdPushConstants(cmd, effect.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(effect.data), &effect.data);
+
+        vkd.vkCmdDispatch(cmd, std::ceil(_drawExtent.width / 16.0), std::ceil(_drawExtent.height / 16.0), 1);
+    }
+    void BlueVKEngine::draw_cull(VkCommandBuffer cmd) {
+        FrameData &frame = get_current_frame();
+
+        vkd.vkCmdFillBuffer(cmd, frame._cullStatsBuffer.buffer, 0, sizeof(GPUCullStats), 0);
+        //! Also orders the reads of last frame's depth pyramid after it was built
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT);
+
+        GPUCullPushConstants pushConstants{
+            .sceneData = get_buffer_device_address(_device, frame._sceneDataBuffer.buffer),
+            .objectBuffer = get_buffer_device_address(_device, _objectBuffer.buffer),
+            .candidateBuffer = get_buffer_device_address(_device, frame._drawCandidateBuffer.buffer),
+            .drawCommandBuffer = get_buffer_device_address(_device, frame._drawCommandBuffer.buffer),
+            .instanceBuffer = get_buffer_device_address(_device, frame._visibleInstanceBuffer.buffer),
+            .cullStatsBuffer = get_buffer_device_address(_device, frame._cullStatsBuffer.buffer),
+            .candidateCount = (uint32_t)_drawList.get_candidates().size(),
+        };
+
+        vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline);
+        vkd.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullLayout, 0, 1, &_cullDescriptorSet, 0, nullptr);
+        vkd.vkCmdPushConstants(cmd, _cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkd.vkCmdDispatch(cmd, (pushConstants.candidateCount + 63) / 64, 1, 1);
+
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_HOST_BIT,
+                       VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_HOST_READ_BIT);
+    }
+    void BlueVKEngine::draw_depth_prepass(VkCommandBuffer cmd) {
+        VkRenderingAttachmentInfo depthAttachment = depth_attachment_info(_depthImage.view, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+        VkRenderingInfo renderInfo = rendering_info(_drawExtent, nullptr, &depthAttachment);
+
+        draw_scene_pass(cmd, renderInfo, true);
+    }
+    void BlueVKEngine::draw_geometry(VkCommandBuffer cmd) {
+        VkRenderingAttachmentInfo colorAttachment = attachment_info(_drawImage.view, nullptr, VK_IMAGE_LAYOUT_GENERAL);
+        VkRenderingAttachmentInfo depthAttachment = depth_attachment_info(_depthImage.view,
+                                                                          VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                                                          _depthPrepass
+                                                                              ? VK_ATTACHMENT_LOAD_OP_LOAD
+                                                                              : VK_ATTACHMENT_LOAD_OP_CLEAR);
+        VkRenderingInfo renderInfo = rendering_info(_drawExtent, &colorAttachment, &depthAttachment);
+
+        draw_scene_pass(cmd, renderInfo, false);
+    }
+    void BlueVKEngine::draw_scene_pass(VkCommandBuffer cmd, VkRenderingInfo &renderInfo, bool depthOnly) {
+        auto start = std::chrono::high_resolution_clock::now();
+        uint32_t batchCount = (uint32_t)_drawList.get_batches().size();
+
+        //! Viewport and scissor aren't inherited by secondary buffers, every buffer sets its own
+        auto record = [this, depthOnly](VkCommandBuffer target, uint32_t firstBatch, uint32_t lastBatch, bool first) {
+            VkViewport viewport{
+                .x = 0,
+                .y = 0,
+                .width = (float)_drawExtent.width,
+                .height = (float)_drawExtent.height,
+                .minDepth = 0.0f,
+                .maxDepth = 1.0f,
+            };
+            VkRect2D scissor{
+                .offset = VkOffset2D{0, 0},
+                .extent = _drawExtent,
+            };
+            vkd.vkCmdSetViewport(target, 0, 1, &viewport);
+            vkd.vkCmdSetScissor(target, 0, 1, &scissor);
+
+            if (!depthOnly && first) {
+                vkd.vkCmdBindPipeline(target, VK_PIPELINE_BIND_POINT_GRAPHICS, _trianglePipeline);
+                vkd.vkCmdDraw(target, 3, 1, 0, 0);
+            }
+            return draw_batches(target, depthOnly, firstBatch, lastBatch);
+        };
+
+        DrawStats stats{};
+        if (!_parallelRecording) {
+            vkd.vkCmdBeginRendering(cmd, &renderInfo);
+            stats = record(cmd, 0, batchCount, true);
+            vkd.vkCmdEndRendering(cmd);
+        } else {
+            //! Every thread records a contiguous range of batches into a secondary buffer, they are executed in order
+            uint32_t chunkCount = std::clamp((batchCount + MIN_BATCHES_PER_SECONDARY - 1) / MIN_BATCHES_PER_SECONDARY,
+                                             1u,
+                                             _jobs.get_active_thread_count());
+            uint32_t chunkSize = (batchCount + chunkCount - 1) / chunkCount;
+
+            VkFormat colorFormat = _drawImage.format;
+            VkCommandBufferInheritanceRenderingInfo inheritanceRendering =
+                inheritance_rendering_info(depthOnly ? nullptr : &colorFormat, _depthImage.format);
+            VkCommandBufferInheritanceInfo inheritance = inheritance_info(&inheritanceRendering);
+
+            FrameData &frame = get_current_frame();
+            uint32_t pass = depthOnly ? 0 : 1;
+            CommandCache &cache = frame._scenePassCommands[pass];
+            std::vector<VkCommandBuffer> secondaryBuffers(chunkCount);
+            bool rerecord = !_cacheCommands || cache.acquire(get_scene_pass_key(frame, depthOnly, chunkCount), chunkCount);
+            if (!_cacheCommands) {
+                cache.invalidate();
+            }
+            if (rerecord) {
+                std::vector<DrawStats> chunkStats(chunkCount);
+                JobCounter counter{};
+                for (uint32_t i = 0; i < chunkCount; i++) {
+                    _jobs.schedule([&, i]() {
+                        VkCommandBuffer secondary = _cacheCommands
+                                                        ? cache.begin(i, inheritance)
+                                                        : begin_secondary_command_buffer(frame, inheritance);
+                        uint32_t firstBatch = std::min(i * chunkSize, batchCount);
+                        uint32_t lastBatch = std::min(firstBatch + chunkSize, batchCount);
+                        chunkStats[i] = record(secondary, firstBatch, lastBatch, i == 0);
+                        VK_CHECK(vkd.vkEndCommandBuffer(secondary));
+                        secondaryBuffers[i] = secondary;
+                    },
+                                   &counter);
+                }
+                _jobs.wait(counter);
+
+                frame._scenePassStats[pass] = DrawStats{};
+                for (const DrawStats &chunk : chunkStats) {
+                    frame._scenePassStats[pass].drawCalls += chunk.drawCalls;
+                    frame._scenePassStats[pass].pipelineBinds += chunk.pipelineBinds;
+                }
+            } else {
+                //! Instance counts and transforms live in buffers, an unchanged key means identical commands
+                std::copy(cache.buffers.begin(), cache.buffers.begin() + chunkCount, secondaryBuffers.begin());
+            }
+            stats = frame._scenePassStats[pass];
+
+            renderInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+            vkd.vkCmdBeginRendering(cmd, &renderInfo);
+            vkd.vkCmdExecuteCommands(cmd, chunkCount, secondaryBuffers.data());
+            vkd.vkCmdEndRendering(cmd);
+
+            _profiler.set_counter(depthOnly ? "Recorded Secondary Buffers (Pre-pass)" : "Recorded Secondary Buffers",
+                                  rerecord ? chunkCount : 0);
+        }
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        if (depthOnly) {
+            _profiler.set_timing("CPU Record Pre-pass", elapsed.count());
+        } else {
+            _profiler.set_timing("CPU Record Geometry", elapsed.count());
+            _profiler.set_counter("Draw Batches", batchCount);
+            _profiler.set_counter("Draw Calls", stats.drawCalls);
+            _profiler.set_counter("Pipeline Binds", stats.pipelineBinds);
+        }
+    }
+    uint64_t BlueVKEngine::get_scene_pass_key(FrameData &frame, bool depthOnly, uint32_t chunkCount) {
+        //! Everything the recorded commands bake in: state, extent, buffer handles and the batch layout.
+        //! Which instances are visible is written by the culling pass and doesn't take part.
+        InputHash hash{};
+        hash.add(depthOnly)
+            .add(_depthPrepass)
+            .add(chunkCount)
+            .add(_drawExtent)
+            .add(_drawImage.format)
+            .add(_depthImage.format)
+            .add(_trianglePipeline)
+            .add(_meshLayout)
+            .add(_shadowDescriptorSet)
+            .add(_objectBuffer.buffer)
+            .add(_vertexBuffer.buffer)
+            .add(_indexBuffer.buffer)
+            .add(frame._sceneDataBuffer.buffer)
+            .add(frame._drawCommandBuffer.buffer)
+            .add(frame._visibleInstanceBuffer.buffer);
+        for (const DrawPipeline &drawPipeline : _drawPipelines) {
+            hash.add(drawPipeline);
+        }
+        for (VkDescriptorSet descriptorSet : _drawDescriptorSets) {
+            hash.add(descriptorSet);
+        }
+        const std::vector<DrawBatch> &batches = _drawList.get_batches();
+        hash.add_bytes(batches.data(), batches.size() * sizeof(DrawBatch));
+        return hash.value;
+    }
+    BlueVKEngine::DrawStats BlueVKEngine::draw_batches(VkCommandBuffer cmd, bool depthOnly, uint32_t firstBatch, uint32_t lastBatch) {
+        FrameData &frame = get_current_frame();
+        const std::vector<DrawBatch> &batches = _drawList.get_batches();
+
+        GPUMeshPushConstants pushConstants{
+            .sceneData = get_buffer_device_address(_device, frame._sceneDataBuffer.buffer),
+            .objectBuffer = get_buffer_device_address(_device, _objectBuffer.buffer),
+            .instanceBuffer = get_buffer_device_address(_device, frame._visibleInstanceBuffer.buffer),
+            .vertexBuffer = get_buffer_device_address(_device, _vertexBuffer.buffer),
+        };
+        //! Every draw pipeline shares _meshLayout, so the push constants survive pipeline changes
+        vkd.vkCmdPushConstants(cmd, _meshLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkd.vkCmdBindIndexBuffer(cmd, _indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkd.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _meshLayout, 0, 1, &_shadowDescriptorSet, 0, nullptr);
+
+        //! Batches are sorted by pipeline and descriptor set, each run of equal state is one multi-draw
+        uint32_t boundPipeline = UINT32_MAX;
+        uint32_t boundDescriptorSet = NO_DESCRIPTOR_SET;
+        DrawStats stats{};
+        for (uint32_t first = firstBatch; first < lastBatch;) {
+            uint32_t last = first + 1;
+            while (last < lastBatch &&
+                   batches[last].pipeline == batches[first].pipeline &&
+                   batches[last].descriptorSet == batches[first].descriptorSet) {
+                last++;
+            }
+
+            if (batches[first].pipeline != boundPipeline) {
+                const DrawPipeline &drawPipeline = _drawPipelines[batches[first].pipeline];
+                VkPipeline pipeline = depthOnly      ? drawPipeline.depthOnlyPipeline
+                                      : _depthPrepass ? drawPipeline.depthEqualPipeline
+                                                      : drawPipeline.pipeline;
+                vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundPipeline = batches[first].pipeline;
+                stats.pipelineBinds++;
+            }
+            if (batches[first].descriptorSet != boundDescriptorSet && batches[first].descriptorSet != NO_DESCRIPTOR_SET) {
+                //! Per draw sets come after the shadow set
+                vkd.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _meshLayout, 1, 1,
+                                        &_drawDescriptorSets[batches[first].descriptorSet], 0, nullptr);
+                boundDescriptorSet = batches[first].descriptorSet;
+            }
+
+            vkd.vkCmdDrawIndexedIndirect(cmd, frame._drawCommandBuffer.buffer, first * sizeof(GPUDrawCommand),
+                                     last - first, sizeof(GPUDrawCommand));
+            stats.drawCalls++;
+            first = last;
+        }
+        return stats;
+    }
+    void BlueVKEngine::draw_depth_pyramid(VkCommandBuffer cmd) {
+        transition_image(cmd, _depthPyramid.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+        vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _depthReducePipeline);
+
+        //! Only the region covered by _drawExtent holds valid depth, so the pyramid is built over that region
+        glm::ivec2 inputSize{_drawExtent.width, _drawExtent.height};
+        for (uint32_t mip = 0; mip < _depthPyramid.mipLevels; mip++) {
+            glm::ivec2 outputSize = glm::max((inputSize + 1) / 2, glm::ivec2{1});
+            DepthReducePushConstants pushConstants{
+                .inputSize = inputSize,
+                .outputSize = outputSize,
+            };
+
+            vkd.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _depthReduceLayout, 0, 1, &_depthReduceDescriptorSets[mip], 0, nullptr);
+            vkd.vkCmdPushConstants(cmd, _depthReduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+            vkd.vkCmdDispatch(cmd, (outputSize.x + 15) / 16, (outputSize.y + 15) / 16, 1);
+
+            memory_barrier(cmd,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT);
+            inputSize = outputSize;
+        }
+
+        _depthPyramidExtent = _drawExtent;
+        _depthPyramidValid = true;
+    }
+    void BlueVKEngine::update_particles(VkCommandBuffer cmd) {
+        auto start = std::chrono::high_resolution_clock::now();
+        FrameData &frame = get_current_frame();
+
+        //! Long frames (a hitch, an idle window) are simulated as a single capped step
+        float dt = std::min(_frameDeltaTime, 0.1f);
+        _particleEmitAccumulator += _particleEmitRate * dt;
+        uint32_t emitRequest = (uint32_t)std::min(_particleEmitAccumulator, (float)_maxParticles);
+        _particleEmitAccumulator = std::min(_particleEmitAccumulator - emitRequest, 1.0f);
+
+        uint32_t aliveIn = _particleFrame % 2;
+        GPUParticleParams params{
+            .emitterPosition = glm::vec4{0.0f, -9.0f, 10.0f, 0.5f},
+            .emitterVelocity = glm::vec4{0.0f, 18.0f, 0.0f, 5.0f},
+            .startColor = glm::vec4{4.0f, 1.6f, 0.4f, 1.0f},
+            .endColor = glm::vec4{0.2f, 0.4f, 1.5f, 0.0f},
+            .sceneData = get_buffer_device_address(_device, frame._sceneDataBuffer.buffer),
+            .particles = get_buffer_device_address(_device, _particleBuffer.buffer),
+            .aliveListIn = get_buffer_device_address(_device, _particleAliveBuffers[aliveIn].buffer),
+            .aliveListOut = get_buffer_device_address(_device, _particleAliveBuffers[1 - aliveIn].buffer),
+            .deadList = get_buffer_device_address(_device, _particleDeadBuffer.buffer),
+            .sortKeys = get_buffer_device_address(_device, _particleSortKeyBuffer.buffer),
+            .counters = get_buffer_device_address(_device, _particleCounterBuffer.buffer),
+            .deltaTime = dt,
+            .gravity = 9.81f,
+            .drag = 0.05f,
+            .size = 0.06f,
+            .lifetime = _particleLifetime,
+            .emitRequest = emitRequest,
+            .seed = (uint32_t)_frameNumber,
+            .aliveIn = aliveIn,
+            .sorted = _particleSorting ? 1u : 0u,
+        };
+        memcpy(frame._particleParamsBuffer.info.pMappedData, &params, sizeof(params));
+        vmaFlushAllocation(_vmaAllocator, frame._particleParamsBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+        //! Every pass consumes the previous one's counts and indirect arguments
+        auto barrier = [&]() {
+            memory_barrier(cmd,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                           VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+        };
+        uint32_t dispatchCount = 0;
+        auto dispatch = [&](VkPipeline pipeline, VkDeviceSize argsOffset, uint32_t stage, uint32_t sortBlock, uint32_t sortStride) {
+            GPUParticlePushConstants pushConstants{
+                .params = get_buffer_device_address(_device, frame._particleParamsBuffer.buffer),
+                .stage = stage,
+                .sortBlock = sortBlock,
+                .sortStride = sortStride,
+            };
+            vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+            vkd.vkCmdPushConstants(cmd, _particleLayout,
+                                   VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   0, sizeof(pushConstants), &pushConstants);
+            if (argsOffset == VK_WHOLE_SIZE) {
+                vkd.vkCmdDispatch(cmd, 1, 1, 1);
+            } else {
+                vkd.vkCmdDispatchIndirect(cmd, _particleCounterBuffer.buffer, argsOffset);
+            }
+            dispatchCount++;
+        };
+
+        //! Last frame's draw read the list emission appends to and the arguments about to be rewritten
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT);
+        dispatch(_particleCountersPipeline, VK_WHOLE_SIZE, PARTICLE_STAGE_BEGIN, 0, 0);
+        barrier();
+        dispatch(_particleEmitPipeline, offsetof(GPUParticleCounters, emitArgs), 0, 0, 0);
+        barrier();
+        dispatch(_particleSimulatePipeline, offsetof(GPUParticleCounters, simulateArgs), 0, 0, 0);
+        barrier();
+        dispatch(_particleCountersPipeline, VK_WHOLE_SIZE, PARTICLE_STAGE_END, 0, 0);
+        barrier();
+
+        if (_particleSorting) {
+            //! Recorded for the largest possible list, steps past this frame's size return right away.
+            //! Strides below a workgroup's element count are merged in shared memory by one dispatch.
+            VkDeviceSize sortArgs = offsetof(GPUParticleCounters, sortArgs);
+            dispatch(_particleSortPipeline, sortArgs, PARTICLE_SORT_LOCAL, 0, 0);
+            barrier();
+            for (uint32_t block = PARTICLE_SORT_GROUP_ELEMENTS * 2; block <= _particleSortCapacity; block *= 2) {
+                for (uint32_t stride = block / 2; stride >= PARTICLE_SORT_GROUP_ELEMENTS; stride /= 2) {
+                    dispatch(_particleSortPipeline, sortArgs, PARTICLE_SORT_GLOBAL_STEP, block, stride);
+                    barrier();
+                }
+                dispatch(_particleSortPipeline, sortArgs, PARTICLE_SORT_LOCAL_MERGE, block, 0);
+                barrier();
+            }
+        }
+
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+                       VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT);
+        _particleFrame++;
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        _profiler.set_timing("CPU Record Particles", elapsed.count());
+        _profiler.set_counter("Particle Dispatches", dispatchCount);
+        _profiler.set_counter("Particles Requested per Frame", emitRequest);
+    }
+    void BlueVKEngine::draw_skinning(VkCommandBuffer cmd) {
+        FrameData &frame = get_current_frame();
+        VkDeviceAddress vertices = get_buffer_device_address(_device, _vertexBuffer.buffer);
+        GPUSkinningPushConstants pushConstants{
+            .sourceQuantization = _skinSourceQuantization,
+            .outputQuantization = _skinOutputQuantization,
+            .sourceVertices = vertices,
+            .outputVertices = vertices,
+            .jointPoses = get_buffer_device_address(_device, frame._jointPoseBuffer.buffer),
+            .skeleton = get_buffer_device_address(_device, _skeletonBuffer.buffer),
+            .skinMatrices = get_buffer_device_address(_device, _skinMatrixBuffer.buffer),
+            .influences = get_buffer_device_address(_device, _skinInfluenceBuffer.buffer),
+            .sourceVertexOffset = _skinSourceVertexOffset,
+            .outputVertexOffset = _skinOutputVertexOffset,
+            .vertexCount = _skinVertexCount,
+            .jointCount = _skeleton.get_joint_count(),
+            .jointStride = _skeleton.get_joint_stride(),
+            .instanceCount = _animatedInstanceCount,
+        };
+        uint32_t jointThreads = _animatedInstanceCount * pushConstants.jointCount;
+        uint32_t vertexThreads = _animatedInstanceCount * _skinVertexCount;
+
+        //! Last frame's passes read the skinned vertices and matrices about to be rewritten
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT);
+        vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _skinJointsPipeline);
+        vkd.vkCmdPushConstants(cmd, _skinningLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkd.vkCmdDispatch(cmd, (jointThreads + SKINNING_GROUP_SIZE - 1) / SKINNING_GROUP_SIZE, 1, 1);
+
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT);
+        vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _skinVerticesPipeline);
+        vkd.vkCmdDispatch(cmd, (vertexThreads + SKINNING_GROUP_SIZE - 1) / SKINNING_GROUP_SIZE, 1, 1);
+
+        //! Every later pass pulls the skinned vertices like any other mesh's
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT);
+        _profiler.set_counter("Skinned Vertices", vertexThreads);
+    }
+    void BlueVKEngine::draw_shadows(VkCommandBuffer cmd) {
+        FrameData &frame = get_current_frame();
+        VkExtent2D extent{SHADOW_MAP_SIZE, SHADOW_MAP_SIZE};
+        auto draw_casters = [&](uint32_t cascade, VkImageView view, VkAttachmentLoadOp loadOp, uint32_t firstDraw, uint32_t drawCount) {
+            VkRenderingAttachmentInfo depthAttachment = depth_attachment_info(view, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, loadOp);
+            VkRenderingInfo renderInfo = rendering_info(extent, nullptr, &depthAttachment);
+            vkd.vkCmdBeginRendering(cmd, &renderInfo);
+
+            VkViewport viewport{
+                .x = 0,
+                .y = 0,
+                .width = (float)extent.width,
+                .height = (float)extent.height,
+                .minDepth = 0.0f,
+                .maxDepth = 1.0f,
+            };
+            VkRect2D scissor{
+                .offset = VkOffset2D{0, 0},
+                .extent = extent,
+            };
+            vkd.vkCmdSetViewport(cmd, 0, 1, &viewport);
+            vkd.vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+            GPUShadowPushConstants pushConstants{
+                .viewProj = _shadowCascades[cascade].viewProj,
+                .objectBuffer = get_buffer_device_address(_device, _objectBuffer.buffer),
+                .vertexBuffer = get_buffer_device_address(_device, _vertexBuffer.buffer),
+            };
+            vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _shadowPipeline);
+            vkd.vkCmdPushConstants(cmd, _shadowLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+            vkd.vkCmdBindIndexBuffer(cmd, _indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+            if (drawCount > 0) {
+                vkd.vkCmdDrawIndexedIndirect(cmd, frame._shadowCommandBuffer.buffer,
+                                         ((size_t)cascade * _objectCount + firstDraw) * sizeof(GPUDrawCommand),
+                                         drawCount, sizeof(GPUDrawCommand));
+            }
+            vkd.vkCmdEndRendering(cmd);
+        };
+
+        //! Both scopes are always recorded, a frame that hits the cache shows up as close to zero
+        _profiler.begin_scope(cmd, "Shadows: Static");
+        //! Last frame's copy may still be reading the cache
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+                       VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                       VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            if (_shadowStaticDirty[i]) {
+                draw_casters(i, _shadowStaticLayerViews[i], VK_ATTACHMENT_LOAD_OP_CLEAR, 0, _shadowStaticDraws[i]);
+            }
+        }
+
+        std::vector<VkImageCopy2> copies{};
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            if (!_shadowComposite[i]) {
+                continue;
+            }
+            VkImageSubresourceLayers layer{
+                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = i,
+                .layerCount = 1,
+            };
+            copies.push_back(VkImageCopy2{
+                .sType = VK_STRUCTURE_TYPE_IMAGE_COPY_2,
+                .pNext = nullptr,
+                .srcSubresource = layer,
+                .srcOffset = {0, 0, 0},
+                .dstSubresource = layer,
+                .dstOffset = {0, 0, 0},
+                .extent = {extent.width, extent.height, 1},
+            });
+        }
+        if (!copies.empty()) {
+            transition_image(cmd, _shadowStaticImage.image, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            transition_image(cmd, _shadowImage.image, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            VkCopyImageInfo2 copyInfo{
+                .sType = VK_STRUCTURE_TYPE_COPY_IMAGE_INFO_2,
+                .pNext = nullptr,
+                .srcImage = _shadowStaticImage.image,
+                .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                .dstImage = _shadowImage.image,
+                .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .regionCount = (uint32_t)copies.size(),
+                .pRegions = copies.data(),
+            };
+            vkd.vkCmdCopyImage2(cmd, &copyInfo);
+            transition_image(cmd, _shadowStaticImage.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+            transition_image(cmd, _shadowImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+        }
+        _profiler.end_scope(cmd);
+
+        _profiler.begin_scope(cmd, "Shadows: Dynamic");
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            if (_shadowComposite[i] && _shadowDynamicDraws[i] > 0) {
+                draw_casters(i, _shadowLayerViews[i], VK_ATTACHMENT_LOAD_OP_LOAD, _shadowStaticDraws[i], _shadowDynamicDraws[i]);
+            }
+        }
+        if (!copies.empty()) {
+            transition_image(cmd, _shadowImage.image, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+        }
+        _profiler.end_scope(cmd);
+    }
+    void BlueVKEngine::draw_particles(VkCommandBuffer cmd) {
+        //! The geometry pass has to finish writing color and depth before they are blended and tested against
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                       VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
+                       VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                           VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
+
+        VkRenderingAttachmentInfo colorAttachment = attachment_info(_drawImage.view, nullptr, VK_IMAGE_LAYOUT_GENERAL);
+        VkRenderingAttachmentInfo depthAttachment = depth_attachment_info(_depthImage.view,
+                                                                          VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                                                          VK_ATTACHMENT_LOAD_OP_LOAD);
+        VkRenderingInfo renderInfo = rendering_info(_drawExtent, &colorAttachment, &depthAttachment);
+        vkd.vkCmdBeginRendering(cmd, &renderInfo);
+
+        VkViewport viewport{
+            .x = 0,
+            .y = 0,
+            .width = (float)_drawExtent.width,
+            .height = (float)_drawExtent.height,
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+        };
+        VkRect2D scissor{
+            .offset = VkOffset2D{0, 0},
+            .extent = _drawExtent,
+        };
+        vkd.vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkd.vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+        GPUParticlePushConstants pushConstants{
+            .params = get_buffer_device_address(_device, get_current_frame()._particleParamsBuffer.buffer),
+        };
+        vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _particleDrawPipeline);
+        vkd.vkCmdPushConstants(cmd, _particleLayout,
+                               VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                               0, sizeof(pushConstants), &pushConstants);
+        //! The instance count is the number of survivors the simulation wrote
+        vkd.vkCmdDrawIndirect(cmd, _particleCounterBuffer.buffer, offsetof(GPUParticleCounters, drawArgs), 1, sizeof(VkDrawIndirectCommand));
+
+        vkd.vkCmdEndRendering(cmd);
+    }
+    void BlueVKEngine::draw_imgui(VkCommandBuffer cmd, VkImageView view) {
+        VkRenderingAttachmentInfo colorAttachment = attachment_info(view, nullptr, VK_IMAGE_LAYOUT_GENERAL);
+        VkRenderingInfo renderInfo = rendering_info(_swapchainExtent, &colorAttachment, nullptr);
+        vkd.vkCmdBeginRendering(cmd, &renderInfo);
+        ImGui_ImplVulkan_RenderDrawData(_imguiDrawData, cmd);
+        vkd.vkCmdEndRendering(cmd);
+    }
+    void BlueVKEngine::draw_temporal_upscale(VkCommandBuffer cmd) {
+        _historyIndex = 1 - _historyIndex;
+        BlueVKImage &output = _historyImages[_historyIndex];
+        BlueVKImage &history = _historyImages[1 - _historyIndex];
+
+        if (!_historyValid) {
+            transition_image(cmd, history.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        }
+        transition_image(cmd, output.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+        VkExtent2D outputExtent = get_upscale_extent();
+        TemporalUpscalePushConstants pushConstants{
+            .sceneData = get_buffer_device_address(_device, get_current_frame()._sceneDataBuffer.buffer),
+            .inputSize = glm::ivec2{_drawExtent.width, _drawExtent.height},
+            .outputSize = glm::ivec2{outputExtent.width, outputExtent.height},
+            .reset = _historyValid ? 0u : 1u,
+        };
+        vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _upscalePipeline);
+        vkd.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _upscaleLayout, 0, 1, &_upscaleDescriptorSets[_historyIndex], 0, nullptr);
+        vkd.vkCmdPushConstants(cmd, _upscaleLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkd.vkCmdDispatch(cmd, (outputExtent.width + 15) / 16, (outputExtent.height + 15) / 16, 1);
+
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                       VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT);
+        _historyValid = true;
+    }
+    void BlueVKEngine::draw_composite(VkCommandBuffer cmd, VkImageView view, VkExtent2D sourceExtent) {
+        //! Every pixel is written, the previous content never has to be loaded
+        VkRenderingAttachmentInfo colorAttachment = attachment_info(view, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        VkRenderingInfo renderInfo = rendering_info(_swapchainExtent, &colorAttachment, nullptr);
+        vkd.vkCmdBeginRendering(cmd, &renderInfo);
+
+        VkViewport viewport{
+            .x = 0,
+            .y = 0,
+            .width = (float)_swapchainExtent.width,
+            .height = (float)_swapchainExtent.height,
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+        };
+        VkRect2D scissor{
+            .offset = VkOffset2D{0, 0},
+            .extent = _swapchainExtent,
+        };
+        vkd.vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkd.vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+        //! Both the draw image and the upscaler's output are the size of _drawImage
+        CompositePushConstants pushConstants{
+            .uvScale = glm::vec2{(float)sourceExtent.width / _drawImage.extent.width,
+                                 (float)sourceExtent.height / _drawImage.extent.height},
+            .exposure = _exposure,
+            .tonemapper = (uint32_t)_tonemapper,
+            .bloomSourceSize = glm::vec2{(float)sourceExtent.width, (float)sourceExtent.height},
+            .bloomIntensity = _bloom && _downsampleSupported ? _bloomIntensity : 0.0f,
+            .bloomLevels = _bloomImage.mipLevels,
+        };
+        vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _compositePipeline);
+        VkDescriptorSet source = _temporalUpscale ? _compositeHistoryDescriptorSets[_historyIndex] : _compositeDescriptorSet;
+        vkd.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _compositeLayout, 0, 1, &source, 0, nullptr);
+        vkd.vkCmdPushConstants(cmd, _compositeLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkd.vkCmdDraw(cmd, 3, 1, 0, 0);
+
+        ImGui_ImplVulkan_RenderDrawData(_imguiDrawData, cmd);
+
+        vkd.vkCmdEndRendering(cmd);
+    }
+    void BlueVKEngine::draw_bloom(VkCommandBuffer cmd, VkExtent2D sourceExtent) {
+        //! The upscaler's output stays in GENERAL, it's read as history next frame
+        if (_temporalUpscale) {
+            _downsampler.downsample(cmd, _historyImages[_historyIndex].view, VK_IMAGE_LAYOUT_GENERAL, sourceExtent, _bloomImage);
+        } else {
+            _downsampler.downsample(cmd, _drawImage.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sourceExtent, _bloomImage);
+        }
+    }
+    void BlueVKEngine::report_present_traffic() {
+        //! Estimated attachment traffic from the end of the scene to present, ImGui's own draws aside.
+        //! Blit path: read the draw region, write it to the swapchain, then the ImGui pass loads and stores the whole swapchain.
+        //! Composite path: read the draw region, write the whole swapchain once.
+        double drawBytes = (double)_drawExtent.width * _drawExtent.height * get_draw_format_size(_drawFormat);
+        double swapchainBytes = (double)_swapchainExtent.width * _swapchainExtent.height * 4.0;
+        double blitRegionBytes = (double)_drawExtent.width * _drawExtent.height * 4.0;
+        double blitPath = drawBytes + blitRegionBytes + 2.0 * swapchainBytes;
+        double compositePath = drawBytes + swapchainBytes;
+
+        constexpr double MB = 1024.0 * 1024.0;
+        _profiler.set_counter("Present Traffic (MB, est.)", (_compositePresent ? compositePath : blitPath) / MB);
+        _profiler.set_counter("Present Traffic Saved (MB, est.)", (blitPath - compositePath) / MB);
+    }
+    void BlueVKEngine::select_formats() {
+        //! Formats are fixed for the engine's lifetime, pipelines are built before the images exist
+        _swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+        _depthImage.format = VK_FORMAT_D32_SFLOAT;
+
+        //! Everything the draw image is used for: compute writes, rendering, sampling and the present blit
+        constexpr VkFormatFeatureFlags REQUIRED_FEATURES = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT |
+                                                           VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT |
+                                                           VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                           VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+                                                           VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                                           VK_FORMAT_FEATURE_BLIT_DST_BIT;
+        std::vector<VkFormat> candidates{VK_FORMAT_R16G16B16A16_SFLOAT};
+        if (_drawFormatPolicy == DRAW_FORMAT_PACKED && _storageImageExtendedFormats) {
+            candidates.insert(candidates.begin(), VK_FORMAT_B10G11R11_UFLOAT_PACK32);
+        }
+
+        _drawFormat = VK_FORMAT_UNDEFINED;
+        for (VkFormat format : candidates) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(_physicalDevice, format, &properties);
+            if ((properties.optimalTilingFeatures & REQUIRED_FEATURES) == REQUIRED_FEATURES) {
+                _drawFormat = format;
+                break;
+            }
+        }
+        if (_drawFormat == VK_FORMAT_UNDEFINED) {
+            throw std::runtime_error("[BlueVK]::[ERROR]: No supported draw image format!");
+        }
+        _drawImage.format = _drawFormat;
+
+        double pixels = (double)_windowSize.width * _windowSize.height;
+        fmt::println("[BlueVK]::[FORMAT]: Draw image format {} ({} bytes per pixel, {:.1f} MB at {}x{})",
+                     string_VkFormat(_drawFormat),
+                     get_draw_format_size(_drawFormat),
+                     pixels * get_draw_format_size(_drawFormat) / (1024.0 * 1024.0),
+                     _windowSize.width,
+                     _windowSize.height);
+    }
+    std::string BlueVKEngine::get_draw_format_shader(const char *shader) const {
+        if (_drawFormat == VK_FORMAT_B10G11R11_UFLOAT_PACK32) {
+            return fmt::format("assets/shaders/{}.r11g11b10.spv", shader);
+        }
+        return fmt::format("assets/shaders/{}.spv", shader);
+    }
+    void BlueVKEngine::report_draw_target_traffic() {
+        //! Estimated draw image accesses per frame: the background write (or the cached copy's write),
+        //! the geometry pass load and store and the read by the upscaler or present. The savings are
+        //! against the R16G16B16A16 layout the engine used before
+        double accesses = 4.0;
+        double pixels = (double)_drawExtent.width * _drawExtent.height;
+        double bytes = pixels * accesses * get_draw_format_size(_drawFormat);
+        double baseline = pixels * accesses * get_draw_format_size(VK_FORMAT_R16G16B16A16_SFLOAT);
+
+        constexpr double MB = 1024.0 * 1024.0;
+        _profiler.set_counter("Draw Target Traffic (MB, est.)", bytes / MB);
+        _profiler.set_counter("Draw Target Traffic Saved (MB, est.)", (baseline - bytes) / MB);
+    }
+    void BlueVKEngine::create_swapchain(VkExtent2D size) {
+        uint32_t presentModeCount = 0;
+        vkGetPhysicalDeviceSurfacePresentModesKHR(_physicalDevice, _surface, &presentModeCount, nullptr);
+        _supportedPresentModes.resize(presentModeCount);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(_physicalDevice, _surface, &presentModeCount, _supportedPresentModes.data());
+        //! FIFO is the only mode every surface has to support
+        _presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        if (std::find(_supportedPresentModes.begin(), _supportedPresentModes.end(), _requestedPresentMode) != _supportedPresentModes.end()) {
+            _presentMode = _requestedPresentMode;
+        } else {
+            fmt::println("[BlueVK]::[WARNING]: {} is not supported by the surface, using FIFO",
+                         string_VkPresentModeKHR(_requestedPresentMode));
+        }
+
+        VkSurfaceCapabilitiesKHR capabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_physicalDevice, _surface, &capabilities);
+        uint32_t maxImageCount = capabilities.maxImageCount == 0 ? UINT32_MAX : capabilities.maxImageCount;
+        uint32_t imageCount = std::clamp(_swapchainImageCount, std::max(capabilities.minImageCount, 2u), maxImageCount);
+
+        vkb::Result<vkb::Swapchain> swapchainReturn =
+            vkb::SwapchainBuilder{_physicalDevice, _device, _surface}
+                .set_desired_format(VkSurfaceFormatKHR{.format = _swapchainImageFormat,
+                                                       .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR})
+                .set_desired_present_mode(_presentMode)
+                .set_desired_min_image_count(imageCount)
+                .set_desired_extent(size.width, size.height)
+                .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+                .build();
+        if (!swapchainReturn.has_value()) {
+            throw std::runtime_error(fmt::format("[BLueVK]::[ERROR]: Failed to create a swapchain:\n{}", swapchainReturn.error().value()));
+        }
+        vkb::Swapchain vkbSwapchain = swapchainReturn.value();
+
+        _swapchain = vkbSwapchain;
+        _swapchainExtent = vkbSwapchain.extent;
+        _swapchainImages = vkbSwapchain.get_images().value();
+        _swapchainImageViews = vkbSwapchain.get_image_views().value();
+        _swapchainFirstPresentId = _presentId + 1;
+        fmt::println("[BlueVK]::[PRESENT]: {} with {} images, present wait {}",
+                     string_VkPresentModeKHR(_presentMode),
+                     _swapchainImages.size(),
+                     _presentWait ? "on" : "off");
+    }
+    void BlueVKEngine::create_draw_images() {
+        _drawImage.extent = _windowSize;
+        VmaAllocationCreateInfo allocCreateInfo{
+            .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+            .requiredFlags = VkMemoryPropertyFlags{VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT},
+        };
+        _drawImage.image = ImageBuilder{}
+                               .set_extent(_windowSize)
+                               .set_format(_drawImage.format)
+                               .set_usage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                          VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                          VK_IMAGE_USAGE_STORAGE_BIT |
+                                          VK_IMAGE_USAGE_SAMPLED_BIT |
+                                          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
+                               .vmaBuild(_vmaAllocator, &allocCreateInfo, &_drawImage.allocation, nullptr);
+        _drawImage.view = ImageViewBuilder{}
+                              .set_format(_drawImage.format)
+                              .set_image(_drawImage.image)
+                              .build(_device);
+
+        //! Static background effects render here once, it's copied into the draw image every frame
+        _backgroundImage.format = _drawImage.format;
+        _backgroundImage.extent = _windowSize;
+        _backgroundImage.image = ImageBuilder{}
+                                     .set_extent(_windowSize)
+                                     .set_format(_backgroundImage.format)
+                                     .set_usage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                                VK_IMAGE_USAGE_STORAGE_BIT)
+                                     .vmaBuild(_vmaAllocator, &allocCreateInfo, &_backgroundImage.allocation, nullptr);
+        _backgroundImage.view = ImageViewBuilder{}
+                                    .set_format(_backgroundImage.format)
+                                    .set_image(_backgroundImage.image)
+                                    .build(_device);
+        _backgroundValid = false;
+
+        //! History accumulates over many frames, it stays at full precision whatever the draw format is
+        for (BlueVKImage &historyImage : _historyImages) {
+            historyImage.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+            historyImage.extent = _windowSize;
+            historyImage.image = ImageBuilder{}
+                                     .set_extent(_windowSize)
+                                     .set_format(historyImage.format)
+                                     .set_usage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                                VK_IMAGE_USAGE_STORAGE_BIT |
+                                                VK_IMAGE_USAGE_SAMPLED_BIT)
+                                     .vmaBuild(_vmaAllocator, &allocCreateInfo, &historyImage.allocation, nullptr);
+            historyImage.view = ImageViewBuilder{}
+                                    .set_format(historyImage.format)
+                                    .set_image(historyImage.image)
+                                    .build(_device);
+        }
+        _historyValid = false;
+
+        _depthImage.extent = _windowSize;
+        _depthImage.image = ImageBuilder{}
+                                .set_extent(_windowSize)
+                                .set_format(_depthImage.format)
+                                .set_usage(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                           VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                           VK_IMAGE_USAGE_SAMPLED_BIT)
+                                .vmaBuild(_vmaAllocator, &allocCreateInfo, &_depthImage.allocation, nullptr);
+        _depthImage.view = ImageViewBuilder{}
+                               .set_format(_depthImage.format)
+                               .set_image(_depthImage.image)
+                               .set_subresource_range_aspect(VK_IMAGE_ASPECT_DEPTH_BIT)
+                               .build(_device);
+
+        //! Level 0 of the pyramid is half the depth resolution, every level after that halves again
+        VkExtent2D pyramidExtent{
+            std::max((_depthImage.extent.width + 1) / 2, 1u),
+            std::max((_depthImage.extent.height + 1) / 2, 1u),
+        };
+        _depthPyramid.format = VK_FORMAT_R32_SFLOAT;
+        _depthPyramid.extent = pyramidExtent;
+        _depthPyramid.mipLevels = (uint32_t)std::floor(std::log2(std::max(pyramidExtent.width, pyramidExtent.height))) + 1;
+        _depthPyramid.image = ImageBuilder{}
+                                  .set_extent(pyramidExtent)
+                                  .set_format(_depthPyramid.format)
+                                  .set_mip_levels(_depthPyramid.mipLevels)
+                                  .set_usage(VK_IMAGE_USAGE_STORAGE_BIT |
+                                             VK_IMAGE_USAGE_SAMPLED_BIT)
+                                  .vmaBuild(_vmaAllocator, &allocCreateInfo, &_depthPyramid.allocation, nullptr);
+        _depthPyramid.view = ImageViewBuilder{}
+                                 .set_format(_depthPyramid.format)
+                                 .set_image(_depthPyramid.image)
+                                 .set_mip_range(0, _depthPyramid.mipLevels)
+                                 .build(_device);
+        _depthPyramidMips.resize(_depthPyramid.mipLevels);
+        for (uint32_t mip = 0; mip < _depthPyramid.mipLevels; mip++) {
+            _depthPyramidMips[mip] = ImageViewBuilder{}
+                                         .set_format(_depthPyramid.format)
+                                         .set_image(_depthPyramid.image)
+                                         .set_mip_range(mip, 1)
+                                         .build(_device);
+        }
+        _depthPyramidValid = false;
+
+        //! Level 0 of the bloom chain is half the window, the composite pass only samples what the present extent covers
+        VkExtent2D bloomExtent{
+            std::max(_windowSize.width / 2, 1u),
+            std::max(_windowSize.height / 2, 1u),
+        };
+        _bloomImage.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+        _bloomImage.extent = bloomExtent;
+        _bloomImage.mipLevels = std::min(BLOOM_MIP_COUNT,
+                                         (uint32_t)std::floor(std::log2(std::max(bloomExtent.width, bloomExtent.height))) + 1);
+        _bloomImage.image = ImageBuilder{}
+                                .set_extent(bloomExtent)
+                                .set_format(_bloomImage.format)
+                                .set_mip_levels(_bloomImage.mipLevels)
+                                .set_usage(VK_IMAGE_USAGE_STORAGE_BIT |
+                                           VK_IMAGE_USAGE_SAMPLED_BIT)
+                                .vmaBuild(_vmaAllocator, &allocCreateInfo, &_bloomImage.allocation, nullptr);
+        _bloomImage.view = ImageViewBuilder{}
+                               .set_format(_bloomImage.format)
+                               .set_image(_bloomImage.image)
+                               .set_mip_range(0, _bloomImage.mipLevels)
+                               .build(_device);
+        _bloomValid = false;
+    }
+    BlueVKBuffer BlueVKEngine::create_buffer(size_t size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
+        VmaAllocationCreateInfo allocCreateInfo{
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = memoryUsage,
+        };
+        BlueVKBuffer buffer;
+        buffer.buffer = BufferBuilder{}
+                            .set_size(size)
+                            .set_usage(usage)
+                            .vmaBuild(_vmaAllocator, &allocCreateInfo, &buffer.allocation, &buffer.info);
+        return buffer;
+    }
+    BlueVKBuffer BlueVKEngine::upload_buffer(const void *data, size_t size, VkBufferUsageFlags usage) {
+        BlueVKBuffer buffer = create_buffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+        BlueVKBuffer staging = create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        memcpy(staging.info.pMappedData, data, size);
+        immediate_submit([&](VkCommandBuffer cmd) {
+            copy_buffer_to_buffer(cmd, staging.buffer, buffer.buffer, size);
+        });
+        destroy_buffer(staging);
+        return buffer;
+    }
+    void BlueVKEngine::update_draw_image_descriptors() {
+        _mainDescriptorAllocator.clear(_device);
+
+        _drawImageDescriptorSet = _mainDescriptorAllocator.allocate(_device, _drawImageDescriptorLayout);
+        DescriptorSetWriter{}
+            .write_image(0, _drawImage.view, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+            .update(_device, _drawImageDescriptorSet);
+
+        _backgroundDescriptorSet = _mainDescriptorAllocator.allocate(_device, _drawImageDescriptorLayout);
+        DescriptorSetWriter{}
+            .write_image(0, _backgroundImage.view, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+            .update(_device, _backgroundDescriptorSet);
+
+        _compositeDescriptorSet = _mainDescriptorAllocator.allocate(_device, _compositeDescriptorLayout);
+        DescriptorSetWriter{}
+            .write_image(0, _drawImage.view, _compositeSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+            .write_image(1, _bloomImage.view, _compositeSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+            .update(_device, _compositeDescriptorSet);
+
+        for (uint32_t i = 0; i < 2; i++) {
+            _compositeHistoryDescriptorSets[i] = _mainDescriptorAllocator.allocate(_device, _compositeDescriptorLayout);
+            DescriptorSetWriter{}
+                .write_image(0, _historyImages[i].view, _compositeSampler, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                .write_image(1, _bloomImage.view, _compositeSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                .update(_device, _compositeHistoryDescriptorSets[i]);
+
+            //! Set i writes history image i and reads the other one
+            _upscaleDescriptorSets[i] = _mainDescriptorAllocator.allocate(_device, _upscaleDescriptorLayout);
+            DescriptorSetWriter{}
+                .write_image(0, _drawImage.view, _compositeSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                .write_image(1, _depthImage.view, _depthPyramidSampler, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                .write_image(2, _historyImages[1 - i].view, _compositeSampler, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                .write_image(3, _historyImages[i].view, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+                .update(_device, _upscaleDescriptorSets[i]);
+        }
+
+        _cullDescriptorSet = _mainDescriptorAllocator.allocate(_device, _cullDescriptorLayout);
+        DescriptorSetWriter{}
+            .write_image(0, _depthPyramid.view, _depthPyramidSampler, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+            .update(_device, _cullDescriptorSet);
+
+        _depthReduceDescriptorSets.resize(_depthPyramid.mipLevels);
+        for (uint32_t mip = 0; mip < _depthPyramid.mipLevels; mip++) {
+            DescriptorSetWriter writer{};
+            if (mip == 0) {
+                writer.write_image(0, _depthImage.view, _depthPyramidSampler, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+            } else {
+                writer.write_image(0, _depthPyramidMips[mip - 1], _depthPyramidSampler, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+            }
+            writer.write_image(1, _depthPyramidMips[mip], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+
+            _depthReduceDescriptorSets[mip] = _mainDescriptorAllocator.allocate(_device, _depthReduceDescriptorLayout);
+            writer.update(_device, _depthReduceDescriptorSets[mip]);
+        }
+    }
+    void BlueVKEngine::update_scene_data(FrameData &frame) {
+        float aspect = (float)_drawExtent.width / (float)_drawExtent.height;
+        glm::mat4 view = _camera.get_view();
+        glm::mat4 projNoJitter = _camera.get_projection(aspect);
+        glm::mat4 proj = projNoJitter;
+
+        //! Every frame samples a different sub-pixel position, more phases the further the upscaler stretches
+        _jitter = glm::vec2{0.0f};
+        if (_temporalUpscale) {
+            float upscale = (float)get_upscale_extent().width / std::max(_drawExtent.width, 1u);
+            uint32_t phaseCount = std::clamp((uint32_t)std::ceil(8.0f * upscale * upscale), 8u, 64u);
+            _jitterIndex = (_jitterIndex + 1) % phaseCount;
+            _jitter = glm::vec2{halton(_jitterIndex + 1, 2) - 0.5f, halton(_jitterIndex + 1, 3) - 0.5f};
+            //! Clip w is -z_view, so the offset is subtracted to move the image by +_jitter pixels
+            proj[2][0] -= 2.0f * _jitter.x / _drawExtent.width;
+            proj[2][1] -= 2.0f * _jitter.y / _drawExtent.height;
+        }
+        glm::mat4 viewProjNoJitter = projNoJitter * view;
+
+        GPUSceneData sceneData{
+            .view = view,
+            .proj = proj,
+            .viewProj = proj * view,
+            .prevView = _prevView,
+            .prevProj = _prevProj,
+            .cameraPosition = glm::vec4{_camera.get_position(), 1.0f},
+            .viewportSize = glm::vec4{_drawExtent.width, _drawExtent.height,
+                                      _depthPyramidExtent.width, _depthPyramidExtent.height},
+            .pyramidInfo = glm::uvec4{
+                std::max((_depthPyramidExtent.width + 1) / 2, 1u),
+                std::max((_depthPyramidExtent.height + 1) / 2, 1u),
+                _depthPyramid.mipLevels,
+                (_occlusionCulling && _depthPyramidValid) ? 1u : 0u,
+            },
+            .invViewProj = glm::inverse(viewProjNoJitter),
+            .prevViewProjNoJitter = _prevViewProjNoJitter,
+            .jitter = glm::vec4{_jitter, 0.0f, 0.0f},
+            .lightDirection = glm::vec4{_lightDirection, _shadows ? 1.0f : 0.0f},
+        };
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            const ShadowCascade &cascade = _shadowCascades[i];
+            sceneData.shadowViewProj[i] = cascade.viewProj;
+            sceneData.shadowSplits[i] = cascade.splitFar;
+            sceneData.shadowTexelSizes[i] = 2.0f * cascade.halfSize / SHADOW_MAP_SIZE;
+        }
+        extract_frustum_planes(sceneData.viewProj, sceneData.frustumPlanes);
+        memcpy(frame._sceneDataBuffer.info.pMappedData, &sceneData, sizeof(GPUSceneData));
+        vmaFlushAllocation(_vmaAllocator, frame._sceneDataBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+        //! The depth pyramid built at the end of this frame is tested against with these matrices next frame
+        _prevView = view;
+        _prevProj = proj;
+        _prevViewProjNoJitter = viewProjNoJitter;
+    }
+    void BlueVKEngine::build_draw_list(FrameData &frame) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        fill_draw_list();
+        _drawList.build(_jobs);
+
+        //! instanceCount starts at zero, culling appends every visible instance to its batch
+        const std::vector<DrawBatch> &batches = _drawList.get_batches();
+        GPUDrawCommand *commands = (GPUDrawCommand *)frame._drawCommandBuffer.info.pMappedData;
+        for (uint32_t i = 0; i < batches.size(); i++) {
+            const MeshInfo &mesh = _meshes[batches[i].mesh];
+            commands[i] = GPUDrawCommand{
+                .indexCount = mesh.indexCount,
+                .instanceCount = 0,
+                .firstIndex = mesh.firstIndex,
+                .vertexOffset = mesh.vertexOffset,
+                .firstInstance = batches[i].firstInstance,
+            };
+        }
+        vmaFlushAllocation(_vmaAllocator, frame._drawCommandBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+        const std::vector<GPUDrawCandidate> &candidates = _drawList.get_candidates();
+        memcpy(frame._drawCandidateBuffer.info.pMappedData, candidates.data(), candidates.size() * sizeof(GPUDrawCandidate));
+        vmaFlushAllocation(_vmaAllocator, frame._drawCandidateBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        _profiler.set_timing("CPU Draw List", elapsed.count());
+    }
+    void BlueVKEngine::fill_draw_list() {
+        _drawList.resize(_objectCount);
+
+        //! A LOD is used once its error covers at most _lodErrorPixels on screen. Pixels per world unit at
+        //! distance d are pixelsPerUnit / d, distances are taken to the closest point of the bounding sphere.
+        glm::vec3 cameraPosition = _camera.get_position();
+        float pixelsPerUnit = _drawExtent.height / (2.0f * std::tan(glm::radians(_camera.fovy) * 0.5f));
+        float maxErrorPerDistance = _meshLods ? _lodErrorPixels / pixelsPerUnit : 0.0f;
+        std::atomic<uint64_t> submittedTriangles{0};
+        std::atomic<uint64_t> fullDetailTriangles{0};
+
+        JobCounter counter{};
+        _jobs.parallel_for(_objectCount, 4096, [&](uint32_t begin, uint32_t end) {
+            uint64_t submitted = 0;
+            uint64_t fullDetail = 0;
+            for (uint32_t i = begin; i < end; i++) {
+                const SceneObject &object = _sceneObjects[i];
+                const MeshLodChain &chain = _meshLodChains[object.mesh];
+                uint32_t mesh = chain.firstMesh;
+                if (maxErrorPerDistance > 0.0f && chain.lodCount > 1) {
+                    const glm::mat4 &model = object.data.model;
+                    float scale = std::max({glm::length(glm::vec3{model[0]}), glm::length(glm::vec3{model[1]}), glm::length(glm::vec3{model[2]})});
+                    glm::vec4 sphere = object.data.sphereBounds;
+                    float distance = std::max(glm::length(glm::vec3{sphere} - cameraPosition) - sphere.w, _camera.zNear);
+                    mesh += select_lod(&_meshes[chain.firstMesh], chain.lodCount, maxErrorPerDistance * distance / scale);
+                }
+                submitted += _meshes[mesh].indexCount / 3;
+                fullDetail += _meshes[chain.firstMesh].indexCount / 3;
+                _drawList.set(i, _meshDrawPipeline, NO_DESCRIPTOR_SET, mesh, i);
+            }
+            submittedTriangles.fetch_add(submitted, std::memory_order_relaxed);
+            fullDetailTriangles.fetch_add(fullDetail, std::memory_order_relaxed);
+        },
+                           &counter);
+        _jobs.wait(counter);
+
+        //! Before culling, culling stats count the selected LODs' triangles
+        _profiler.set_counter("Triangles Submitted", submittedTriangles.load());
+        _profiler.set_counter("Triangles Saved by LOD", fullDetailTriangles.load() - submittedTriangles.load());
+    }
+    void BlueVKEngine::sample_animations(FrameData &frame) {
+        if (_animatedInstanceCount == 0) {
+            return;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        if (_animate) {
+            _animationTime += std::min(_frameDeltaTime, 0.1f);
+        }
+
+        //! Every instance's pose is written straight into the frame's pose buffer in the shader's layout
+        uint32_t poseFloats = JOINT_CHANNEL_COUNT * _animationClip.jointStride;
+        float *poses = (float *)frame._jointPoseBuffer.info.pMappedData;
+        JobCounter counter{};
+        _jobs.parallel_for(_animatedInstanceCount, 64, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                glm::vec2 playback = _animationPlayback[i];
+                sample_clip(_animationClip, playback.x + _animationTime * playback.y, poses + (size_t)i * poseFloats);
+            }
+        },
+                           &counter);
+        _jobs.wait(counter);
+        vmaFlushAllocation(_vmaAllocator, frame._jointPoseBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        _profiler.set_timing("CPU Animation Sampling", elapsed.count());
+    }
+    void BlueVKEngine::update_shadow_cascades(FrameData &frame) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            _shadowStaticDirty[i] = false;
+            _shadowComposite[i] = false;
+            _shadowStaticDraws[i] = 0;
+            _shadowDynamicDraws[i] = 0;
+        }
+
+        //! A new light direction changes every projection, without the cache every frame starts over
+        glm::vec3 lightDirection{std::cos(_lightPitch) * std::cos(_lightYaw),
+                                 std::sin(_lightPitch),
+                                 std::cos(_lightPitch) * std::sin(_lightYaw)};
+        bool invalidate = lightDirection != _lightDirection || !_cacheShadows || !_shadows;
+        _lightDirection = lightDirection;
+        if (invalidate) {
+            for (ShadowCascade &cascade : _shadowCascades) {
+                cascade.staticValid = false;
+            }
+        }
+        if (!_shadows) {
+            return;
+        }
+
+        float aspect = (float)_drawExtent.width / (float)_drawExtent.height;
+        float splits[SHADOW_CASCADE_COUNT];
+        compute_cascade_splits(_camera.zNear, _shadowDistance, 0.75f, splits);
+        glm::mat4 lightView = get_light_view(_lightDirection);
+
+        GPUDrawCommand *commands = (GPUDrawCommand *)frame._shadowCommandBuffer.info.pMappedData;
+        auto write_caster = [&](uint32_t cascade, uint32_t object, uint32_t draw) {
+            const MeshLodChain &chain = _meshLodChains[_sceneObjects[object].mesh];
+            //! Further cascades have bigger texels, they take coarser LODs
+            const MeshInfo &mesh = _meshes[chain.firstMesh + std::min(cascade, chain.lodCount - 1)];
+            commands[(size_t)cascade * _objectCount + draw] = GPUDrawCommand{
+                .indexCount = mesh.indexCount,
+                .instanceCount = 1,
+                .firstIndex = mesh.firstIndex,
+                .vertexOffset = mesh.vertexOffset,
+                .firstInstance = object,
+            };
+        };
+
+        uint32_t staticRedraws = 0;
+        uint32_t composited = 0;
+        uint32_t casterDraws = 0;
+        float nearDistance = _camera.zNear;
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            ShadowCascade &cascade = _shadowCascades[i];
+            glm::vec4 sliceSphere = get_frustum_slice_sphere(_camera, aspect, nearDistance, splits[i]);
+            cascade.splitFar = splits[i];
+            nearDistance = splits[i];
+
+            bool dirty = update_shadow_cascade(cascade, lightView, sliceSphere, _shadowSceneBounds);
+            uint32_t draw = 0;
+            if (dirty) {
+                for (uint32_t object = 0; object < _dynamicObjectOffset; object++) {
+                    if (shadow_cascade_overlaps(cascade, lightView, _sceneObjects[object].data.sphereBounds)) {
+                        write_caster(i, object, draw++);
+                    }
+                }
+                cascade.staticValid = true;
+                _shadowStaticDraws[i] = draw;
+                staticRedraws++;
+            }
+            for (uint32_t object = _dynamicObjectOffset; object < _objectCount; object++) {
+                if (shadow_cascade_overlaps(cascade, lightView, _sceneObjects[object].data.sphereBounds)) {
+                    write_caster(i, object, draw++);
+                    _shadowDynamicDraws[i]++;
+                }
+            }
+
+            //! A layer that lost its dynamic casters still needs one more copy to erase them
+            bool hasDynamic = _shadowDynamicDraws[i] > 0;
+            _shadowStaticDirty[i] = dirty;
+            _shadowComposite[i] = dirty || hasDynamic || cascade.hadDynamic;
+            if (_shadowComposite[i]) {
+                cascade.hadDynamic = hasDynamic;
+                composited++;
+            }
+            casterDraws += draw;
+        }
+        vmaFlushAllocation(_vmaAllocator, frame._shadowCommandBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        _profiler.set_timing("CPU Shadow Casters", elapsed.count());
+        _profiler.set_counter("Shadow Cascades: Static Redraws", staticRedraws);
+        _profiler.set_counter("Shadow Cascades: Composited", composited);
+        _profiler.set_counter("Shadow Caster Draws", casterDraws);
+    }
+    void BlueVKEngine::measure_job_scaling() {
+        constexpr uint32_t ITERATIONS = 20;
+        uint32_t activeThreadCount = _jobs.get_active_thread_count();
+
+        _jobScaling.clear();
+        for (uint32_t threads = 1; threads <= _jobs.get_thread_count(); threads++) {
+            _jobs.set_active_thread_count(threads);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint32_t i = 0; i < ITERATIONS; i++) {
+                fill_draw_list();
+                _drawList.build(_jobs);
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+            _jobScaling.push_back(elapsed.count() / ITERATIONS);
+            fmt::println("[BlueVK]::[JOBS]: {} thread(s): draw list of {} objects in {:.3f} ms ({:.2f}x)",
+                         threads,
+                         _objectCount,
+                         _jobScaling.back(),
+                         _jobScaling.front() / _jobScaling.back());
+        }
+        _jobs.set_active_thread_count(activeThreadCount);
+    }
+    void BlueVKEngine::record_readbacks(VkCommandBuffer cmd) {
+        //! The draw image holds the lit scene before upscaling and tonemapping
+        if (_captureFramesLeft > 0) {
+            _readback.capture_image(cmd,
+                                    _drawImage,
+                                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                    _drawExtent,
+                                    fmt::format("{}/frame_{:06}", _captureDirectory, _frameNumber));
+            _captureFramesLeft--;
+        }
+
+        if (_pickRequested) {
+            _pickRequested = false;
+            //! The window shows the draw extent stretched by the composite pass, 1:1 with the blit
+            VkExtent2D shownExtent = _compositePresent ? _swapchainExtent : (_temporalUpscale ? get_upscale_extent() : _drawExtent);
+            VkOffset2D pixel{
+                std::clamp((int32_t)((float)_pickPosition.x * _drawExtent.width / shownExtent.width), 0, (int32_t)_drawExtent.width - 1),
+                std::clamp((int32_t)((float)_pickPosition.y * _drawExtent.height / shownExtent.height), 0, (int32_t)_drawExtent.height - 1),
+            };
+            glm::mat4 invViewProj = glm::inverse(_prevViewProjNoJitter);
+            glm::vec2 ndc{
+                (pixel.x + 0.5f) / _drawExtent.width * 2.0f - 1.0f,
+                (pixel.y + 0.5f) / _drawExtent.height * 2.0f - 1.0f,
+            };
+            _readback.read_image(cmd,
+                                 _depthImage,
+                                 VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+                                 pixel,
+                                 VkExtent2D{1, 1},
+                                 [this, invViewProj, ndc](const ReadbackResult &result) {
+                                     _pickDepth = *(const float *)result.data;
+                                     glm::vec4 world = invViewProj * glm::vec4{ndc, _pickDepth, 1.0f};
+                                     _pickWorldPosition = glm::vec3{world} / world.w;
+                                     _pickValid = true;
+                                 });
+        }
+        _profiler.set_counter("Readback Slots In Flight", _readback.get_slots_in_flight());
+        _profiler.set_counter("Readbacks Dropped", _readback.get_dropped_count());
+    }
+    void BlueVKEngine::report_first_frame() {
+        //! draw() waits for the frame's fence, the first frame has been rendered and handed to the presentation engine
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - _startupStart;
+        _profiler.set_counter("Startup: First Frame (ms)", elapsed.count());
+        fmt::println("[BlueVK]::[STARTUP]: First frame after {:.2f} ms", elapsed.count());
+    }
+    void BlueVKEngine::benchmark_dispatch() {
+        //! Records the same cheap command through the loader export and through the device table. Nothing
+        //! is submitted, the difference is only the call overhead the trampoline adds per command
+        constexpr uint32_t CALLS = 100000;
+        VkViewport viewport{
+            .width = (float)_windowSize.width,
+            .height = (float)_windowSize.height,
+            .maxDepth = 1.0f,
+        };
+        VkCommandBufferBeginInfo beginInfo = command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        auto measure = [&](PFN_vkCmdSetViewport setViewport) {
+            VK_CHECK(vkd.vkResetCommandBuffer(_immCommandBuffer, 0));
+            VK_CHECK(vkd.vkBeginCommandBuffer(_immCommandBuffer, &beginInfo));
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint32_t i = 0; i < CALLS; i++) {
+                setViewport(_immCommandBuffer, 0, 1, &viewport);
+            }
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+            VK_CHECK(vkd.vkEndCommandBuffer(_immCommandBuffer));
+            return elapsed.count() / CALLS;
+        };
+        //! Warm up both paths once so the first measurement does not pay for cold caches
+        measure(::vkCmdSetViewport);
+        measure(vkd.vkCmdSetViewport);
+        double loaderTime = measure(::vkCmdSetViewport);
+        double directTime = measure(vkd.vkCmdSetViewport);
+        VK_CHECK(vkd.vkResetCommandBuffer(_immCommandBuffer, 0));
+
+        _profiler.set_counter("Loader Dispatch (ns/call)", loaderTime);
+        _profiler.set_counter("Direct Dispatch (ns/call)", directTime);
+        fmt::println("[BlueVK]::[DISPATCH]: vkCmdSetViewport x{}: loader {:.2f} ns/call, direct {:.2f} ns/call ({:.2f} ns saved)",
+                     CALLS,
+                     loaderTime,
+                     directTime,
+                     loaderTime - directTime);
+    }
+    void BlueVKEngine::collect_cull_stats(FrameData &frame) {
+        if (_frameNumber < FRAME_OVERLAP) {
+            return;
+        }
+        GPUCullStats stats;
+        vmaInvalidateAllocation(_vmaAllocator, frame._cullStatsBuffer.allocation, 0, VK_WHOLE_SIZE);
+        memcpy(&stats, frame._cullStatsBuffer.info.pMappedData, sizeof(GPUCullStats));
+
+        _profiler.set_counter("Objects Drawn", stats.visibleCount);
+        _profiler.set_counter("Objects Frustum Culled", stats.frustumCulled);
+        _profiler.set_counter("Objects Occlusion Culled", stats.occlusionCulled);
+        _profiler.set_counter("Triangles Saved", stats.trianglesCulled);
+        _profiler.set_counter("Fragments Saved (est.)", stats.fragmentsSaved);
+    }
+    void BlueVKEngine::resize_swapchain() {
+        vkd.vkDeviceWaitIdle(_device);
+        vkd.vkQueueWaitIdle(_graphicsQueue);
+
+        destroy_swapchain();
+        destroy_draw_images();
+
+        create_swapchain(_windowExtent);
+        create_draw_images();
+        update_draw_image_descriptors();
+
+        _resizeRequested = false;
+    }
+    void BlueVKEngine::pace_frame() {
+        if (!_presentWait) {
+            return;
+        }
+        //! Input for the next frame is sampled once at most maxQueuedPresents frames wait for the display,
+        //! with 1 the previous frame is on screen before the next one starts
+        uint64_t waitId = _presentId - std::min<uint64_t>(_maxQueuedPresents - 1, _presentId);
+        if (waitId < _swapchainFirstPresentId) {
+            return;
+        }
+        //! A timeout only skips pacing for this frame, a hidden window may never present
+        VkResult result = vkd.vkWaitForPresentKHR(_device, _swapchain, waitId, 100000000);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            _resizeRequested = true;
+        } else if ((result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) && waitId > _lastMeasuredPresentId) {
+            std::chrono::duration<double, std::milli> inputToPresented =
+                std::chrono::high_resolution_clock::now() - _presentInputTimes[waitId % _presentInputTimes.size()];
+            _inputToPresented = inputToPresented.count();
+            _profiler.set_timing("Input to Presented", _inputToPresented);
+            _lastMeasuredPresentId = waitId;
+        }
+    }
+    void BlueVKEngine::start_render_thread() {
+        _frameState = FrameState{
+            .camera = _camera,
+            .renderScale = _renderScale,
+            .temporalUpscale = _temporalUpscale,
+            .compositePresent = _compositePresent,
+            .exposure = _exposure,
+            .tonemapper = _tonemapper,
+            .bloom = _bloom,
+            .bloomIntensity = _bloomIntensity,
+            .computeEffect = _currentComputeEffect,
+            .cacheBackground = _cacheBackground,
+            .depthPrepass = _depthPrepass,
+            .occlusionCulling = _occlusionCulling,
+            .meshLods = _meshLods,
+            .lodErrorPixels = _lodErrorPixels,
+            .particles = _particles,
+            .particleSorting = _particleSorting,
+            .particleEmitRate = _particleEmitRate,
+            .particleLifetime = _particleLifetime,
+            .animate = _animate,
+            .shadows = _shadows,
+            .cacheShadows = _cacheShadows,
+            .lightYaw = _lightYaw,
+            .lightPitch = _lightPitch,
+            .parallelRecording = _parallelRecording,
+            .cacheCommands = _cacheCommands,
+            .presentMode = _requestedPresentMode,
+            .swapchainImageCount = _swapchainImageCount,
+            .maxQueuedPresents = _maxQueuedPresents,
+        };
+        for (const ComputeEffect &effect : _computeEffects) {
+            _frameState.effectData.push_back(effect.data);
+        }
+        _windowExtent = _swapchainExtent;
+        publish_status();
+        _status = _publishedStatus;
+        if (!_renderThreadEnabled) {
+            return;
+        }
+        //! The render thread records with jobs, it becomes the job system's thread 0
+        JobSystem::set_main_thread(false);
+        _renderThread = std::thread{[this]() { render_loop(); }};
+    }
+    void BlueVKEngine::stop_render_thread() {
+        if (!_renderThread.joinable()) {
+            return;
+        }
+        FramePacket *packet = acquire_packet();
+        if (packet != nullptr) {
+            packet->exit = true;
+            publish_packet();
+        }
+        _renderThread.join();
+        JobSystem::set_main_thread(true);
+    }
+    BlueVKEngine::FramePacket *BlueVKEngine::acquire_packet() {
+        uint64_t written = _packetsWritten.load(std::memory_order_relaxed);
+        if (!_renderThread.joinable()) {
+            return _renderError ? nullptr : &_packets[written % 2];
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t read = _packetsRead.load(std::memory_order_acquire);
+        while (written - read >= 2) {
+            if (_renderThreadExited.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            _packetsRead.wait(read, std::memory_order_acquire);
+            read = _packetsRead.load(std::memory_order_acquire);
+        }
+        if (_renderThreadExited.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        std::chrono::duration<double, std::milli> waited = std::chrono::high_resolution_clock::now() - start;
+        _profiler.set_timing("Main Thread Packet Wait", waited.count());
+        return &_packets[written % 2];
+    }
+    void BlueVKEngine::publish_packet() {
+        uint64_t written = _packetsWritten.load(std::memory_order_relaxed);
+        if (!_renderThread.joinable()) {
+            //! Without a render thread the packet is drawn right away on the main thread
+            _packetsWritten.store(written + 1, std::memory_order_relaxed);
+            try {
+                render_frame(_packets[written % 2]);
+            } catch (...) {
+                _renderError = std::current_exception();
+            }
+            return;
+        }
+        _packetsWritten.store(written + 1, std::memory_order_release);
+        _packetsWritten.notify_one();
+    }
+    void BlueVKEngine::render_loop() {
+        JobSystem::set_main_thread(true);
+        try {
+            for (uint64_t read = 0;; read++) {
+                auto start = std::chrono::high_resolution_clock::now();
+                uint64_t written = _packetsWritten.load(std::memory_order_acquire);
+                while (written == read) {
+                    _packetsWritten.wait(written, std::memory_order_acquire);
+                    written = _packetsWritten.load(std::memory_order_acquire);
+                }
+                FramePacket &packet = _packets[read % 2];
+                if (packet.exit) {
+                    break;
+                }
+                std::chrono::duration<double, std::milli> waited = std::chrono::high_resolution_clock::now() - start;
+                _profiler.set_timing("Render Thread Packet Wait", waited.count());
+
+                render_frame(packet);
+
+                _packetsRead.store(read + 1, std::memory_order_release);
+                _packetsRead.notify_one();
+            }
+        } catch (...) {
+            _renderError = std::current_exception();
+        }
+        JobSystem::set_main_thread(false);
+        //! Wakes the main thread if it waits for a packet that is never released
+        _renderThreadExited.store(true, std::memory_order_release);
+        _packetsRead.fetch_add(1, std::memory_order_release);
+        _packetsRead.notify_one();
+    }
+    void BlueVKEngine::render_frame(FramePacket &packet) {
+        pace_frame();
+        apply_packet(packet);
+        if (_resizeRequested) {
+            resize_swapchain();
+        }
+
+        _imguiDrawData = packet.imgui.get();
+        draw();
+        _imguiDrawData = nullptr;
+        if (_frameNumber == 1) {
+            report_first_frame();
+        }
+        publish_status();
+    }
+    void BlueVKEngine::apply_packet(FramePacket &packet) {
+        const FrameState &state = packet.state;
+        _camera = state.camera;
+        _renderScale = state.renderScale;
+        if (state.temporalUpscale != _temporalUpscale) {
+            _historyValid = false;
+        }
+        _temporalUpscale = state.temporalUpscale;
+        _compositePresent = state.compositePresent;
+        _exposure = state.exposure;
+        _tonemapper = state.tonemapper;
+        _bloom = state.bloom;
+        _bloomIntensity = state.bloomIntensity;
+        _currentComputeEffect = state.computeEffect;
+        _cacheBackground = state.cacheBackground;
+        for (uint32_t i = 0; i < _computeEffects.size(); i++) {
+            _computeEffects[i].data = state.effectData[i];
+        }
+        _depthPrepass = state.depthPrepass;
+        _occlusionCulling = state.occlusionCulling;
+        _meshLods = state.meshLods;
+        _lodErrorPixels = state.lodErrorPixels;
+        _particles = state.particles && _maxParticles > 0;
+        _particleSorting = state.particleSorting;
+        _particleEmitRate = state.particleEmitRate;
+        _particleLifetime = state.particleLifetime;
+        _animate = state.animate;
+        _shadows = state.shadows;
+        _cacheShadows = state.cacheShadows;
+        _lightYaw = state.lightYaw;
+        _lightPitch = state.lightPitch;
+        _parallelRecording = state.parallelRecording;
+        _cacheCommands = state.cacheCommands;
+        if (state.presentMode != _requestedPresentMode || state.swapchainImageCount != _swapchainImageCount) {
+            _requestedPresentMode = state.presentMode;
+            _swapchainImageCount = state.swapchainImageCount;
+            _resizeRequested = true;
+        }
+        _maxQueuedPresents = state.maxQueuedPresents;
+        _windowExtent = packet.windowExtent;
+        _frameInputTime = packet.inputTime;
+        _frameDeltaTime = packet.deltaTime;
+
+        for (std::function<void()> &command : packet.commands) {
+            command();
+        }
+        packet.commands.clear();
+    }
+    void BlueVKEngine::publish_status() {
+        std::lock_guard<std::mutex> lock{_statusMutex};
+        _publishedStatus.presentMode = _presentMode;
+        _publishedStatus.supportedPresentModes = _supportedPresentModes;
+        _publishedStatus.swapchainImages = (uint32_t)_swapchainImages.size();
+        _publishedStatus.inputToPresentCall = _inputToPresentCall;
+        _publishedStatus.inputToPresented = _inputToPresented;
+        _publishedStatus.drawBatches = (uint32_t)_drawList.get_batches().size();
+        _publishedStatus.captureFramesLeft = _captureFramesLeft;
+        _publishedStatus.pickValid = _pickValid;
+        _publishedStatus.pickDepth = _pickDepth;
+        _publishedStatus.pickWorldPosition = _pickWorldPosition;
+        _publishedStatus.jobScaling = _jobScaling;
+    }
+    void BlueVKEngine::handle_event(const sf::Event &event) {
+        ImGui::SFML::ProcessEvent(event);
+
+        switch (event.type) {
+            case sf::Event::Closed:
+                _quitRequested = true;
+                break;
+            case sf::Event::KeyPressed:
+                switch (event.key.code) {
+                    case sf::Keyboard::Escape:
+                        _quitRequested = true;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            case sf::Event::MouseButtonPressed:
+                if (event.mouseButton.button == sf::Mouse::Right && !ImGui::GetIO().WantCaptureMouse) {
+                    sf::Vector2i position{event.mouseButton.x, event.mouseButton.y};
+                    _renderCommands.push_back([this, position]() {
+                        _pickRequested = true;
+                        _pickPosition = position;
+                    });
+                }
+                break;
+            case sf::Event::LostFocus:
+                _windowFocused = false;
+                break;
+            case sf::Event::GainedFocus:
+                _windowFocused = true;
+                break;
+            default:
+                break;
+        }
+    }
+    bool BlueVKEngine::is_idle() {
+        if (!_idleWhenUnfocused || _windowFocused) {
+            return false;
+        }
+        //! Work that only advances with frames keeps the window rendering until it is done
+        if (!_renderCommands.empty() || _status.captureFramesLeft > 0 || _readback.get_slots_in_flight() > 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock{_statusMutex};
+        return !_textureCache.has_pending_work();
+    }
+    void BlueVKEngine::wait_idle() {
+        sf::Event event;
+        if (_idleFrameRate <= 0.0f) {
+            //! Nothing on screen changes until the next event
+            if (_window.waitEvent(event)) {
+                handle_event(event);
+            }
+            return;
+        }
+        //! SFML 2 can't wait for events with a timeout, polling in short slices would wake the thread
+        //! hundreds of times a second. It sleeps until the idle frame is due, events queued meanwhile are
+        //! handled by that frame.
+        using Clock = std::chrono::high_resolution_clock;
+        Clock::time_point deadline =
+            _lastFrameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _idleFrameRate));
+        std::this_thread::sleep_until(deadline);
+    }
+    void BlueVKEngine::limit_frame_rate() {
+        using Clock = std::chrono::high_resolution_clock;
+        Clock::time_point now = Clock::now();
+        if (_frameRateLimit <= 0.0f) {
+            _nextFrameTime = now;
+            return;
+        }
+        Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _frameRateLimit));
+        if (now >= _nextFrameTime) {
+            //! A frame that ran long moves the schedule instead of letting the next ones catch up back to back
+            _nextFrameTime = now + period;
+            return;
+        }
+        //! Sleeps wake up late by up to a scheduler tick, the last stretch is spent yielding. Input is
+        //! sampled after the wait so the limiter doesn't add latency.
+        Clock::time_point target = _nextFrameTime;
+        std::chrono::milliseconds spin{FRAME_LIMIT_SPIN_MS};
+        if (target - now > spin) {
+            std::this_thread::sleep_until(target - spin);
+        }
+        while (Clock::now() < target) {
+            std::this_thread::yield();
+        }
+        std::chrono::duration<double, std::milli> waited = Clock::now() - now;
+        _profiler.set_timing("Frame Limit Wait", waited.count());
+        _nextFrameTime = target + period;
+    }
+    void BlueVKEngine::destroy_swapchain() {
+        vkd.vkDestroySwapchainKHR(_device, _swapchain, nullptr);
 
         for (uint32_t i = 0; i < _swapchainImageViews.size(); i++) {
-            vkDestroyImageView(_device, _swapchainImageViews[i], nullptr);
+            vkd.vkDestroyImageView(_device, _swapchainImageViews[i], nullptr);
         }
     }
     void BlueVKEngine::destroy_draw_images() {
-        vkDestroyImageView(_device, _drawImage.view, nullptr);
+        vkd.vkDestroyImageView(_device, _drawImage.view, nullptr);
         vmaDestroyImage(_vmaAllocator, _drawImage.image, _drawImage.allocation);
+
+        vkd.vkDestroyImageView(_device, _backgroundImage.view, nullptr);
+        vmaDestroyImage(_vmaAllocator, _backgroundImage.image, _backgroundImage.allocation);
+
+        for (BlueVKImage &historyImage : _historyImages) {
+            vkd.vkDestroyImageView(_device, historyImage.view, nullptr);
+            vmaDestroyImage(_vmaAllocator, historyImage.image, historyImage.allocation);
+        }
+
+        vkd.vkDestroyImageView(_device, _depthImage.view, nullptr);
+        vmaDestroyImage(_vmaAllocator, _depthImage.image, _depthImage.allocation);
+
+        for (VkImageView mipView : _depthPyramidMips) {
+            vkd.vkDestroyImageView(_device, mipView, nullptr);
+        }
+        _depthPyramidMips.clear();
+        vkd.vkDestroyImageView(_device, _depthPyramid.view, nullptr);
+        vmaDestroyImage(_vmaAllocator, _depthPyramid.image, _depthPyramid.allocation);
+
+        vkd.vkDestroyImageView(_device, _bloomImage.view, nullptr);
+        vmaDestroyImage(_vmaAllocator, _bloomImage.image, _bloomImage.allocation);
+    }
+    void BlueVKEngine::destroy_buffer(const BlueVKBuffer &buffer) {
+        vmaDestroyBuffer(_vmaAllocator, buffer.buffer, buffer.allocation);
+    }
+    VkCommandBuffer BlueVKEngine::begin_secondary_command_buffer(FrameData &frame, const VkCommandBufferInheritanceInfo &inheritance) {
+        ThreadCommandPool &threadPool = frame._threadCommandPools[JobSystem::get_thread_index()];
+        if (threadPool.usedSecondaryBuffers == threadPool.secondaryBuffers.size()) {
+            threadPool.secondaryBuffers.push_back(CommandBufferAllocator{}
+                                                      .set_command_pool(threadPool.pool)
+                                                      .set_level(VK_COMMAND_BUFFER_LEVEL_SECONDARY)
+                                                      .allocate(_device));
+        }
+        VkCommandBuffer cmd = threadPool.secondaryBuffers[threadPool.usedSecondaryBuffers++];
+
+        VkCommandBufferBeginInfo beginInfo = command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                                                                       VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+        beginInfo.pInheritanceInfo = &inheritance;
+        VK_CHECK(vkd.vkBeginCommandBuffer(cmd, &beginInfo));
+        return cmd;
     }
     void BlueVKEngine::immediate_submit(std::function<void(VkCommandBuffer cmd)> &&function) {
-        VK_CHECK(vkResetFences(_device, 1, &_immFence));
-        VK_CHECK(vkResetCommandBuffer(_immCommandBuffer, 0));
+        VK_CHECK(vkd.vkResetFences(_device, 1, &_immFence));
+        VK_CHECK(vkd.vkResetCommandBuffer(_immCommandBuffer, 0));
         VkCommandBuffer cmd = _immCommandBuffer;
         VkCommandBufferBeginInfo cmdBeginInfo = command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-        VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+        VK_CHECK(vkd.vkBeginCommandBuffer(cmd, &cmdBeginInfo));
 
         function(cmd);
 
-        VK_CHECK(vkEndCommandBuffer(cmd));
+        VK_CHECK(vkd.vkEndCommandBuffer(cmd));
         VkCommandBufferSubmitInfo cmdinfo = command_buffer_submit_info(cmd);
         VkSubmitInfo2 submit = submit_info(&cmdinfo, nullptr, nullptr);
-        VK_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submit, _immFence));
-        VK_CHECK(vkWaitForFences(_device, 1, &_immFence, true, 9999999999));
+        VK_CHECK(vkd.vkQueueSubmit2(_graphicsQueue, 1, &submit, _immFence));
+        VK_CHECK(vkd.vkWaitForFences(_device, 1, &_immFence, true, 9999999999));
     }
 
     void BlueVKEngine::DeletionQueue::push_back(std::function<void()> &&function) {
+        std::lock_guard<std::mutex> lock{mutex};
         deletors.push_back(function);
     }
     void BlueVKEngine::DeletionQueue::flush() {
@@ -0,0 +1,48 @@
+#include <imgui_snapshot.hpp>
+
+#include <cstring>
+
+namespace bluevk {
+    //! ImVector's assignment frees and reallocates, resize keeps the capacity
+    template <typename T>
+    static void copy_vector(ImVector<T> &destination, const ImVector<T> &source) {
+        destination.resize(source.Size);
+        if (source.Size > 0) {
+            memcpy(destination.Data, source.Data, (size_t)source.Size * sizeof(T));
+        }
+    }
+
+    ImGuiSnapshot::~ImGuiSnapshot() {
+        for (ImDrawList *list : _lists) {
+            IM_DELETE(list);
+        }
+    }
+    void ImGuiSnapshot::capture(const ImDrawData *source) {
+        _drawData.CmdLists.resize(0);
+        if (source == nullptr || !source->Valid) {
+            _drawData.Valid = false;
+            _drawData.CmdListsCount = 0;
+            return;
+        }
+        while (_lists.size() < (size_t)source->CmdListsCount) {
+            _lists.push_back(IM_NEW(ImDrawList)(source->CmdLists[(int)_lists.size()]->_Data));
+        }
+        for (int i = 0; i < source->CmdListsCount; i++) {
+            const ImDrawList *sourceList = source->CmdLists[i];
+            ImDrawList *list = _lists[i];
+            copy_vector(list->CmdBuffer, sourceList->CmdBuffer);
+            copy_vector(list->IdxBuffer, sourceList->IdxBuffer);
+            copy_vector(list->VtxBuffer, sourceList->VtxBuffer);
+            list->Flags = sourceList->Flags;
+            _drawData.CmdLists.push_back(list);
+        }
+        _drawData.Valid = true;
+        _drawData.CmdListsCount = source->CmdListsCount;
+        _drawData.TotalIdxCount = source->TotalIdxCount;
+        _drawData.TotalVtxCount = source->TotalVtxCount;
+        _drawData.DisplayPos = source->DisplayPos;
+        _drawData.DisplaySize = source->DisplaySize;
+        _drawData.FramebufferScale = source->FramebufferScale;
+        _drawData.OwnerViewport = source->OwnerViewport;
+    }
+}  // namespace bluevk
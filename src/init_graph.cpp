@@ -0,0 +1,105 @@
+#include <init_graph.hpp>
+
+#include <atomic>
+#include <stdexcept>
+
+namespace bluevk {
+    InitGraph::StepId InitGraph::add(const char *name, std::function<void()> &&function, std::vector<StepId> dependencies) {
+        for (StepId dependency : dependencies) {
+            if (dependency >= _steps.size()) {
+                throw std::runtime_error(fmt::format("[BlueVK]::[ERROR]: Init step '{}' depends on a step added after it!", name));
+            }
+        }
+        _steps.push_back(Step{
+            .name = name,
+            .function = std::move(function),
+            .dependencies = std::move(dependencies),
+            .mainThread = false,
+        });
+        return (StepId)_steps.size() - 1;
+    }
+    InitGraph::StepId InitGraph::add_main_thread(const char *name, std::function<void()> &&function, std::vector<StepId> dependencies) {
+        StepId id = add(name, std::move(function), std::move(dependencies));
+        _steps[id].mainThread = true;
+        return id;
+    }
+    void InitGraph::run(JobSystem &jobs) {
+        using Clock = std::chrono::high_resolution_clock;
+        Clock::time_point origin = Clock::now();
+
+        //! ready[i] reaches zero once every dependency of step i is done, done[i] once step i is
+        std::vector<JobCounter> ready(_steps.size());
+        std::vector<JobCounter> done(_steps.size());
+        std::atomic<bool> failed{false};
+        std::mutex errorMutex;
+        std::exception_ptr error{};
+
+        auto execute = [&](StepId id) {
+            Step &step = _steps[id];
+            if (failed.load(std::memory_order_acquire)) {
+                return;
+            }
+            step.threadIndex = JobSystem::get_thread_index();
+            step.start = std::chrono::duration<double, std::milli>(Clock::now() - origin).count();
+            try {
+                step.function();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{errorMutex};
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true, std::memory_order_release);
+            }
+            step.end = std::chrono::duration<double, std::milli>(Clock::now() - origin).count();
+        };
+
+        for (StepId id = 0; id < _steps.size(); id++) {
+            //! An empty job per dependency turns several counters into the single one schedule() waits on
+            for (StepId dependency : _steps[id].dependencies) {
+                jobs.schedule([]() {}, &ready[id], &done[dependency]);
+            }
+            if (_steps[id].mainThread) {
+                jobs.hold(done[id]);
+            } else {
+                jobs.schedule([&execute, id]() { execute(id); }, &done[id], &ready[id]);
+            }
+        }
+        //! Main thread steps are run in order, the thread keeps running jobs while it waits for their dependencies
+        for (StepId id = 0; id < _steps.size(); id++) {
+            if (_steps[id].mainThread) {
+                jobs.wait(ready[id]);
+                execute(id);
+                jobs.release(done[id]);
+            }
+        }
+        for (StepId id = 0; id < _steps.size(); id++) {
+            jobs.wait(done[id]);
+        }
+        _duration = std::chrono::duration<double, std::milli>(Clock::now() - origin).count();
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    double InitGraph::get_serial_duration() const {
+        double total = 0.0;
+        for (const Step &step : _steps) {
+            total += step.end - step.start;
+        }
+        return total;
+    }
+    void InitGraph::print_timeline() const {
+        fmt::println("[BlueVK]::[STARTUP]: Init timeline ({} steps):", _steps.size());
+        for (const Step &step : _steps) {
+            fmt::println("    {:<32} {:>9.2f} -> {:>9.2f} ms  ({:>8.2f} ms, thread {})",
+                         step.name,
+                         step.start,
+                         step.end,
+                         step.end - step.start,
+                         step.threadIndex);
+        }
+        fmt::println("[BlueVK]::[STARTUP]: Init took {:.2f} ms, {:.2f} ms if run in sequence",
+                     _duration,
+                     get_serial_duration());
+    }
+}  // namespace bluevk
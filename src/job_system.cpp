@@ -0,0 +1,211 @@
+#include <job_system.hpp>
+
+#include <algorithm>
+
+namespace bluevk {
+    static thread_local uint32_t ThreadIndex = UINT32_MAX;
+
+    void JobSystem::init(uint32_t workerCount) {
+        _stopping = false;
+        ThreadIndex = 0;
+        _queues.resize(workerCount + 1);
+        for (std::unique_ptr<WorkQueue> &queue : _queues) {
+            queue = std::make_unique<WorkQueue>();
+        }
+        _activeThreadCount = workerCount + 1;
+        for (uint32_t i = 1; i <= workerCount; i++) {
+            _workers.emplace_back([this, i]() { worker_loop(i); });
+        }
+    }
+    void JobSystem::shutdown() {
+        {
+            std::lock_guard<std::mutex> lock{_sleepMutex};
+            _stopping = true;
+        }
+        _sleepCondition.notify_all();
+        for (std::thread &worker : _workers) {
+            worker.join();
+        }
+        _workers.clear();
+        _queues.clear();
+        _backgroundQueue.jobs.clear();
+    }
+    void JobSystem::schedule(std::function<void()> &&job, JobCounter *counter, JobCounter *dependency) {
+        if (counter != nullptr) {
+            counter->_value.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (dependency != nullptr) {
+            std::lock_guard<std::mutex> lock{dependency->_mutex};
+            if (!dependency->is_done()) {
+                dependency->_waiting.push_back(JobCounter::DeferredJob{std::move(job), counter, false});
+                return;
+            }
+        }
+        push(Job{std::move(job), counter}, false);
+    }
+    void JobSystem::schedule_background(std::function<void()> &&job, JobCounter *counter) {
+        if (counter != nullptr) {
+            counter->_value.fetch_add(1, std::memory_order_relaxed);
+        }
+        push(Job{std::move(job), counter}, true);
+    }
+    void JobSystem::parallel_for(uint32_t count,
+                                 uint32_t grainSize,
+                                 const std::function<void(uint32_t begin, uint32_t end)> &body,
+                                 JobCounter *counter) {
+        grainSize = std::max(grainSize, 1u);
+        auto sharedBody = std::make_shared<std::function<void(uint32_t, uint32_t)>>(body);
+        for (uint32_t begin = 0; begin < count; begin += grainSize) {
+            uint32_t end = std::min(begin + grainSize, count);
+            schedule([sharedBody, begin, end]() { (*sharedBody)(begin, end); }, counter);
+        }
+    }
+    void JobSystem::wait(JobCounter &counter) {
+        uint32_t threadIndex = get_thread_index();
+        //! Without workers nobody else would ever run the background jobs
+        bool allowBackground = _workers.empty();
+        while (!counter.is_done()) {
+            Job job;
+            if (threadIndex != UINT32_MAX && try_pop(threadIndex, allowBackground, job)) {
+                execute(job);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        //! The last finish() still holds the lock after zeroing the counter, the caller may destroy it once we return
+        std::lock_guard<std::mutex> lock{counter._mutex};
+    }
+    void JobSystem::hold(JobCounter &counter) {
+        counter._value.fetch_add(1, std::memory_order_relaxed);
+    }
+    void JobSystem::release(JobCounter &counter) {
+        finish(&counter);
+    }
+    void JobSystem::set_active_thread_count(uint32_t count) {
+        _activeThreadCount = std::clamp(count, 1u, get_thread_count());
+        _sleepCondition.notify_all();
+    }
+    uint32_t JobSystem::get_thread_index() {
+        return ThreadIndex;
+    }
+    void JobSystem::set_main_thread(bool isMain) {
+        ThreadIndex = isMain ? 0 : UINT32_MAX;
+    }
+    void JobSystem::push(Job &&job, bool background) {
+        WorkQueue *queue = &_backgroundQueue;
+        if (!background) {
+            uint32_t threadIndex = get_thread_index();
+            if (threadIndex == UINT32_MAX) {
+                threadIndex = _nextQueue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+            }
+            queue = _queues[threadIndex].get();
+        }
+        {
+            std::lock_guard<std::mutex> lock{queue->mutex};
+            queue->jobs.push_back(std::move(job));
+        }
+        {
+            //! Taken so a worker can't miss the wake up between checking for jobs and going to sleep
+            std::lock_guard<std::mutex> lock{_sleepMutex};
+            _queuedJobs.fetch_add(1, std::memory_order_release);
+            if (background) {
+                _queuedBackgroundJobs.fetch_add(1, std::memory_order_release);
+            }
+        }
+        //! A parked worker would swallow a single wake up for a job it isn't allowed to take
+        if (!background && _activeThreadCount.load(std::memory_order_relaxed) < get_thread_count()) {
+            _sleepCondition.notify_all();
+        } else {
+            _sleepCondition.notify_one();
+        }
+    }
+    bool JobSystem::try_pop(uint32_t threadIndex, bool allowBackground, Job &job) {
+        if (_queuedJobs.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+
+        //! Own queue first, newest job first since its data is most likely still in cache
+        {
+            WorkQueue &queue = *_queues[threadIndex];
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            if (!queue.jobs.empty()) {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+                _queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        //! Steal the oldest job of another thread
+        uint32_t queueCount = (uint32_t)_queues.size();
+        for (uint32_t offset = 1; offset < queueCount; offset++) {
+            WorkQueue &queue = *_queues[(threadIndex + offset) % queueCount];
+            std::unique_lock<std::mutex> lock{queue.mutex, std::try_to_lock};
+            if (lock.owns_lock() && !queue.jobs.empty()) {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+                _queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return allowBackground && try_pop_background(job);
+    }
+    bool JobSystem::try_pop_background(Job &job) {
+        if (_queuedBackgroundJobs.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock{_backgroundQueue.mutex};
+        if (_backgroundQueue.jobs.empty()) {
+            return false;
+        }
+        job = std::move(_backgroundQueue.jobs.front());
+        _backgroundQueue.jobs.pop_front();
+        _queuedBackgroundJobs.fetch_sub(1, std::memory_order_relaxed);
+        _queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    void JobSystem::execute(Job &job) {
+        job.function();
+        finish(job.counter);
+    }
+    void JobSystem::finish(JobCounter *counter) {
+        if (counter == nullptr) {
+            return;
+        }
+        std::vector<JobCounter::DeferredJob> ready{};
+        {
+            std::lock_guard<std::mutex> lock{counter->_mutex};
+            if (counter->_value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                ready.swap(counter->_waiting);
+            }
+        }
+        //! The counter may be destroyed by a waiting thread from here on, only the moved out jobs are touched
+        for (JobCounter::DeferredJob &deferred : ready) {
+            push(Job{std::move(deferred.function), deferred.counter}, deferred.background);
+        }
+    }
+    void JobSystem::worker_loop(uint32_t threadIndex) {
+        ThreadIndex = threadIndex;
+        while (true) {
+            Job job;
+            //! Parked workers only drain the background queue, waiters never run it while there are workers
+            bool active = threadIndex < _activeThreadCount.load(std::memory_order_relaxed);
+            if (active ? try_pop(threadIndex, true, job) : try_pop_background(job)) {
+                execute(job);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock{_sleepMutex};
+            _sleepCondition.wait(lock, [this, threadIndex]() {
+                return _stopping ||
+                       _queuedBackgroundJobs.load(std::memory_order_acquire) > 0 ||
+                       (_queuedJobs.load(std::memory_order_acquire) > 0 &&
+                        threadIndex < _activeThreadCount.load(std::memory_order_relaxed));
+            });
+            if (_stopping) {
+                return;
+            }
+        }
+    }
+}  // namespace bluevk
@@ -0,0 +1,189 @@
+#include <ktx2.hpp>
+
+#include <cmath>
+#include <cstring>
+
+#include <texture_codec.hpp>
+
+namespace bluevk {
+    static constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    struct Ktx2Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Ktx2Header) == 80);
+
+    struct Ktx2LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    //! Khronos Data Format basic descriptor values
+    static constexpr uint32_t KHR_DF_MODEL_RGBSDA = 1;
+    static constexpr uint32_t KHR_DF_MODEL_BC5 = 131;
+    static constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+    static constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+    static constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+    static constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+
+    static std::vector<uint32_t> build_dfd(VkFormat format) {
+        struct Sample {
+            uint32_t bitOffset;
+            uint32_t bitLength;
+            uint32_t channelType;
+        };
+        std::vector<Sample> samples{};
+        uint32_t colorModel;
+        uint32_t blockDimensions;
+        uint32_t bytesPlane0;
+        switch (format) {
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                colorModel = KHR_DF_MODEL_BC7;
+                blockDimensions = 0x00000303;
+                bytesPlane0 = BC_BLOCK_SIZE;
+                samples.push_back(Sample{0, 128, 0});
+                break;
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+                colorModel = KHR_DF_MODEL_BC5;
+                blockDimensions = 0x00000303;
+                bytesPlane0 = BC_BLOCK_SIZE;
+                samples.push_back(Sample{0, 64, 0});
+                samples.push_back(Sample{64, 64, 1});
+                break;
+            default:
+                colorModel = KHR_DF_MODEL_RGBSDA;
+                blockDimensions = 0;
+                bytesPlane0 = 4;
+                for (uint32_t c = 0; c < 3; c++) {
+                    samples.push_back(Sample{c * 8, 8, c});
+                }
+                samples.push_back(Sample{24, 8, 15});
+                break;
+        }
+        uint32_t transfer = (format == VK_FORMAT_BC7_SRGB_BLOCK || format == VK_FORMAT_R8G8B8A8_SRGB)
+                                ? KHR_DF_TRANSFER_SRGB
+                                : KHR_DF_TRANSFER_LINEAR;
+        uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+
+        std::vector<uint32_t> dfd{};
+        dfd.push_back(4 + blockSize);
+        dfd.push_back(0);
+        dfd.push_back(2 | (blockSize << 16));
+        dfd.push_back(colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+        dfd.push_back(blockDimensions);
+        dfd.push_back(bytesPlane0);
+        dfd.push_back(0);
+        for (const Sample &sample : samples) {
+            dfd.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channelType << 24));
+            dfd.push_back(0);
+            dfd.push_back(0);
+            dfd.push_back(colorModel == KHR_DF_MODEL_RGBSDA ? 255 : UINT32_MAX);
+        }
+        return dfd;
+    }
+
+    bool is_ktx2(const std::vector<uint8_t> &bytes) {
+        return bytes.size() >= sizeof(Ktx2Header) && memcmp(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+    }
+    std::optional<Ktx2Image> read_ktx2(const std::vector<uint8_t> &bytes) {
+        if (!is_ktx2(bytes)) {
+            return std::nullopt;
+        }
+        Ktx2Header header;
+        memcpy(&header, bytes.data(), sizeof(Ktx2Header));
+        if (header.supercompressionScheme != 0 ||
+            header.pixelDepth > 1 ||
+            header.layerCount > 1 ||
+            header.faceCount != 1 ||
+            header.pixelWidth == 0 ||
+            header.pixelHeight == 0) {
+            return std::nullopt;
+        }
+
+        Ktx2Image image{
+            .format = (VkFormat)header.vkFormat,
+            .extent = VkExtent2D{header.pixelWidth, header.pixelHeight},
+        };
+        uint32_t levelCount = std::max(header.levelCount, 1u);
+        //! More levels than the full chain would fail image creation
+        uint32_t maxLevelCount = (uint32_t)std::floor(std::log2(std::max(header.pixelWidth, header.pixelHeight))) + 1;
+        if (levelCount > maxLevelCount) {
+            return std::nullopt;
+        }
+        if (sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex) > bytes.size()) {
+            return std::nullopt;
+        }
+        image.levels.resize(levelCount);
+        for (uint32_t level = 0; level < levelCount; level++) {
+            Ktx2LevelIndex index;
+            memcpy(&index, bytes.data() + sizeof(Ktx2Header) + level * sizeof(Ktx2LevelIndex), sizeof(Ktx2LevelIndex));
+            //! Written so a crafted offset and length can't wrap around past the end of the file
+            if (index.byteOffset > bytes.size() || index.byteLength > bytes.size() - index.byteOffset) {
+                return std::nullopt;
+            }
+            image.levels[level].assign(bytes.begin() + index.byteOffset, bytes.begin() + index.byteOffset + index.byteLength);
+        }
+        return image;
+    }
+    std::vector<uint8_t> write_ktx2(const Ktx2Image &image) {
+        std::vector<uint32_t> dfd = build_dfd(image.format);
+        uint32_t levelCount = (uint32_t)image.levels.size();
+
+        Ktx2Header header{
+            .identifier = {},
+            .vkFormat = (uint32_t)image.format,
+            .typeSize = 1,
+            .pixelWidth = image.extent.width,
+            .pixelHeight = image.extent.height,
+            .pixelDepth = 0,
+            .layerCount = 0,
+            .faceCount = 1,
+            .levelCount = levelCount,
+            .supercompressionScheme = 0,
+            .dfdByteOffset = (uint32_t)(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex)),
+            .dfdByteLength = (uint32_t)(dfd.size() * sizeof(uint32_t)),
+            .kvdByteOffset = 0,
+            .kvdByteLength = 0,
+            .sgdByteOffset = 0,
+            .sgdByteLength = 0,
+        };
+        memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+
+        std::vector<uint8_t> bytes(header.dfdByteOffset + header.dfdByteLength);
+        memcpy(bytes.data() + header.dfdByteOffset, dfd.data(), header.dfdByteLength);
+
+        //! Level data is stored smallest level first, each level aligned to the block size
+        std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+        for (int32_t level = (int32_t)levelCount - 1; level >= 0; level--) {
+            size_t alignedSize = (bytes.size() + BC_BLOCK_SIZE - 1) / BC_BLOCK_SIZE * BC_BLOCK_SIZE;
+            bytes.resize(alignedSize);
+            levelIndex[level] = Ktx2LevelIndex{
+                .byteOffset = alignedSize,
+                .byteLength = image.levels[level].size(),
+                .uncompressedByteLength = image.levels[level].size(),
+            };
+            bytes.insert(bytes.end(), image.levels[level].begin(), image.levels[level].end());
+        }
+
+        memcpy(bytes.data(), &header, sizeof(Ktx2Header));
+        memcpy(bytes.data() + sizeof(Ktx2Header), levelIndex.data(), levelCount * sizeof(Ktx2LevelIndex));
+        return bytes;
+    }
+}  // namespace bluevk
@@ -1,9 +1,51 @@
 #include <iostream>
+#include <cstring>
+#include <string>
 
 #include <engine.hpp>
 
-int main() {
-    bluevk::BlueVKEngine::Initialize(bluevk::BlueVKEngineParams{});
+int main(int argc, char **argv) {
+    bluevk::BlueVKEngineParams params{};
+    //! Lets the same build be benchmarked with different validation and presentation settings
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-validation") == 0) {
+            params.validationLevel = bluevk::VALIDATION_NONE;
+        } else if (strcmp(argv[i], "--sync-validation") == 0) {
+            params.validationLevel = bluevk::VALIDATION_SYNCHRONIZATION;
+        } else if (strcmp(argv[i], "--no-debug-labels") == 0) {
+            params.debugLabels = false;
+        } else if (strcmp(argv[i], "--present-mode=fifo") == 0) {
+            params.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        } else if (strcmp(argv[i], "--present-mode=fifo-relaxed") == 0) {
+            params.presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        } else if (strcmp(argv[i], "--present-mode=mailbox") == 0) {
+            params.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        } else if (strcmp(argv[i], "--present-mode=immediate") == 0) {
+            params.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        } else if (strncmp(argv[i], "--swapchain-images=", 19) == 0) {
+            params.swapchainImageCount = (uint32_t)std::stoul(argv[i] + 19);
+        } else if (strncmp(argv[i], "--max-queued-presents=", 22) == 0) {
+            params.maxQueuedPresents = (uint32_t)std::stoul(argv[i] + 22);
+        } else if (strncmp(argv[i], "--frames=", 9) == 0) {
+            //! Runs a fixed number of frames and exits, for automated runs (e.g. Xvfb + lavapipe)
+            params.maxFrames = (uint32_t)std::stoul(argv[i] + 9);
+        } else if (strncmp(argv[i], "--fps-limit=", 12) == 0) {
+            params.frameRateLimit = std::stof(argv[i] + 12);
+        } else if (strncmp(argv[i], "--idle-fps=", 11) == 0) {
+            params.idleFrameRate = std::stof(argv[i] + 11);
+        } else if (strcmp(argv[i], "--no-idle") == 0) {
+            params.idleWhenUnfocused = false;
+        } else if (strcmp(argv[i], "--no-render-thread") == 0) {
+            params.renderThread = false;
+        } else if (strncmp(argv[i], "--particles=", 12) == 0) {
+            params.maxParticles = (uint32_t)std::stoul(argv[i] + 12);
+        } else if (strncmp(argv[i], "--animated=", 11) == 0) {
+            params.animatedInstances = (uint32_t)std::stoul(argv[i] + 11);
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << "\n";
+        }
+    }
+    bluevk::BlueVKEngine::Initialize(params);
 
     bluevk::BlueVKEngine &engine = bluevk::BlueVKEngine::getInstance();
 
@@ -11,4 +53,4 @@ int main() {
 
     bluevk::BlueVKEngine::Shutdown();
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
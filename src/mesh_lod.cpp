@@ -0,0 +1,289 @@
+#include <mesh_lod.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+namespace bluevk {
+    //! A LOD has to drop at least this share of the triangles, otherwise the chain ends
+    constexpr float MIN_LOD_REDUCTION = 0.2f;
+    constexpr uint32_t MIN_LOD_TRIANGLES = 8;
+
+    //! Symmetric 4x4 matrix, v^T Q v is the area weighted sum of squared distances from v to the planes added to it
+    struct Quadric {
+        double a2{0.0}, ab{0.0}, ac{0.0}, ad{0.0};
+        double b2{0.0}, bc{0.0}, bd{0.0};
+        double c2{0.0}, cd{0.0};
+        double d2{0.0};
+        double weight{0.0};
+
+        void add_plane(glm::dvec4 p, double area) {
+            a2 += area * p.x * p.x, ab += area * p.x * p.y, ac += area * p.x * p.z, ad += area * p.x * p.w;
+            b2 += area * p.y * p.y, bc += area * p.y * p.z, bd += area * p.y * p.w;
+            c2 += area * p.z * p.z, cd += area * p.z * p.w;
+            d2 += area * p.w * p.w;
+            weight += area;
+        }
+        Quadric &operator+=(const Quadric &other) {
+            a2 += other.a2, ab += other.ab, ac += other.ac, ad += other.ad;
+            b2 += other.b2, bc += other.bc, bd += other.bd;
+            c2 += other.c2, cd += other.cd;
+            d2 += other.d2;
+            weight += other.weight;
+            return *this;
+        }
+        double evaluate(glm::dvec3 v) const {
+            double error = a2 * v.x * v.x + 2.0 * ab * v.x * v.y + 2.0 * ac * v.x * v.z + 2.0 * ad * v.x +
+                           b2 * v.y * v.y + 2.0 * bc * v.y * v.z + 2.0 * bd * v.y +
+                           c2 * v.z * v.z + 2.0 * cd * v.z +
+                           d2;
+            return std::max(error, 0.0);
+        }
+    };
+
+    struct PositionKey {
+        uint32_t bits[3];
+        bool operator==(const PositionKey &other) const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+    };
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey &key) const {
+            return ((size_t)key.bits[0] * 73856093u) ^ ((size_t)key.bits[1] * 19349663u) ^ ((size_t)key.bits[2] * 83492791u);
+        }
+    };
+
+    //! Collapses the edge from -> to, from is a position that only one vertex uses
+    struct Collapse {
+        double cost;
+        double distance;  // root mean square distance to the merged planes
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator>(const Collapse &other) const { return cost > other.cost; }
+    };
+
+    static std::vector<uint32_t> simplify(const std::vector<Vertex> &vertices,
+                                          const std::vector<uint32_t> &indices,
+                                          size_t targetTriangles,
+                                          float &error) {
+        size_t vertexCount = vertices.size();
+        size_t triangleCount = indices.size() / 3;
+
+        //! Vertices sharing a position (UV seams, hard edges) are welded for the topology, remap points at the first one
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<uint32_t> wedgeCount(vertexCount, 0);
+        std::unordered_map<PositionKey, uint32_t, PositionKeyHash> positions{};
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            PositionKey key{};
+            memcpy(key.bits, &vertices[v].position, sizeof(key.bits));
+            remap[v] = positions.try_emplace(key, v).first->second;
+            wedgeCount[remap[v]]++;
+        }
+
+        //! Collapsing a seam would have to move every wedge the same way, and a border edge would open a hole
+        std::vector<bool> locked(vertexCount, false);
+        std::unordered_map<uint64_t, uint32_t> edgeUses{};
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t a = remap[indices[t * 3 + k]];
+                uint32_t b = remap[indices[t * 3 + (k + 1) % 3]];
+                edgeUses[((uint64_t)std::min(a, b) << 32) | std::max(a, b)]++;
+            }
+        }
+        for (const auto &[edge, uses] : edgeUses) {
+            if (uses != 2) {
+                locked[edge >> 32] = true;
+                locked[edge & 0xFFFFFFFF] = true;
+            }
+        }
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            locked[v] = locked[v] || wedgeCount[v] > 1;
+        }
+
+        std::vector<uint32_t> triangles = indices;
+        std::vector<bool> removed(triangleCount, false);
+        std::vector<Quadric> quadrics(vertexCount);
+        std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            glm::dvec3 p0 = vertices[triangles[t * 3 + 0]].position;
+            glm::dvec3 p1 = vertices[triangles[t * 3 + 1]].position;
+            glm::dvec3 p2 = vertices[triangles[t * 3 + 2]].position;
+            glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+            double length = glm::length(normal);
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t v = remap[triangles[t * 3 + k]];
+                if (length > 0.0) {
+                    glm::dvec3 n = normal / length;
+                    quadrics[v].add_plane(glm::dvec4{n, -glm::dot(n, p0)}, length * 0.5);
+                }
+                vertexTriangles[v].push_back(t);
+            }
+        }
+
+        //! Stale entries are skipped when popped, a vertex's version changes whenever its quadric or fan does
+        std::vector<uint32_t> version(vertexCount, 0);
+        std::vector<bool> collapsed(vertexCount, false);
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue{};
+        auto push_collapse = [&](uint32_t from, uint32_t to) {
+            if (locked[from] || from == to) {
+                return;
+            }
+            Quadric quadric = quadrics[from];
+            quadric += quadrics[to];
+            double cost = quadric.evaluate(vertices[to].position);
+            queue.push(Collapse{
+                .cost = cost,
+                .distance = quadric.weight > 0.0 ? std::sqrt(cost / quadric.weight) : 0.0,
+                .from = from,
+                .to = to,
+                .fromVersion = version[from],
+                .toVersion = version[to],
+            });
+        };
+        auto push_edges = [&](uint32_t v) {
+            for (uint32_t t : vertexTriangles[v]) {
+                if (removed[t]) {
+                    continue;
+                }
+                for (uint32_t k = 0; k < 3; k++) {
+                    uint32_t other = remap[triangles[t * 3 + k]];
+                    push_collapse(v, other);
+                    push_collapse(other, v);
+                }
+            }
+        };
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t a = remap[triangles[t * 3 + k]];
+                uint32_t b = remap[triangles[t * 3 + (k + 1) % 3]];
+                push_collapse(a, b);
+                push_collapse(b, a);
+            }
+        }
+
+        size_t liveTriangles = triangleCount;
+        double maxDistance = 0.0;
+        while (liveTriangles > targetTriangles && !queue.empty()) {
+            Collapse collapse = queue.top();
+            queue.pop();
+            if (collapsed[collapse.from] || collapsed[collapse.to] ||
+                version[collapse.from] != collapse.fromVersion || version[collapse.to] != collapse.toVersion) {
+                continue;
+            }
+
+            //! The triangles on the edge tell which of to's wedges from's fan continues into
+            glm::vec3 target = vertices[collapse.to].position;
+            uint32_t toVertex = UINT32_MAX;
+            bool flips = false;
+            for (uint32_t t : vertexTriangles[collapse.from]) {
+                if (removed[t]) {
+                    continue;
+                }
+                const uint32_t *corners = &triangles[t * 3];
+                bool onEdge = false;
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                for (uint32_t k = 0; k < 3; k++) {
+                    onEdge = onEdge || remap[corners[k]] == collapse.to;
+                    toVertex = remap[corners[k]] == collapse.to ? corners[k] : toVertex;
+                    before[k] = vertices[corners[k]].position;
+                    after[k] = remap[corners[k]] == collapse.from ? target : before[k];
+                }
+                if (onEdge) {
+                    continue;
+                }
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(normalBefore, normalAfter) <= 0.0f) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (toVertex == UINT32_MAX || flips) {
+                continue;
+            }
+            //! Link condition: the ends of an interior edge share exactly the two vertices opposite of it,
+            //! more would pinch the surface into a non-manifold shape
+            std::vector<uint32_t> fromNeighbours{};
+            for (uint32_t t : vertexTriangles[collapse.from]) {
+                for (uint32_t k = 0; k < 3 && !removed[t]; k++) {
+                    fromNeighbours.push_back(remap[triangles[t * 3 + k]]);
+                }
+            }
+            std::vector<uint32_t> shared{};
+            for (uint32_t t : vertexTriangles[collapse.to]) {
+                for (uint32_t k = 0; k < 3 && !removed[t]; k++) {
+                    uint32_t v = remap[triangles[t * 3 + k]];
+                    if (v != collapse.from && v != collapse.to &&
+                        std::find(fromNeighbours.begin(), fromNeighbours.end(), v) != fromNeighbours.end() &&
+                        std::find(shared.begin(), shared.end(), v) == shared.end()) {
+                        shared.push_back(v);
+                    }
+                }
+            }
+            if (shared.size() != 2) {
+                continue;
+            }
+
+            for (uint32_t t : vertexTriangles[collapse.from]) {
+                if (removed[t]) {
+                    continue;
+                }
+                uint32_t *corners = &triangles[t * 3];
+                if (remap[corners[0]] == collapse.to || remap[corners[1]] == collapse.to || remap[corners[2]] == collapse.to) {
+                    removed[t] = true;
+                    liveTriangles--;
+                    continue;
+                }
+                for (uint32_t k = 0; k < 3; k++) {
+                    corners[k] = remap[corners[k]] == collapse.from ? toVertex : corners[k];
+                }
+                vertexTriangles[collapse.to].push_back(t);
+            }
+            quadrics[collapse.to] += quadrics[collapse.from];
+            collapsed[collapse.from] = true;
+            version[collapse.to]++;
+            maxDistance = std::max(maxDistance, collapse.distance);
+            push_edges(collapse.to);
+        }
+
+        std::vector<uint32_t> result{};
+        result.reserve(liveTriangles * 3);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            if (!removed[t]) {
+                result.insert(result.end(), {triangles[t * 3], triangles[t * 3 + 1], triangles[t * 3 + 2]});
+            }
+        }
+        error = (float)maxDistance;
+        return result;
+    }
+
+    std::vector<MeshLod> generate_lod_chain(const MeshData &mesh, uint32_t maxLodCount) {
+        std::vector<MeshLod> lods{};
+        lods.push_back(MeshLod{.indices = mesh.indices, .error = 0.0f});
+        while (lods.size() < maxLodCount) {
+            size_t previousTriangles = lods.back().indices.size() / 3;
+            float previousError = lods.back().error;
+            if (previousTriangles <= MIN_LOD_TRIANGLES) {
+                break;
+            }
+            float error;
+            std::vector<uint32_t> indices = simplify(mesh.vertices, lods.back().indices, previousTriangles / 2, error);
+            if (indices.size() / 3 > previousTriangles * (1.0f - MIN_LOD_REDUCTION)) {
+                break;
+            }
+            //! Errors are measured against the previous LOD, summing them keeps the chain's errors growing
+            lods.push_back(MeshLod{.indices = std::move(indices), .error = previousError + error});
+        }
+        return lods;
+    }
+    uint32_t select_lod(const MeshInfo *lods, uint32_t lodCount, float maxError) {
+        uint32_t lod = 0;
+        while (lod + 1 < lodCount && lods[lod + 1].lodError <= maxError) {
+            lod++;
+        }
+        return lod;
+    }
+}  // namespace bluevk
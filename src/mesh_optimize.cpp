@@ -0,0 +1,173 @@
+#include <mesh_optimize.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace bluevk {
+    //! Forsyth's tuning: the last triangle's vertices score flat so its neighbours don't all win at once,
+    //! vertices with few triangles left are preferred so they leave the cache for good
+    constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+    constexpr float FORSYTH_CACHE_DECAY = 1.5f;
+    constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+    static float get_vertex_score(int32_t cachePosition, uint32_t remainingTriangles) {
+        if (remainingTriangles == 0) {
+            return -1.0f;
+        }
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                score = FORSYTH_LAST_TRIANGLE_SCORE;
+            } else {
+                float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY);
+            }
+        }
+        return score + FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+    }
+
+    void optimize_vertex_cache(std::span<uint32_t> indices, uint32_t vertexCount) {
+        uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+        if (triangleCount == 0) {
+            return;
+        }
+
+        //! Triangles of every vertex in one flat array, remainingTriangles[v] of them still to be emitted
+        std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            remainingTriangles[indices[i]]++;
+        }
+        std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            firstTriangle[v + 1] = firstTriangle[v] + remainingTriangles[v];
+        }
+        std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+        std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            for (uint32_t k = 0; k < 3; k++) {
+                vertexTriangles[fill[indices[t * 3 + k]]++] = t;
+            }
+        }
+
+        std::vector<int32_t> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            vertexScore[v] = get_vertex_score(-1, remainingTriangles[v]);
+        }
+        std::vector<float> triangleScore(triangleCount);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        }
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> output{};
+        output.reserve(triangleCount * 3);
+
+        //! Three extra entries hold the vertices pushed out by the latest triangle until their scores are updated
+        std::vector<uint32_t> cache{};
+        std::vector<uint32_t> nextCache{};
+        cache.reserve(FORSYTH_CACHE_SIZE + 3);
+        nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+        uint32_t bestTriangle = 0;
+        uint32_t scanStart = 0;
+        while (output.size() < (size_t)triangleCount * 3) {
+            emitted[bestTriangle] = true;
+            const uint32_t corners[3] = {indices[bestTriangle * 3], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2]};
+            output.insert(output.end(), corners, corners + 3);
+
+            nextCache.assign(corners, corners + 3);
+            for (uint32_t v : cache) {
+                if (v != corners[0] && v != corners[1] && v != corners[2]) {
+                    nextCache.push_back(v);
+                }
+            }
+            for (uint32_t corner : corners) {
+                //! Removes bestTriangle from the corner's list, the live entries stay in front
+                uint32_t *begin = &vertexTriangles[firstTriangle[corner]];
+                uint32_t *end = begin + remainingTriangles[corner];
+                std::iter_swap(std::find(begin, end, bestTriangle), end - 1);
+                remainingTriangles[corner]--;
+            }
+            std::swap(cache, nextCache);
+
+            //! Rescores the cached vertices and their triangles, the best one of those goes next
+            float bestScore = -1.0f;
+            for (size_t i = 0; i < cache.size(); i++) {
+                uint32_t v = cache[i];
+                int32_t position = i < FORSYTH_CACHE_SIZE ? (int32_t)i : -1;
+                cachePosition[v] = position;
+                float score = get_vertex_score(position, remainingTriangles[v]);
+                float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+                for (uint32_t j = 0; j < remainingTriangles[v]; j++) {
+                    uint32_t t = vertexTriangles[firstTriangle[v] + j];
+                    triangleScore[t] += delta;
+                }
+            }
+            for (uint32_t v : cache) {
+                for (uint32_t j = 0; j < remainingTriangles[v]; j++) {
+                    uint32_t t = vertexTriangles[firstTriangle[v] + j];
+                    if (triangleScore[t] > bestScore) {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+            if (cache.size() > FORSYTH_CACHE_SIZE) {
+                cache.resize(FORSYTH_CACHE_SIZE);
+            }
+
+            if (bestScore < 0.0f) {
+                //! Nothing in the cache has triangles left, continue with the next one in the input order
+                while (scanStart < triangleCount && emitted[scanStart]) {
+                    scanStart++;
+                }
+                if (scanStart == triangleCount) {
+                    break;
+                }
+                bestTriangle = scanStart;
+            }
+        }
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void optimize_vertex_fetch(std::vector<Vertex> &vertices, std::span<uint32_t> indices) {
+        std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+        std::vector<Vertex> reordered{};
+        reordered.reserve(vertices.size());
+        for (uint32_t &index : indices) {
+            if (remap[index] == UINT32_MAX) {
+                remap[index] = (uint32_t)reordered.size();
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices = std::move(reordered);
+    }
+
+    VertexCacheStats analyze_vertex_cache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize) {
+        //! A vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+        std::vector<uint32_t> loadedAt(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        uint32_t misses = 0;
+        uint32_t referencedCount = 0;
+        for (uint32_t index : indices) {
+            if (loadedAt[index] == 0 || misses + 1 - loadedAt[index] > cacheSize) {
+                misses++;
+                loadedAt[index] = misses;
+            }
+            if (!referenced[index]) {
+                referenced[index] = true;
+                referencedCount++;
+            }
+        }
+        uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+        return VertexCacheStats{
+            .vertexShaderInvocations = misses,
+            .acmr = triangleCount > 0 ? (float)misses / triangleCount : 0.0f,
+            .atvr = referencedCount > 0 ? (float)misses / referencedCount : 0.0f,
+        };
+    }
+}  // namespace bluevk
@@ -0,0 +1,195 @@
+#include <meshes.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/gtc/packing.hpp>
+
+namespace bluevk {
+    static constexpr float PI = 3.14159265f;
+
+    static void push_vertex(MeshData &mesh, glm::vec3 position, glm::vec3 normal, glm::vec2 uv) {
+        mesh.vertices.push_back(Vertex{
+            .position = position,
+            .uv_x = uv.x,
+            .normal = normal,
+            .uv_y = uv.y,
+        });
+    }
+    static void push_quad(MeshData &mesh, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+        mesh.indices.insert(mesh.indices.end(), {a, b, c, a, c, d});
+    }
+
+    MeshData generate_cube() {
+        MeshData mesh{};
+        const glm::vec3 normals[6] = {
+            {0.0f, 0.0f, -1.0f},
+            {0.0f, 0.0f, 1.0f},
+            {0.0f, -1.0f, 0.0f},
+            {0.0f, 1.0f, 0.0f},
+            {-1.0f, 0.0f, 0.0f},
+            {1.0f, 0.0f, 0.0f},
+        };
+        for (const glm::vec3 &normal : normals) {
+            //! Two axes spanning the face, so that tangent x bitangent = normal
+            glm::vec3 tangent = std::abs(normal.y) > 0.5f ? glm::vec3{1.0f, 0.0f, 0.0f} : glm::vec3{0.0f, 1.0f, 0.0f};
+            glm::vec3 bitangent = glm::cross(normal, tangent);
+            uint32_t first = (uint32_t)mesh.vertices.size();
+            push_vertex(mesh, normal - tangent - bitangent, normal, {0.0f, 0.0f});
+            push_vertex(mesh, normal + tangent - bitangent, normal, {1.0f, 0.0f});
+            push_vertex(mesh, normal + tangent + bitangent, normal, {1.0f, 1.0f});
+            push_vertex(mesh, normal - tangent + bitangent, normal, {0.0f, 1.0f});
+            push_quad(mesh, first, first + 1, first + 2, first + 3);
+        }
+        return mesh;
+    }
+    MeshData generate_sphere(uint32_t rings, uint32_t segments) {
+        MeshData mesh{};
+        for (uint32_t ring = 0; ring <= rings; ring++) {
+            float v = (float)ring / rings;
+            float phi = v * PI;
+            for (uint32_t segment = 0; segment <= segments; segment++) {
+                float u = (float)segment / segments;
+                float theta = u * 2.0f * PI;
+                glm::vec3 normal{std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta)};
+                push_vertex(mesh, normal, normal, {u, v});
+            }
+        }
+        for (uint32_t ring = 0; ring < rings; ring++) {
+            for (uint32_t segment = 0; segment < segments; segment++) {
+                uint32_t a = ring * (segments + 1) + segment;
+                uint32_t b = a + segments + 1;
+                push_quad(mesh, a, a + 1, b + 1, b);
+            }
+        }
+        return mesh;
+    }
+    MeshData generate_cylinder(uint32_t segments) {
+        MeshData mesh{};
+        for (uint32_t segment = 0; segment <= segments; segment++) {
+            float u = (float)segment / segments;
+            float theta = u * 2.0f * PI;
+            glm::vec3 normal{std::cos(theta), 0.0f, std::sin(theta)};
+            push_vertex(mesh, normal + glm::vec3{0.0f, 1.0f, 0.0f}, normal, {u, 0.0f});
+            push_vertex(mesh, normal - glm::vec3{0.0f, 1.0f, 0.0f}, normal, {u, 1.0f});
+        }
+        for (uint32_t segment = 0; segment < segments; segment++) {
+            uint32_t a = segment * 2;
+            push_quad(mesh, a, a + 2, a + 3, a + 1);
+        }
+
+        //! Caps are fans around a center vertex
+        for (float side : {1.0f, -1.0f}) {
+            glm::vec3 normal{0.0f, side, 0.0f};
+            uint32_t center = (uint32_t)mesh.vertices.size();
+            push_vertex(mesh, normal, normal, {0.5f, 0.5f});
+            for (uint32_t segment = 0; segment <= segments; segment++) {
+                float theta = (float)segment / segments * 2.0f * PI;
+                glm::vec2 rim{std::cos(theta), std::sin(theta)};
+                push_vertex(mesh, glm::vec3{rim.x, side, rim.y}, normal, rim * 0.5f + 0.5f);
+            }
+            for (uint32_t segment = 0; segment < segments; segment++) {
+                mesh.indices.insert(mesh.indices.end(), {center, center + 1 + segment, center + 2 + segment});
+            }
+        }
+        return mesh;
+    }
+    MeshData generate_builtin_mesh(BuiltinMesh mesh) {
+        MeshData data{};
+        switch (mesh) {
+            case MESH_SPHERE:
+                data = generate_sphere(12, 16);
+                break;
+            case MESH_CYLINDER:
+                data = generate_cylinder(16);
+                break;
+            case MESH_CUBE:
+            default:
+                data = generate_cube();
+                break;
+        }
+        generate_tangents(data);
+        return data;
+    }
+
+    void generate_tangents(MeshData &mesh) {
+        std::vector<glm::vec3> tangents(mesh.vertices.size(), glm::vec3{0.0f});
+        std::vector<glm::vec3> bitangents(mesh.vertices.size(), glm::vec3{0.0f});
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const uint32_t corners[3] = {mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]};
+            const Vertex &v0 = mesh.vertices[corners[0]];
+            const Vertex &v1 = mesh.vertices[corners[1]];
+            const Vertex &v2 = mesh.vertices[corners[2]];
+            glm::vec3 edge1 = v1.position - v0.position;
+            glm::vec3 edge2 = v2.position - v0.position;
+            glm::vec2 duv1{v1.uv_x - v0.uv_x, v1.uv_y - v0.uv_y};
+            glm::vec2 duv2{v2.uv_x - v0.uv_x, v2.uv_y - v0.uv_y};
+            float det = duv1.x * duv2.y - duv2.x * duv1.y;
+            if (std::abs(det) < 1e-12f) {
+                continue;
+            }
+            //! Not normalized, larger triangles weigh more
+            glm::vec3 tangent = (edge1 * duv2.y - edge2 * duv1.y) / det;
+            glm::vec3 bitangent = (edge2 * duv1.x - edge1 * duv2.x) / det;
+            for (uint32_t corner : corners) {
+                tangents[corner] += tangent;
+                bitangents[corner] += bitangent;
+            }
+        }
+        for (size_t i = 0; i < mesh.vertices.size(); i++) {
+            Vertex &vertex = mesh.vertices[i];
+            glm::vec3 tangent = tangents[i] - vertex.normal * glm::dot(vertex.normal, tangents[i]);
+            if (glm::dot(tangent, tangent) < 1e-12f) {
+                //! No usable UVs, any direction perpendicular to the normal will do
+                glm::vec3 axis = std::abs(vertex.normal.x) < 0.9f ? glm::vec3{1.0f, 0.0f, 0.0f} : glm::vec3{0.0f, 1.0f, 0.0f};
+                tangent = glm::cross(vertex.normal, axis);
+            }
+            float sign = glm::dot(glm::cross(vertex.normal, tangent), bitangents[i]) < 0.0f ? -1.0f : 1.0f;
+            vertex.tangent = glm::vec4{glm::normalize(tangent), sign};
+        }
+    }
+
+    //! Unit vector onto the octahedron, the lower half folded over the upper one. Decoded in scene_data.glsl
+    static uint32_t pack_octahedral(glm::vec3 v) {
+        v /= std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        glm::vec2 encoded{v.x, v.y};
+        if (v.z < 0.0f) {
+            encoded = (1.0f - glm::abs(glm::vec2{v.y, v.x})) *
+                      glm::vec2{v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f};
+        }
+        return glm::packSnorm2x16(encoded);
+    }
+    std::vector<PackedVertex> pack_vertices(const std::vector<Vertex> &vertices, glm::vec4 &quantization) {
+        glm::vec3 minimum{std::numeric_limits<float>::max()};
+        glm::vec3 maximum{std::numeric_limits<float>::lowest()};
+        for (const Vertex &vertex : vertices) {
+            minimum = glm::min(minimum, vertex.position);
+            maximum = glm::max(maximum, vertex.position);
+        }
+        //! One extent for all axes keeps the dequantize transform uniform, so normals need no extra correction
+        glm::vec3 center = vertices.empty() ? glm::vec3{0.0f} : (minimum + maximum) * 0.5f;
+        glm::vec3 halfSize = vertices.empty() ? glm::vec3{0.0f} : (maximum - minimum) * 0.5f;
+        float extent = std::max({halfSize.x, halfSize.y, halfSize.z, 1e-6f});
+        quantization = glm::vec4{center, extent};
+
+        std::vector<PackedVertex> packed(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vertex &vertex = vertices[i];
+            glm::vec3 position = (vertex.position - center) / extent;
+            packed[i] = PackedVertex{
+                .positionXY = glm::packSnorm2x16(glm::vec2{position.x, position.y}),
+                .positionZW = glm::packSnorm2x16(glm::vec2{position.z, vertex.tangent.w}),
+                .normal = pack_octahedral(vertex.normal),
+                .tangent = pack_octahedral(glm::vec3{vertex.tangent}),
+                .uv = glm::packHalf2x16(glm::vec2{vertex.uv_x, vertex.uv_y}),
+            };
+        }
+        return packed;
+    }
+    glm::mat4 get_dequantize_transform(const glm::vec4 &quantization) {
+        glm::mat4 transform{quantization.w};
+        transform[3] = glm::vec4{glm::vec3{quantization}, 1.0f};
+        return transform;
+    }
+}  // namespace bluevk
@@ -0,0 +1,144 @@
+#include <scene.hpp>
+
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <meshes.hpp>
+
+namespace bluevk {
+    glm::vec3 Camera::get_position() const {
+        glm::vec3 direction{
+            std::cos(pitch) * std::sin(yaw),
+            std::sin(pitch),
+            std::cos(pitch) * std::cos(yaw),
+        };
+        return target + direction * distance;
+    }
+    glm::mat4 Camera::get_view() const {
+        return glm::lookAt(get_position(), target, glm::vec3{0.0f, 1.0f, 0.0f});
+    }
+    glm::mat4 Camera::get_projection(float aspect) const {
+        glm::mat4 proj = glm::perspective(glm::radians(fovy), aspect, zFar, zNear);
+        //! Vulkan's clip space has Y pointing down
+        proj[1][1] *= -1.0f;
+        return proj;
+    }
+
+    void extract_frustum_planes(const glm::mat4 &viewProj, glm::vec4 planes[6]) {
+        glm::mat4 m = glm::transpose(viewProj);
+        planes[0] = m[3] + m[0];  // left
+        planes[1] = m[3] - m[0];  // right
+        planes[2] = m[3] + m[1];  // bottom
+        planes[3] = m[3] - m[1];  // top
+        planes[4] = m[2];         // far (reverse-Z: depth >= 0)
+        planes[5] = m[3] - m[2];  // near (reverse-Z: depth <= 1)
+        for (uint32_t i = 0; i < 6; i++) {
+            planes[i] /= glm::length(glm::vec3(planes[i]));
+        }
+    }
+
+    glm::mat4 get_light_view(const glm::vec3 &lightDirection) {
+        glm::vec3 up = std::abs(lightDirection.y) < 0.99f ? glm::vec3{0.0f, 1.0f, 0.0f} : glm::vec3{0.0f, 0.0f, 1.0f};
+        return glm::lookAt(glm::vec3{0.0f}, -lightDirection, up);
+    }
+    void compute_cascade_splits(float zNear, float shadowDistance, float lambda, float splits[SHADOW_CASCADE_COUNT]) {
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            float p = (float)(i + 1) / SHADOW_CASCADE_COUNT;
+            float logarithmic = zNear * std::pow(shadowDistance / zNear, p);
+            float uniform = zNear + (shadowDistance - zNear) * p;
+            splits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+        }
+    }
+    glm::vec4 get_frustum_slice_sphere(const Camera &camera, float aspect, float nearDistance, float farDistance) {
+        //! Centered on the view axis where the near and far corners are equally far away, or at the far
+        //! plane's center once that is enough to hold the near corners
+        float tanHalfFov = std::tan(glm::radians(camera.fovy) * 0.5f);
+        float cornerScale = tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);
+        float farCorner = farDistance * farDistance * cornerScale;
+        float centerDistance = 0.5f * (nearDistance + farDistance) * (1.0f + cornerScale);
+        float radius = 0.0f;
+        if (centerDistance >= farDistance) {
+            centerDistance = farDistance;
+            radius = std::sqrt(farCorner);
+        } else {
+            float offset = centerDistance - farDistance;
+            radius = std::sqrt(offset * offset + farCorner);
+        }
+        glm::vec3 position = camera.get_position();
+        glm::vec3 forward = glm::normalize(camera.target - position);
+        return glm::vec4{position + forward * centerDistance, radius};
+    }
+    bool update_shadow_cascade(ShadowCascade &cascade, const glm::mat4 &lightView, const glm::vec4 &sliceSphere, const glm::vec4 &sceneBounds) {
+        glm::vec2 center{lightView * glm::vec4{glm::vec3{sliceSphere}, 1.0f}};
+        float radius = sliceSphere.w;
+        glm::vec2 offset = glm::abs(center - cascade.center);
+        if (cascade.staticValid && std::max(offset.x, offset.y) + radius <= cascade.halfSize) {
+            return false;
+        }
+
+        //! Snapping to whole texels keeps edges from crawling when the region moves
+        cascade.halfSize = radius * SHADOW_CASCADE_MARGIN;
+        float texelSize = 2.0f * cascade.halfSize / SHADOW_MAP_SIZE;
+        cascade.center = glm::floor(center / texelSize) * texelSize;
+        //! The light looks down -z, view depths of the scene are -z. Near and far are swapped for reverse-Z.
+        float sceneDepth = -(lightView * glm::vec4{glm::vec3{sceneBounds}, 1.0f}).z;
+        glm::mat4 proj = glm::orthoRH_ZO(cascade.center.x - cascade.halfSize, cascade.center.x + cascade.halfSize,
+                                         cascade.center.y - cascade.halfSize, cascade.center.y + cascade.halfSize,
+                                         sceneDepth + sceneBounds.w, sceneDepth - sceneBounds.w);
+        cascade.viewProj = proj * lightView;
+        cascade.staticValid = false;
+        return true;
+    }
+    bool shadow_cascade_overlaps(const ShadowCascade &cascade, const glm::mat4 &lightView, const glm::vec4 &sphere) {
+        glm::vec2 center{lightView * glm::vec4{glm::vec3{sphere}, 1.0f}};
+        glm::vec2 offset = glm::abs(center - cascade.center);
+        return std::max(offset.x, offset.y) <= cascade.halfSize + sphere.w;
+    }
+
+    std::vector<SceneObject> generate_dense_scene(uint32_t objectsPerAxis, uint32_t layerCount) {
+        std::vector<SceneObject> objects{};
+        objects.reserve(objectsPerAxis * objectsPerAxis * layerCount + 4);
+
+        auto push_object = [&](uint32_t mesh, glm::vec3 position, glm::vec3 scale, glm::vec4 color) {
+            glm::mat4 model = glm::scale(glm::translate(glm::mat4{1.0f}, position), scale);
+            //! The unit meshes span [-1, 1], so the scaled half diagonal of that cube bounds them all
+            float radius = glm::length(scale);
+            objects.push_back(SceneObject{
+                .data = GPUObjectData{
+                    .model = model,
+                    .sphereBounds = glm::vec4{position, radius},
+                    .color = color,
+                },
+                .mesh = mesh,
+            });
+        };
+
+        //! Occluder walls between the camera and the grid
+        push_object(MESH_CUBE, glm::vec3{-12.0f, 0.0f, 12.0f}, glm::vec3{10.0f, 14.0f, 0.5f}, glm::vec4{0.8f, 0.8f, 0.8f, 1.0f});
+        push_object(MESH_CUBE, glm::vec3{12.0f, 0.0f, 12.0f}, glm::vec3{10.0f, 14.0f, 0.5f}, glm::vec4{0.8f, 0.8f, 0.8f, 1.0f});
+        push_object(MESH_CUBE, glm::vec3{0.0f, -10.0f, 10.0f}, glm::vec3{30.0f, 0.5f, 10.0f}, glm::vec4{0.5f, 0.5f, 0.5f, 1.0f});
+
+        float spacing = 2.5f;
+        float offset = (objectsPerAxis - 1) * spacing * 0.5f;
+        for (uint32_t layer = 0; layer < layerCount; layer++) {
+            for (uint32_t y = 0; y < objectsPerAxis; y++) {
+                for (uint32_t x = 0; x < objectsPerAxis; x++) {
+                    glm::vec3 position{
+                        x * spacing - offset,
+                        y * spacing - offset,
+                        -(float)layer * spacing,
+                    };
+                    glm::vec4 color{
+                        (float)x / objectsPerAxis,
+                        (float)y / objectsPerAxis,
+                        1.0f - (float)layer / layerCount,
+                        1.0f,
+                    };
+                    push_object((x + y + layer) % BUILTIN_MESH_COUNT, position, glm::vec3{0.5f}, color);
+                }
+            }
+        }
+        return objects;
+    }
+}  // namespace bluevk
@@ -0,0 +1,163 @@
+#include <skinning.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/quaternion.hpp>
+
+namespace bluevk {
+    static constexpr float PI = 3.14159265f;
+
+    SkinnedMeshData generate_skinned_tube(uint32_t jointCount, uint32_t rings, uint32_t segments, float length, float radius) {
+        SkinnedMeshData data{};
+        float jointLength = length / jointCount;
+        for (uint32_t joint = 0; joint < jointCount; joint++) {
+            glm::mat4 inverseBind{1.0f};
+            inverseBind[3] = glm::vec4{0.0f, -(float)joint * jointLength, 0.0f, 1.0f};
+            data.skeleton.parents.push_back(joint == 0 ? NO_PARENT_JOINT : joint - 1);
+            data.skeleton.inverseBind.push_back(inverseBind);
+        }
+        data.reach = length + radius;
+
+        //! Every height is blended between the two joints whose segment centers surround it
+        auto get_influence = [&](float y) {
+            float u = std::clamp(y / jointLength - 0.5f, 0.0f, (float)(jointCount - 1));
+            uint32_t first = std::min((uint32_t)u, jointCount - 1);
+            uint32_t second = std::min(first + 1, jointCount - 1);
+            uint32_t secondWeight = (uint32_t)std::lround((u - first) * 255.0f);
+            return SkinInfluence{
+                .joints = first | (second << 8),
+                .weights = (255 - secondWeight) | (secondWeight << 8),
+            };
+        };
+        auto push_vertex = [&](glm::vec3 position, glm::vec3 normal, glm::vec2 uv) {
+            data.mesh.vertices.push_back(Vertex{
+                .position = position,
+                .uv_x = uv.x,
+                .normal = normal,
+                .uv_y = uv.y,
+            });
+            data.influences.push_back(get_influence(position.y));
+        };
+
+        for (uint32_t ring = 0; ring <= rings; ring++) {
+            float v = (float)ring / rings;
+            float ringRadius = radius * (1.0f - 0.6f * v);
+            for (uint32_t segment = 0; segment <= segments; segment++) {
+                float u = (float)segment / segments;
+                float theta = u * 2.0f * PI;
+                glm::vec3 normal{std::cos(theta), 0.0f, std::sin(theta)};
+                push_vertex(normal * ringRadius + glm::vec3{0.0f, v * length, 0.0f}, normal, {u, v});
+            }
+        }
+        for (uint32_t ring = 0; ring < rings; ring++) {
+            for (uint32_t segment = 0; segment < segments; segment++) {
+                uint32_t a = ring * (segments + 1) + segment;
+                uint32_t b = a + segments + 1;
+                data.mesh.indices.insert(data.mesh.indices.end(), {a, b, b + 1, a, b + 1, a + 1});
+            }
+        }
+
+        //! The tip is closed by a fan, the root sits on the ground and stays open
+        uint32_t center = (uint32_t)data.mesh.vertices.size();
+        float tipRadius = radius * 0.4f;
+        push_vertex(glm::vec3{0.0f, length, 0.0f}, glm::vec3{0.0f, 1.0f, 0.0f}, {0.5f, 0.5f});
+        for (uint32_t segment = 0; segment <= segments; segment++) {
+            float theta = (float)segment / segments * 2.0f * PI;
+            glm::vec2 rim{std::cos(theta), std::sin(theta)};
+            push_vertex(glm::vec3{rim.x * tipRadius, length, rim.y * tipRadius}, glm::vec3{0.0f, 1.0f, 0.0f}, rim * 0.5f + 0.5f);
+        }
+        for (uint32_t segment = 0; segment < segments; segment++) {
+            data.mesh.indices.insert(data.mesh.indices.end(), {center, center + 2 + segment, center + 1 + segment});
+        }
+
+        generate_tangents(data.mesh);
+        return data;
+    }
+
+    AnimationClip generate_sway_clip(const Skeleton &skeleton, float duration, float sampleRate) {
+        uint32_t jointCount = skeleton.get_joint_count();
+        AnimationClip clip{
+            .sampleRate = sampleRate,
+            .keyCount = (uint32_t)std::ceil(duration * sampleRate) + 1,
+            .jointStride = skeleton.get_joint_stride(),
+        };
+        uint32_t stride = clip.jointStride;
+        clip.keys.resize((size_t)clip.keyCount * JOINT_CHANNEL_COUNT * stride, 0.0f);
+
+        //! Whole periods over the clip, so the last key matches the first one
+        for (uint32_t key = 0; key < clip.keyCount; key++) {
+            float phase = 2.0f * PI * key / (clip.keyCount - 1);
+            float *pose = &clip.keys[(size_t)key * JOINT_CHANNEL_COUNT * stride];
+            for (uint32_t joint = 0; joint < stride; joint++) {
+                glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+                glm::vec3 translation{0.0f};
+                if (joint < jointCount) {
+                    float bend = 0.35f * std::sin(phase + joint * 0.7f);
+                    float twist = 0.2f * std::sin(2.0f * phase + joint * 0.5f);
+                    rotation = glm::angleAxis(bend, glm::vec3{0.0f, 0.0f, 1.0f}) * glm::angleAxis(twist, glm::vec3{1.0f, 0.0f, 0.0f});
+                    //! Children keep their bind offset from the parent
+                    uint32_t parent = skeleton.parents[joint];
+                    if (parent != NO_PARENT_JOINT) {
+                        translation = glm::vec3{skeleton.inverseBind[parent][3] - skeleton.inverseBind[joint][3]};
+                    }
+                }
+                pose[JOINT_ROTATION_X * stride + joint] = rotation.x;
+                pose[JOINT_ROTATION_Y * stride + joint] = rotation.y;
+                pose[JOINT_ROTATION_Z * stride + joint] = rotation.z;
+                pose[JOINT_ROTATION_W * stride + joint] = rotation.w;
+                pose[JOINT_TRANSLATION_X * stride + joint] = translation.x;
+                pose[JOINT_TRANSLATION_Y * stride + joint] = translation.y;
+                pose[JOINT_TRANSLATION_Z * stride + joint] = translation.z;
+            }
+        }
+        return clip;
+    }
+
+    void sample_clip(const AnimationClip &clip, float time, float *pose) {
+        float duration = clip.get_duration();
+        float t = std::fmod(time, duration);
+        if (t < 0.0f) {
+            t += duration;
+        }
+        float position = t * clip.sampleRate;
+        uint32_t key = std::min((uint32_t)position, clip.keyCount - 2);
+        float blend = position - key;
+
+        uint32_t stride = clip.jointStride;
+        const float *a = &clip.keys[(size_t)key * JOINT_CHANNEL_COUNT * stride];
+        const float *b = a + JOINT_CHANNEL_COUNT * stride;
+
+        //! Branch free normalized lerp along the shorter arc, one joint per lane
+        const float *ax = a + JOINT_ROTATION_X * stride, *bx = b + JOINT_ROTATION_X * stride;
+        const float *ay = a + JOINT_ROTATION_Y * stride, *by = b + JOINT_ROTATION_Y * stride;
+        const float *az = a + JOINT_ROTATION_Z * stride, *bz = b + JOINT_ROTATION_Z * stride;
+        const float *aw = a + JOINT_ROTATION_W * stride, *bw = b + JOINT_ROTATION_W * stride;
+        float *x = pose + JOINT_ROTATION_X * stride;
+        float *y = pose + JOINT_ROTATION_Y * stride;
+        float *z = pose + JOINT_ROTATION_Z * stride;
+        float *w = pose + JOINT_ROTATION_W * stride;
+        for (uint32_t joint = 0; joint < stride; joint++) {
+            float cosine = ax[joint] * bx[joint] + ay[joint] * by[joint] + az[joint] * bz[joint] + aw[joint] * bw[joint];
+            float weightB = cosine < 0.0f ? -blend : blend;
+            float weightA = 1.0f - blend;
+            float qx = ax[joint] * weightA + bx[joint] * weightB;
+            float qy = ay[joint] * weightA + by[joint] * weightB;
+            float qz = az[joint] * weightA + bz[joint] * weightB;
+            float qw = aw[joint] * weightA + bw[joint] * weightB;
+            float inverseLength = 1.0f / std::sqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+            x[joint] = qx * inverseLength;
+            y[joint] = qy * inverseLength;
+            z[joint] = qz * inverseLength;
+            w[joint] = qw * inverseLength;
+        }
+        for (uint32_t channel = JOINT_TRANSLATION_X; channel <= JOINT_TRANSLATION_Z; channel++) {
+            const float *from = a + channel * stride;
+            const float *to = b + channel * stride;
+            float *out = pose + channel * stride;
+            for (uint32_t joint = 0; joint < stride; joint++) {
+                out[joint] = from[joint] + (to[joint] - from[joint]) * blend;
+            }
+        }
+    }
+}  // namespace bluevk
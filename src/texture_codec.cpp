@@ -0,0 +1,353 @@
+#include <texture_codec.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace bluevk {
+    static constexpr uint32_t BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    struct BitWriter {
+        uint8_t *data;
+        uint32_t bit{0};
+        void write(uint32_t value, uint32_t count) {
+            for (uint32_t i = 0; i < count; i++, bit++) {
+                if ((value >> i) & 1) {
+                    data[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+                }
+            }
+        }
+    };
+    struct BitReader {
+        const uint8_t *data;
+        uint32_t bit{0};
+        uint32_t read(uint32_t count) {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; i++, bit++) {
+                value |= (uint32_t)((data[bit >> 3] >> (bit & 7)) & 1) << i;
+            }
+            return value;
+        }
+    };
+
+    std::vector<uint8_t> downsample_rgba8(const std::vector<uint8_t> &pixels, VkExtent2D extent, VkExtent2D &outExtent) {
+        outExtent = VkExtent2D{std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u)};
+        std::vector<uint8_t> result(outExtent.width * outExtent.height * 4);
+        for (uint32_t y = 0; y < outExtent.height; y++) {
+            for (uint32_t x = 0; x < outExtent.width; x++) {
+                uint32_t x0 = std::min(x * 2, extent.width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, extent.width - 1);
+                uint32_t y0 = std::min(y * 2, extent.height - 1);
+                uint32_t y1 = std::min(y * 2 + 1, extent.height - 1);
+                for (uint32_t c = 0; c < 4; c++) {
+                    uint32_t sum = pixels[(y0 * extent.width + x0) * 4 + c] +
+                                   pixels[(y0 * extent.width + x1) * 4 + c] +
+                                   pixels[(y1 * extent.width + x0) * 4 + c] +
+                                   pixels[(y1 * extent.width + x1) * 4 + c];
+                    result[(y * outExtent.width + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+                }
+            }
+        }
+        return result;
+    }
+
+    bool is_bc_format(VkFormat format) {
+        return format == VK_FORMAT_BC7_UNORM_BLOCK ||
+               format == VK_FORMAT_BC7_SRGB_BLOCK ||
+               format == VK_FORMAT_BC5_UNORM_BLOCK;
+    }
+    size_t get_image_size(VkFormat format, VkExtent2D extent) {
+        if (is_bc_format(format)) {
+            return (size_t)((extent.width + 3) / 4) * ((extent.height + 3) / 4) * BC_BLOCK_SIZE;
+        }
+        return (size_t)extent.width * extent.height * 4;
+    }
+
+    static void quantize_bc7_endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t &pBit) {
+        float bestError = INFINITY;
+        for (uint32_t p = 0; p < 2; p++) {
+            uint32_t candidate[4];
+            float error = 0.0f;
+            for (uint32_t c = 0; c < 4; c++) {
+                int q = (int)std::round((endpoint[c] - p) / 2.0f);
+                candidate[c] = (uint32_t)std::clamp(q, 0, 127);
+                float diff = (float)((candidate[c] << 1) | p) - endpoint[c];
+                error += diff * diff;
+            }
+            if (error < bestError) {
+                bestError = error;
+                pBit = p;
+                memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    void encode_bc7_block(const uint8_t rgba[16 * 4], uint8_t block[16]) {
+        //! Endpoints are the extremes of the block projected onto its principal axis
+        float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float minColor[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+        float maxColor[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (uint32_t i = 0; i < 16; i++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                float value = rgba[i * 4 + c];
+                mean[c] += value / 16.0f;
+                minColor[c] = std::min(minColor[c], value);
+                maxColor[c] = std::max(maxColor[c], value);
+            }
+        }
+        float covariance[4][4] = {};
+        for (uint32_t i = 0; i < 16; i++) {
+            for (uint32_t a = 0; a < 4; a++) {
+                for (uint32_t b = 0; b < 4; b++) {
+                    covariance[a][b] += (rgba[i * 4 + a] - mean[a]) * (rgba[i * 4 + b] - mean[b]);
+                }
+            }
+        }
+        float axis[4];
+        for (uint32_t c = 0; c < 4; c++) {
+            axis[c] = maxColor[c] - minColor[c];
+        }
+        for (uint32_t iteration = 0; iteration < 8; iteration++) {
+            float next[4] = {};
+            for (uint32_t a = 0; a < 4; a++) {
+                for (uint32_t b = 0; b < 4; b++) {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+            }
+            float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+            if (length < 1e-6f) {
+                break;
+            }
+            for (uint32_t c = 0; c < 4; c++) {
+                axis[c] = next[c] / length;
+            }
+        }
+        float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+        float minT = 0.0f, maxT = 0.0f;
+        if (axisLength > 1e-6f) {
+            for (uint32_t c = 0; c < 4; c++) {
+                axis[c] /= axisLength;
+            }
+            minT = INFINITY;
+            maxT = -INFINITY;
+            for (uint32_t i = 0; i < 16; i++) {
+                float t = 0.0f;
+                for (uint32_t c = 0; c < 4; c++) {
+                    t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+                }
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+        }
+        float endpoints[2][4];
+        for (uint32_t c = 0; c < 4; c++) {
+            endpoints[0][c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+            endpoints[1][c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+        }
+
+        uint32_t quantized[2][4];
+        uint32_t pBits[2];
+        quantize_bc7_endpoint(endpoints[0], quantized[0], pBits[0]);
+        quantize_bc7_endpoint(endpoints[1], quantized[1], pBits[1]);
+
+        uint32_t palette[16][4];
+        for (uint32_t i = 0; i < 16; i++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                uint32_t e0 = (quantized[0][c] << 1) | pBits[0];
+                uint32_t e1 = (quantized[1][c] << 1) | pBits[1];
+                palette[i][c] = ((64 - BC7_WEIGHTS4[i]) * e0 + BC7_WEIGHTS4[i] * e1 + 32) >> 6;
+            }
+        }
+        uint32_t indices[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            uint32_t bestError = UINT32_MAX;
+            for (uint32_t p = 0; p < 16; p++) {
+                uint32_t error = 0;
+                for (uint32_t c = 0; c < 4; c++) {
+                    int diff = (int)palette[p][c] - (int)rgba[i * 4 + c];
+                    error += diff * diff;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    indices[i] = p;
+                }
+            }
+        }
+
+        //! The anchor index only stores 3 bits, so its high bit has to be zero
+        if (indices[0] & 8) {
+            std::swap(quantized[0], quantized[1]);
+            std::swap(pBits[0], pBits[1]);
+            for (uint32_t i = 0; i < 16; i++) {
+                indices[i] = 15 - indices[i];
+            }
+        }
+
+        memset(block, 0, 16);
+        BitWriter writer{.data = block};
+        writer.write(1 << 6, 7);
+        for (uint32_t c = 0; c < 4; c++) {
+            writer.write(quantized[0][c], 7);
+            writer.write(quantized[1][c], 7);
+        }
+        writer.write(pBits[0], 1);
+        writer.write(pBits[1], 1);
+        writer.write(indices[0], 3);
+        for (uint32_t i = 1; i < 16; i++) {
+            writer.write(indices[i], 4);
+        }
+    }
+    bool decode_bc7_block(const uint8_t block[16], uint8_t rgba[16 * 4]) {
+        BitReader reader{.data = block};
+        if (reader.read(7) != (1 << 6)) {
+            //! Unsupported mode, decoded as magenta so it stands out
+            for (uint32_t i = 0; i < 16; i++) {
+                rgba[i * 4 + 0] = 255;
+                rgba[i * 4 + 1] = 0;
+                rgba[i * 4 + 2] = 255;
+                rgba[i * 4 + 3] = 255;
+            }
+            return false;
+        }
+        uint32_t endpoints[2][4];
+        for (uint32_t c = 0; c < 4; c++) {
+            endpoints[0][c] = reader.read(7) << 1;
+            endpoints[1][c] = reader.read(7) << 1;
+        }
+        uint32_t p0 = reader.read(1);
+        uint32_t p1 = reader.read(1);
+        for (uint32_t c = 0; c < 4; c++) {
+            endpoints[0][c] |= p0;
+            endpoints[1][c] |= p1;
+        }
+        for (uint32_t i = 0; i < 16; i++) {
+            uint32_t index = reader.read(i == 0 ? 3 : 4);
+            for (uint32_t c = 0; c < 4; c++) {
+                rgba[i * 4 + c] = (uint8_t)(((64 - BC7_WEIGHTS4[index]) * endpoints[0][c] + BC7_WEIGHTS4[index] * endpoints[1][c] + 32) >> 6);
+            }
+        }
+        return true;
+    }
+
+    static void encode_bc4_block(const uint8_t values[16], uint8_t block[8]) {
+        uint8_t r0 = 0, r1 = 255;
+        for (uint32_t i = 0; i < 16; i++) {
+            r0 = std::max(r0, values[i]);
+            r1 = std::min(r1, values[i]);
+        }
+        uint32_t palette[8] = {r0, r1};
+        for (uint32_t i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7;
+        }
+
+        memset(block, 0, 8);
+        BitWriter writer{.data = block};
+        writer.write(r0, 8);
+        writer.write(r1, 8);
+        for (uint32_t i = 0; i < 16; i++) {
+            uint32_t bestIndex = 0;
+            int bestError = INT32_MAX;
+            for (uint32_t p = 0; p < 8; p++) {
+                int error = std::abs((int)palette[p] - (int)values[i]);
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+            writer.write(bestIndex, 3);
+        }
+    }
+    static void decode_bc4_block(const uint8_t block[8], uint8_t values[16]) {
+        BitReader reader{.data = block};
+        uint32_t r0 = reader.read(8);
+        uint32_t r1 = reader.read(8);
+        uint32_t palette[8] = {r0, r1};
+        if (r0 > r1) {
+            for (uint32_t i = 2; i < 8; i++) {
+                palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7;
+            }
+        } else {
+            for (uint32_t i = 2; i < 6; i++) {
+                palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        for (uint32_t i = 0; i < 16; i++) {
+            values[i] = (uint8_t)palette[reader.read(3)];
+        }
+    }
+
+    void encode_bc5_block(const uint8_t rgba[16 * 4], uint8_t block[16]) {
+        uint8_t red[16], green[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            red[i] = rgba[i * 4 + 0];
+            green[i] = rgba[i * 4 + 1];
+        }
+        encode_bc4_block(red, block);
+        encode_bc4_block(green, block + 8);
+    }
+    void decode_bc5_block(const uint8_t block[16], uint8_t rgba[16 * 4]) {
+        uint8_t red[16], green[16];
+        decode_bc4_block(block, red);
+        decode_bc4_block(block + 8, green);
+        for (uint32_t i = 0; i < 16; i++) {
+            rgba[i * 4 + 0] = red[i];
+            rgba[i * 4 + 1] = green[i];
+            rgba[i * 4 + 2] = 0;
+            rgba[i * 4 + 3] = 255;
+        }
+    }
+
+    std::vector<uint8_t> compress_image(const std::vector<uint8_t> &rgba, VkExtent2D extent, VkFormat format) {
+        std::vector<uint8_t> blocks(get_image_size(format, extent));
+        uint32_t blocksX = (extent.width + 3) / 4;
+        uint32_t blocksY = (extent.height + 3) / 4;
+        for (uint32_t by = 0; by < blocksY; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                //! Edge blocks repeat the last row/column
+                uint8_t texels[16 * 4];
+                for (uint32_t y = 0; y < 4; y++) {
+                    for (uint32_t x = 0; x < 4; x++) {
+                        uint32_t sx = std::min(bx * 4 + x, extent.width - 1);
+                        uint32_t sy = std::min(by * 4 + y, extent.height - 1);
+                        memcpy(&texels[(y * 4 + x) * 4], &rgba[(sy * extent.width + sx) * 4], 4);
+                    }
+                }
+                uint8_t *block = &blocks[(by * blocksX + bx) * BC_BLOCK_SIZE];
+                if (format == VK_FORMAT_BC5_UNORM_BLOCK) {
+                    encode_bc5_block(texels, block);
+                } else {
+                    encode_bc7_block(texels, block);
+                }
+            }
+        }
+        return blocks;
+    }
+    std::vector<uint8_t> decompress_image(const std::vector<uint8_t> &blocks, VkExtent2D extent, VkFormat format) {
+        std::vector<uint8_t> rgba((size_t)extent.width * extent.height * 4);
+        uint32_t blocksX = (extent.width + 3) / 4;
+        uint32_t blocksY = (extent.height + 3) / 4;
+        bool unsupportedBlocks = false;
+        for (uint32_t by = 0; by < blocksY; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                const uint8_t *block = &blocks[(by * blocksX + bx) * BC_BLOCK_SIZE];
+                uint8_t texels[16 * 4];
+                if (format == VK_FORMAT_BC5_UNORM_BLOCK) {
+                    decode_bc5_block(block, texels);
+                } else if (!decode_bc7_block(block, texels)) {
+                    unsupportedBlocks = true;
+                }
+                for (uint32_t y = 0; y < 4 && by * 4 + y < extent.height; y++) {
+                    for (uint32_t x = 0; x < 4 && bx * 4 + x < extent.width; x++) {
+                        memcpy(&rgba[((by * 4 + y) * extent.width + bx * 4 + x) * 4], &texels[(y * 4 + x) * 4], 4);
+                    }
+                }
+            }
+        }
+        if (unsupportedBlocks) {
+            fmt::println("[BlueVK]::[WARNING]: BC7 blocks using modes other than 6 can't be decoded on the CPU!");
+        }
+        return rgba;
+    }
+}  // namespace bluevk
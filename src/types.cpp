@@ -0,0 +1,14 @@
+#include <types.hpp>
+
+#include <cstdlib>
+
+namespace bluevk {
+    void vk_check_failed(VkResult result, const char *call, const char *file, int line) {
+        if (call != nullptr) {
+            fmt::println(stderr, "Detected Vulkan error: {} in '{}' at {}:{}", string_VkResult(result), call, file, line);
+        } else {
+            fmt::println(stderr, "Detected Vulkan error: {}", string_VkResult(result));
+        }
+        abort();
+    }
+}  // namespace bluevk
@@ -0,0 +1,51 @@
+#include <vk_buffers.hpp>
+#include <vk_dispatch.hpp>
+
+namespace bluevk {
+    VkDeviceAddress get_buffer_device_address(VkDevice device, VkBuffer buffer) {
+        VkBufferDeviceAddressInfo info{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+            .pNext = nullptr,
+            .buffer = buffer,
+        };
+        return vkd.vkGetBufferDeviceAddress(device, &info);
+    }
+
+    void memory_barrier(VkCommandBuffer cmd,
+                        VkPipelineStageFlags2 srcStageMask,
+                        VkAccessFlags2 srcAccessMask,
+                        VkPipelineStageFlags2 dstStageMask,
+                        VkAccessFlags2 dstAccessMask) {
+        VkMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                                 .pNext = nullptr,
+                                 .srcStageMask = srcStageMask,
+                                 .srcAccessMask = srcAccessMask,
+                                 .dstStageMask = dstStageMask,
+                                 .dstAccessMask = dstAccessMask};
+        VkDependencyInfo depInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                 .pNext = nullptr,
+                                 .memoryBarrierCount = 1,
+                                 .pMemoryBarriers = &barrier};
+        vkd.vkCmdPipelineBarrier2(cmd, &depInfo);
+    }
+
+    void copy_buffer_to_buffer(VkCommandBuffer cmd,
+                               VkBuffer source,
+                               VkBuffer destination,
+                               VkDeviceSize size,
+                               VkDeviceSize srcOffset,
+                               VkDeviceSize dstOffset) {
+        VkBufferCopy2 region{.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+                             .pNext = nullptr,
+                             .srcOffset = srcOffset,
+                             .dstOffset = dstOffset,
+                             .size = size};
+        VkCopyBufferInfo2 copyInfo{.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
+                                   .pNext = nullptr,
+                                   .srcBuffer = source,
+                                   .dstBuffer = destination,
+                                   .regionCount = 1,
+                                   .pRegions = &region};
+        vkd.vkCmdCopyBuffer2(cmd, &copyInfo);
+    }
+}  // namespace bluevk
@@ -1,4 +1,5 @@
 #include <vk_builders.hpp>
+#include <vk_dispatch.hpp>
 
 namespace bluevk {
     CommandPoolBuilder& CommandPoolBuilder::set_queue_family_index(uint32_t queueFamilyIndex) {
@@ -11,7 +12,7 @@ namespace bluevk {
     }
     VkCommandPool CommandPoolBuilder::build(VkDevice device) {
         VkCommandPool pool;
-        VK_CHECK(vkCreateCommandPool(device, &info, nullptr, &pool));
+        VK_CHECK(vkd.vkCreateCommandPool(device, &info, nullptr, &pool));
         return pool;
     }
     CommandBufferAllocator& CommandBufferAllocator::set_command_pool(VkCommandPool pool) {
@@ -24,7 +25,7 @@ namespace bluevk {
     }
     VkCommandBuffer CommandBufferAllocator::allocate(VkDevice device) {
         VkCommandBuffer cmd;
-        VK_CHECK(vkAllocateCommandBuffers(device, &info, &cmd));
+        VK_CHECK(vkd.vkAllocateCommandBuffers(device, &info, &cmd));
         return cmd;
     }
     ImageBuilder& ImageBuilder::set_format(VkFormat format) {
@@ -39,9 +40,17 @@ namespace bluevk {
         info.usage = usage;
         return *this;
     }
+    ImageBuilder& ImageBuilder::set_mip_levels(uint32_t mipLevels) {
+        info.mipLevels = mipLevels;
+        return *this;
+    }
+    ImageBuilder& ImageBuilder::set_array_layers(uint32_t arrayLayers) {
+        info.arrayLayers = arrayLayers;
+        return *this;
+    }
     VkImage ImageBuilder::build(VkDevice device) {
         VkImage image;
-        VK_CHECK(vkCreateImage(device, &info, nullptr, &image));
+        VK_CHECK(vkd.vkCreateImage(device, &info, nullptr, &image));
         return image;
     }
     VkImage ImageBuilder::vmaBuild(VmaAllocator allocator, VmaAllocationCreateInfo* allocCreateInfo, VmaAllocation* alloc, VmaAllocationInfo* allocInfo) {
@@ -61,18 +70,70 @@ namespace bluevk {
         info.subresourceRange.aspectMask = aspectMask;
         return *this;
     }
+    ImageViewBuilder& ImageViewBuilder::set_mip_range(uint32_t baseMipLevel, uint32_t levelCount) {
+        info.subresourceRange.baseMipLevel = baseMipLevel;
+        info.subresourceRange.levelCount = levelCount;
+        return *this;
+    }
+    ImageViewBuilder& ImageViewBuilder::set_view_type(VkImageViewType viewType) {
+        info.viewType = viewType;
+        return *this;
+    }
+    ImageViewBuilder& ImageViewBuilder::set_layer_range(uint32_t baseArrayLayer, uint32_t layerCount) {
+        info.subresourceRange.baseArrayLayer = baseArrayLayer;
+        info.subresourceRange.layerCount = layerCount;
+        return *this;
+    }
     VkImageView ImageViewBuilder::build(VkDevice device) {
         VkImageView view;
-        VK_CHECK(vkCreateImageView(device, &info, nullptr, &view));
+        VK_CHECK(vkd.vkCreateImageView(device, &info, nullptr, &view));
         return view;
     }
+    BufferBuilder& BufferBuilder::set_size(VkDeviceSize size) {
+        info.size = size;
+        return *this;
+    }
+    BufferBuilder& BufferBuilder::set_usage(VkBufferUsageFlags usage) {
+        info.usage = usage;
+        return *this;
+    }
+    VkBuffer BufferBuilder::vmaBuild(VmaAllocator allocator, VmaAllocationCreateInfo* allocCreateInfo, VmaAllocation* alloc, VmaAllocationInfo* allocInfo) {
+        VkBuffer buffer;
+        VK_CHECK(vmaCreateBuffer(allocator, &info, allocCreateInfo, &buffer, alloc, allocInfo));
+        return buffer;
+    }
+    SamplerBuilder& SamplerBuilder::set_filter(VkFilter magFilter, VkFilter minFilter) {
+        info.magFilter = magFilter;
+        info.minFilter = minFilter;
+        return *this;
+    }
+    SamplerBuilder& SamplerBuilder::set_mipmap_mode(VkSamplerMipmapMode mode) {
+        info.mipmapMode = mode;
+        return *this;
+    }
+    SamplerBuilder& SamplerBuilder::set_address_mode(VkSamplerAddressMode mode) {
+        info.addressModeU = mode;
+        info.addressModeV = mode;
+        info.addressModeW = mode;
+        return *this;
+    }
+    SamplerBuilder& SamplerBuilder::set_compare_op(VkCompareOp op) {
+        info.compareEnable = VK_TRUE;
+        info.compareOp = op;
+        return *this;
+    }
+    VkSampler SamplerBuilder::build(VkDevice device) {
+        VkSampler sampler;
+        VK_CHECK(vkd.vkCreateSampler(device, &info, nullptr, &sampler));
+        return sampler;
+    }
     FenceBuilder& FenceBuilder::set_create_flags(VkFenceCreateFlags flags) {
         info.flags = flags;
         return *this;
     }
     VkFence FenceBuilder::build(VkDevice device) {
         VkFence fence;
-        VK_CHECK(vkCreateFence(device, &info, nullptr, &fence));
+        VK_CHECK(vkd.vkCreateFence(device, &info, nullptr, &fence));
         return fence;
     }
     SemaphoreBuilder& SemaphoreBuilder::set_create_flags(VkSemaphoreCreateFlags flags) {
@@ -81,14 +142,14 @@ namespace bluevk {
     }
     VkSemaphore SemaphoreBuilder::build(VkDevice device) {
         VkSemaphore semaphore;
-        VK_CHECK(vkCreateSemaphore(device, &info, nullptr, &semaphore));
+        VK_CHECK(vkd.vkCreateSemaphore(device, &info, nullptr, &semaphore));
         return semaphore;
     }
-    DescriptorSetLayoutBuilder& DescriptorSetLayoutBuilder::add_binding(uint32_t binding, VkDescriptorType type) {
+    DescriptorSetLayoutBuilder& DescriptorSetLayoutBuilder::add_binding(uint32_t binding, VkDescriptorType type, uint32_t count) {
         bindings.push_back(VkDescriptorSetLayoutBinding{
             .binding = binding,
             .descriptorType = type,
-            .descriptorCount = 1,
+            .descriptorCount = count,
         });
         return *this;
     }
@@ -108,7 +169,7 @@ namespace bluevk {
             .pBindings = bindings.data(),
         };
         VkDescriptorSetLayout layout;
-        VK_CHECK(vkCreateDescriptorSetLayout(device, &info, nullptr, &layout));
+        VK_CHECK(vkd.vkCreateDescriptorSetLayout(device, &info, nullptr, &layout));
         return layout;
     }
     DescriptorSetAllocator& DescriptorSetAllocator::init_pool(VkDevice device, uint32_t maxSets, std::vector<VkDescriptorPoolSize> poolSizes) {
@@ -120,15 +181,15 @@ namespace bluevk {
             .poolSizeCount = (uint32_t)poolSizes.size(),
             .pPoolSizes = poolSizes.data(),
         };
-        VK_CHECK(vkCreateDescriptorPool(device, &info, nullptr, &pool));
+        VK_CHECK(vkd.vkCreateDescriptorPool(device, &info, nullptr, &pool));
         return *this;
     }
     DescriptorSetAllocator& DescriptorSetAllocator::clear(VkDevice device) {
-        vkResetDescriptorPool(device, pool, 0);
+        vkd.vkResetDescriptorPool(device, pool, 0);
         return *this;
     }
     void DescriptorSetAllocator::destroy_pool(VkDevice device) {
-        vkDestroyDescriptorPool(device, pool, nullptr);
+        vkd.vkDestroyDescriptorPool(device, pool, nullptr);
     }
     VkDescriptorSet DescriptorSetAllocator::allocate(VkDevice device, VkDescriptorSetLayout layout) {
         VkDescriptorSetAllocateInfo info{
@@ -139,7 +200,54 @@ namespace bluevk {
             .pSetLayouts = &layout,
         };
         VkDescriptorSet set;
-        VK_CHECK(vkAllocateDescriptorSets(device, &info, &set));
+        VK_CHECK(vkd.vkAllocateDescriptorSets(device, &info, &set));
         return set;
     }
+    DescriptorSetWriter& DescriptorSetWriter::write_image(uint32_t binding, VkImageView view, VkSampler sampler, VkImageLayout layout, VkDescriptorType type, uint32_t arrayElement) {
+        VkDescriptorImageInfo& imageInfo = imageInfos.emplace_back(VkDescriptorImageInfo{
+            .sampler = sampler,
+            .imageView = view,
+            .imageLayout = layout,
+        });
+        writes.push_back(VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = VK_NULL_HANDLE,
+            .dstBinding = binding,
+            .dstArrayElement = arrayElement,
+            .descriptorCount = 1,
+            .descriptorType = type,
+            .pImageInfo = &imageInfo,
+        });
+        return *this;
+    }
+    DescriptorSetWriter& DescriptorSetWriter::write_buffer(uint32_t binding, VkBuffer buffer, VkDeviceSize size, VkDeviceSize offset, VkDescriptorType type) {
+        VkDescriptorBufferInfo& bufferInfo = bufferInfos.emplace_back(VkDescriptorBufferInfo{
+            .buffer = buffer,
+            .offset = offset,
+            .range = size,
+        });
+        writes.push_back(VkWriteDescriptorSet{
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = VK_NULL_HANDLE,
+            .dstBinding = binding,
+            .descriptorCount = 1,
+            .descriptorType = type,
+            .pBufferInfo = &bufferInfo,
+        });
+        return *this;
+    }
+    DescriptorSetWriter& DescriptorSetWriter::clear() {
+        imageInfos.clear();
+        bufferInfos.clear();
+        writes.clear();
+        return *this;
+    }
+    void DescriptorSetWriter::update(VkDevice device, VkDescriptorSet set) {
+        for (VkWriteDescriptorSet& write : writes) {
+            write.dstSet = set;
+        }
+        vkd.vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+    }
 }  // namespace bluevk
@@ -0,0 +1,54 @@
+#include <vk_command_cache.hpp>
+#include <vk_dispatch.hpp>
+
+#include <vk_initializers.hpp>
+
+namespace bluevk {
+    void InputHash::add_bytes(const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        for (size_t i = 0; i < size; i++) {
+            value ^= bytes[i];
+            value *= 1099511628211ull;
+        }
+    }
+
+    void CommandCache::init(VkDevice device, uint32_t queueFamilyIndex) {
+        this->device = device;
+        poolBuilder = CommandPoolBuilder{}.set_queue_family_index(queueFamilyIndex);
+    }
+    void CommandCache::destroy() {
+        for (VkCommandPool pool : pools) {
+            vkd.vkDestroyCommandPool(device, pool, nullptr);
+        }
+        pools.clear();
+        buffers.clear();
+        valid = false;
+    }
+    bool CommandCache::acquire(uint64_t key, uint32_t count) {
+        if (valid && this->key == key && this->count == count) {
+            return false;
+        }
+        while (pools.size() < count) {
+            VkCommandPool pool = poolBuilder.build(device);
+            pools.push_back(pool);
+            buffers.push_back(CommandBufferAllocator{}
+                                  .set_command_pool(pool)
+                                  .set_level(VK_COMMAND_BUFFER_LEVEL_SECONDARY)
+                                  .allocate(device));
+        }
+        this->key = key;
+        this->count = count;
+        valid = true;
+        return true;
+    }
+    VkCommandBuffer CommandCache::begin(uint32_t index, const VkCommandBufferInheritanceInfo &inheritance) {
+        //! Resetting the whole pool hands its memory back, the buffer is the only one allocated from it
+        VK_CHECK(vkd.vkResetCommandPool(device, pools[index], 0));
+
+        //! No one time submit, the buffer is executed every frame until the key changes
+        VkCommandBufferBeginInfo beginInfo = command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+        beginInfo.pInheritanceInfo = &inheritance;
+        VK_CHECK(vkd.vkBeginCommandBuffer(buffers[index], &beginInfo));
+        return buffers[index];
+    }
+}  // namespace bluevk
@@ -0,0 +1,20 @@
+#include <vk_dispatch.hpp>
+
+#include <stdexcept>
+
+namespace bluevk {
+    DeviceDispatch vkd{};
+
+    void DeviceDispatch::load(VkDevice device) {
+#define BLUEVK_LOAD_FUNCTION(name)                                                                           \
+    name = (PFN_##name)vkGetDeviceProcAddr(device, #name);                                                   \
+    if (name == nullptr) {                                                                                   \
+        throw std::runtime_error(fmt::format("[BlueVK]::[ERROR]: Failed to load device function '{}'!", #name)); \
+    }
+        BLUEVK_DEVICE_FUNCTIONS(BLUEVK_LOAD_FUNCTION)
+#undef BLUEVK_LOAD_FUNCTION
+#define BLUEVK_LOAD_OPTIONAL_FUNCTION(name) name = (PFN_##name)vkGetDeviceProcAddr(device, #name);
+        BLUEVK_OPTIONAL_DEVICE_FUNCTIONS(BLUEVK_LOAD_OPTIONAL_FUNCTION)
+#undef BLUEVK_LOAD_OPTIONAL_FUNCTION
+    }
+}  // namespace bluevk
@@ -0,0 +1,219 @@
+#include <vk_downsampler.hpp>
+#include <vk_dispatch.hpp>
+
+#include <algorithm>
+
+#include <vk_buffers.hpp>
+#include <vk_images.hpp>
+#include <vk_pipelines.hpp>
+
+namespace bluevk {
+    static VkExtent2D get_half_extent(VkExtent2D extent, uint32_t times) {
+        for (uint32_t i = 0; i < times; i++) {
+            extent = VkExtent2D{std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u)};
+        }
+        return extent;
+    }
+
+    void Downsampler::init(VkDevice device, VmaAllocator allocator, uint32_t frameCount) {
+        _device = device;
+        _allocator = allocator;
+        _frames.resize(frameCount);
+
+        _sampler = SamplerBuilder{}
+                       .set_filter(VK_FILTER_LINEAR, VK_FILTER_LINEAR)
+                       .set_address_mode(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE)
+                       .build(_device);
+        _descriptorLayout = DescriptorSetLayoutBuilder{}
+                                .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+                                .add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, DOWNSAMPLE_MAX_MIPS)
+                                .add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
+                                .build(_device, VK_SHADER_STAGE_COMPUTE_BIT);
+        _layout = PipelineLayoutBuilder{}
+                      .add_pc_range(VkPushConstantRange{
+                          .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                          .offset = 0,
+                          .size = sizeof(GPUDownsamplePushConstants),
+                      })
+                      .add_set_layout(_descriptorLayout)
+                      .build(_device);
+        auto build_compute = [this](const char *path) {
+            VkShaderModule computeShader = load_shader_module(_device, path);
+            VkPipeline pipeline = ComputePipelineBuilder{}
+                                      .set_layout(_layout)
+                                      .set_shader(computeShader)
+                                      .build(_device);
+            vkd.vkDestroyShaderModule(_device, computeShader, nullptr);
+            return pipeline;
+        };
+        _rgba16fPipeline = build_compute("assets/shaders/downsample.comp.spv");
+        _rgba8Pipeline = build_compute("assets/shaders/downsample.comp.rgba8.spv");
+
+        VmaAllocationCreateInfo allocCreateInfo{
+            .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+        };
+        _counterBuffer.buffer = BufferBuilder{}
+                                    .set_size(DOWNSAMPLE_COUNTER_COUNT * sizeof(uint32_t))
+                                    .set_usage(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                               VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                               VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+                                    .vmaBuild(_allocator, &allocCreateInfo, &_counterBuffer.allocation, &_counterBuffer.info);
+        _countersCleared = false;
+    }
+    void Downsampler::destroy() {
+        for (FrameResources &frame : _frames) {
+            for (VkImageView view : frame.views) {
+                vkd.vkDestroyImageView(_device, view, nullptr);
+            }
+            for (DescriptorSetAllocator &pool : frame.pools) {
+                pool.destroy_pool(_device);
+            }
+        }
+        _frames.clear();
+        vmaDestroyBuffer(_allocator, _counterBuffer.buffer, _counterBuffer.allocation);
+        vkd.vkDestroyPipeline(_device, _rgba16fPipeline, nullptr);
+        vkd.vkDestroyPipeline(_device, _rgba8Pipeline, nullptr);
+        vkd.vkDestroyPipelineLayout(_device, _layout, nullptr);
+        vkd.vkDestroyDescriptorSetLayout(_device, _descriptorLayout, nullptr);
+        vkd.vkDestroySampler(_device, _sampler, nullptr);
+    }
+    void Downsampler::update(VkCommandBuffer cmd, uint32_t frameIndex) {
+        _frameSlot = frameIndex % _frames.size();
+        FrameResources &frame = _frames[_frameSlot];
+        for (VkImageView view : frame.views) {
+            vkd.vkDestroyImageView(_device, view, nullptr);
+        }
+        frame.views.clear();
+        for (DescriptorSetAllocator &pool : frame.pools) {
+            pool.clear(_device);
+        }
+        frame.usedSets = 0;
+        _dispatchCount = 0;
+
+        //! The last workgroup of every dispatch puts its counter back to zero, they only start out cleared once
+        if (!_countersCleared) {
+            vkd.vkCmdFillBuffer(cmd, _counterBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+            memory_barrier(cmd,
+                           VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT);
+            _countersCleared = true;
+        }
+    }
+    bool Downsampler::is_format_supported(VkFormat format) const {
+        return format == VK_FORMAT_R16G16B16A16_SFLOAT || format == VK_FORMAT_R8G8B8A8_UNORM;
+    }
+    void Downsampler::generate_mipmaps(VkCommandBuffer cmd, const BlueVKImage &image, uint32_t baseMipLevel, uint32_t levelCount) {
+        if (levelCount <= 1) {
+            transition_image_mips(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, baseMipLevel, levelCount);
+            return;
+        }
+        transition_image_mips(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, baseMipLevel, 1);
+        transition_image_mips(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, baseMipLevel + 1, levelCount - 1);
+        record_chain(cmd,
+                     create_view(image, baseMipLevel),
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                     get_half_extent(image.extent, baseMipLevel),
+                     image,
+                     baseMipLevel + 1,
+                     levelCount - 1);
+    }
+    void Downsampler::downsample(VkCommandBuffer cmd,
+                                 VkImageView source,
+                                 VkImageLayout sourceLayout,
+                                 VkExtent2D sourceExtent,
+                                 const BlueVKImage &destination) {
+        //! Every level is rewritten, whatever was left outside the written regions is never sampled
+        transition_image_mips(cmd, destination.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, destination.mipLevels);
+        record_chain(cmd, source, sourceLayout, sourceExtent, destination, 0, destination.mipLevels);
+    }
+    void Downsampler::record_chain(VkCommandBuffer cmd,
+                                   VkImageView source,
+                                   VkImageLayout sourceLayout,
+                                   VkExtent2D sourceExtent,
+                                   const BlueVKImage &destination,
+                                   uint32_t firstMip,
+                                   uint32_t levelCount) {
+        uint32_t endMip = firstMip + levelCount;
+        while (true) {
+            uint32_t maxMips = std::max(sourceExtent.width, sourceExtent.height) <= DOWNSAMPLE_MAX_SOURCE_SIZE ? DOWNSAMPLE_MAX_MIPS : DOWNSAMPLE_MAX_MIPS / 2;
+            uint32_t mipCount = std::min(endMip - firstMip, maxMips);
+            dispatch(cmd, source, sourceLayout, sourceExtent, destination, firstMip, mipCount);
+            //! Also waits for the dispatch, the last level it wrote is the next dispatch's source
+            transition_image_mips(cmd, destination.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, firstMip, mipCount);
+            firstMip += mipCount;
+            if (firstMip == endMip) {
+                return;
+            }
+            source = create_view(destination, firstMip - 1);
+            sourceLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            sourceExtent = get_half_extent(sourceExtent, mipCount);
+        }
+    }
+    VkImageView Downsampler::create_view(const BlueVKImage &image, uint32_t mip) {
+        VkImageView view = ImageViewBuilder{}
+                               .set_format(image.format)
+                               .set_image(image.image)
+                               .set_mip_range(mip, 1)
+                               .build(_device);
+        _frames[_frameSlot].views.push_back(view);
+        return view;
+    }
+    VkDescriptorSet Downsampler::allocate_set() {
+        FrameResources &frame = _frames[_frameSlot];
+        uint32_t pool = frame.usedSets / DOWNSAMPLE_SETS_PER_POOL;
+        if (pool == frame.pools.size()) {
+            std::vector<VkDescriptorPoolSize> sizes = {
+                {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = DOWNSAMPLE_SETS_PER_POOL},
+                {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = DOWNSAMPLE_SETS_PER_POOL * (DOWNSAMPLE_MAX_MIPS + 1)},
+            };
+            frame.pools.push_back(DescriptorSetAllocator{}.init_pool(_device, DOWNSAMPLE_SETS_PER_POOL, sizes));
+        }
+        frame.usedSets++;
+        return frame.pools[pool].allocate(_device, _descriptorLayout);
+    }
+    void Downsampler::dispatch(VkCommandBuffer cmd,
+                               VkImageView source,
+                               VkImageLayout sourceLayout,
+                               VkExtent2D sourceExtent,
+                               const BlueVKImage &destination,
+                               uint32_t firstMip,
+                               uint32_t mipCount) {
+        //! Unused array elements repeat the last level, the shader never writes past mipCount
+        std::vector<VkImageView> views(mipCount);
+        for (uint32_t i = 0; i < mipCount; i++) {
+            views[i] = create_view(destination, firstMip + i);
+        }
+        DescriptorSetWriter writer{};
+        writer.write_image(0, source, _sampler, sourceLayout, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        for (uint32_t i = 0; i < DOWNSAMPLE_MAX_MIPS; i++) {
+            writer.write_image(1, views[std::min(i, mipCount - 1)], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, i);
+        }
+        writer.write_image(2, views[std::min(5u, mipCount - 1)], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        VkDescriptorSet set = allocate_set();
+        writer.update(_device, set);
+
+        //! Wrapping around means reusing counters of earlier dispatches, they have to be done with them
+        if (_nextCounter == DOWNSAMPLE_COUNTER_COUNT) {
+            memory_barrier(cmd,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT);
+            _nextCounter = 0;
+        }
+        uint32_t groupsX = (sourceExtent.width + 63) / 64;
+        uint32_t groupsY = (sourceExtent.height + 63) / 64;
+        GPUDownsamplePushConstants pushConstants{
+            .counter = get_buffer_device_address(_device, _counterBuffer.buffer) + _nextCounter * sizeof(uint32_t),
+            .sourceSize = glm::ivec2{sourceExtent.width, sourceExtent.height},
+            .mipCount = mipCount,
+            .groupCount = groupsX * groupsY,
+        };
+        _nextCounter++;
+
+        VkPipeline pipeline = destination.format == VK_FORMAT_R8G8B8A8_UNORM ? _rgba8Pipeline : _rgba16fPipeline;
+        vkd.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkd.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _layout, 0, 1, &set, 0, nullptr);
+        vkd.vkCmdPushConstants(cmd, _layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkd.vkCmdDispatch(cmd, groupsX, groupsY, 1);
+        _dispatchCount++;
+    }
+}  // namespace bluevk
@@ -1,8 +1,13 @@
 #include <vk_images.hpp>
+#include <vk_dispatch.hpp>
 
 namespace bluevk {
     void transition_image(VkCommandBuffer cmd, VkImage image, VkImageLayout currentLayout, VkImageLayout newLayout) {
-        VkImageAspectFlags aspectMask = (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
+        //! Either side may be the depth layout, depth images are also copied from TRANSFER_SRC_OPTIMAL
+        auto isDepthLayout = [](VkImageLayout layout) {
+            return layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+        };
+        VkImageAspectFlags aspectMask = (isDepthLayout(newLayout) || isDepthLayout(currentLayout))
                                             ? VK_IMAGE_ASPECT_DEPTH_BIT
                                             : VK_IMAGE_ASPECT_COLOR_BIT;
 
@@ -26,7 +31,36 @@ namespace bluevk {
                                  .pNext = nullptr,
                                  .imageMemoryBarrierCount = 1,
                                  .pImageMemoryBarriers = &imageBarrier};
-        vkCmdPipelineBarrier2(cmd, &depInfo);
+        vkd.vkCmdPipelineBarrier2(cmd, &depInfo);
+    }
+
+    void transition_image_mips(VkCommandBuffer cmd,
+                               VkImage image,
+                               VkImageLayout currentLayout,
+                               VkImageLayout newLayout,
+                               uint32_t baseMipLevel,
+                               uint32_t levelCount) {
+        VkImageMemoryBarrier2 imageBarrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                           .pNext = nullptr,
+                                           .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                           .srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+                                           .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                           .dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT,
+                                           .oldLayout = currentLayout,
+                                           .newLayout = newLayout,
+                                           .image = image,
+                                           .subresourceRange = VkImageSubresourceRange{
+                                               .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                               .baseMipLevel = baseMipLevel,
+                                               .levelCount = levelCount,
+                                               .baseArrayLayer = 0,
+                                               .layerCount = VK_REMAINING_ARRAY_LAYERS,
+                                           }};
+        VkDependencyInfo depInfo{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                 .pNext = nullptr,
+                                 .imageMemoryBarrierCount = 1,
+                                 .pImageMemoryBarriers = &imageBarrier};
+        vkd.vkCmdPipelineBarrier2(cmd, &depInfo);
     }
 
     void copy_image_to_image(VkCommandBuffer cmd,
@@ -60,6 +94,126 @@ namespace bluevk {
                                   .regionCount = 1,
                                   .pRegions = &blitRegion,
                                   .filter = VK_FILTER_LINEAR};
-        vkCmdBlitImage2(cmd, &blitInfo);
+        vkd.vkCmdBlitImage2(cmd, &blitInfo);
+    }
+
+    void copy_image_mips(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D extent, uint32_t levelCount) {
+        std::vector<VkImageCopy2> regions(levelCount);
+        for (uint32_t mip = 0; mip < levelCount; mip++) {
+            VkImageSubresourceLayers subresource{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                                 .mipLevel = mip,
+                                                 .baseArrayLayer = 0,
+                                                 .layerCount = 1};
+            regions[mip] = VkImageCopy2{.sType = VK_STRUCTURE_TYPE_IMAGE_COPY_2,
+                                        .pNext = nullptr,
+                                        .srcSubresource = subresource,
+                                        .srcOffset = VkOffset3D{0, 0, 0},
+                                        .dstSubresource = subresource,
+                                        .dstOffset = VkOffset3D{0, 0, 0},
+                                        .extent = VkExtent3D{std::max(extent.width >> mip, 1u), std::max(extent.height >> mip, 1u), 1}};
+        }
+        VkCopyImageInfo2 copyInfo{.sType = VK_STRUCTURE_TYPE_COPY_IMAGE_INFO_2,
+                                  .pNext = nullptr,
+                                  .srcImage = source,
+                                  .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                  .dstImage = destination,
+                                  .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  .regionCount = levelCount,
+                                  .pRegions = regions.data()};
+        vkd.vkCmdCopyImage2(cmd, &copyInfo);
+    }
+
+    void copy_buffer_to_image(VkCommandBuffer cmd,
+                              VkBuffer source,
+                              VkImage destination,
+                              VkExtent2D extent,
+                              uint32_t mipLevel,
+                              VkDeviceSize bufferOffset) {
+        VkBufferImageCopy2 copyRegion{.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2,
+                                      .pNext = nullptr,
+                                      .bufferOffset = bufferOffset,
+                                      .bufferRowLength = 0,
+                                      .bufferImageHeight = 0,
+                                      .imageSubresource = VkImageSubresourceLayers{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                                                                   .mipLevel = mipLevel,
+                                                                                   .baseArrayLayer = 0,
+                                                                                   .layerCount = 1},
+                                      .imageOffset = VkOffset3D{0, 0, 0},
+                                      .imageExtent = VkExtent3D{extent.width, extent.height, 1}};
+        VkCopyBufferToImageInfo2 copyInfo{.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2,
+                                          .pNext = nullptr,
+                                          .srcBuffer = source,
+                                          .dstImage = destination,
+                                          .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                          .regionCount = 1,
+                                          .pRegions = &copyRegion};
+        vkd.vkCmdCopyBufferToImage2(cmd, &copyInfo);
+    }
+
+    void copy_image_to_buffer(VkCommandBuffer cmd,
+                              VkImage source,
+                              VkBuffer destination,
+                              VkOffset2D offset,
+                              VkExtent2D extent,
+                              VkImageAspectFlags aspect) {
+        VkBufferImageCopy2 copyRegion{.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2,
+                                      .pNext = nullptr,
+                                      .bufferOffset = 0,
+                                      .bufferRowLength = 0,
+                                      .bufferImageHeight = 0,
+                                      .imageSubresource = VkImageSubresourceLayers{.aspectMask = aspect,
+                                                                                   .mipLevel = 0,
+                                                                                   .baseArrayLayer = 0,
+                                                                                   .layerCount = 1},
+                                      .imageOffset = VkOffset3D{offset.x, offset.y, 0},
+                                      .imageExtent = VkExtent3D{extent.width, extent.height, 1}};
+        VkCopyImageToBufferInfo2 copyInfo{.sType = VK_STRUCTURE_TYPE_COPY_IMAGE_TO_BUFFER_INFO_2,
+                                          .pNext = nullptr,
+                                          .srcImage = source,
+                                          .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                          .dstBuffer = destination,
+                                          .regionCount = 1,
+                                          .pRegions = &copyRegion};
+        vkd.vkCmdCopyImageToBuffer2(cmd, &copyInfo);
+    }
+
+    void generate_mipmaps(VkCommandBuffer cmd, VkImage image, VkExtent2D baseExtent, uint32_t baseMipLevel, uint32_t levelCount) {
+        VkExtent2D mipExtent = baseExtent;
+        for (uint32_t mip = baseMipLevel; mip + 1 < baseMipLevel + levelCount; mip++) {
+            VkExtent2D nextExtent{std::max(mipExtent.width / 2, 1u), std::max(mipExtent.height / 2, 1u)};
+
+            transition_image_mips(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mip, 1);
+
+            VkImageBlit2 blitRegion{.sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2,
+                                    .pNext = nullptr,
+                                    .srcSubresource = VkImageSubresourceLayers{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                                                               .mipLevel = mip,
+                                                                               .baseArrayLayer = 0,
+                                                                               .layerCount = 1},
+                                    .dstSubresource = VkImageSubresourceLayers{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                                                               .mipLevel = mip + 1,
+                                                                               .baseArrayLayer = 0,
+                                                                               .layerCount = 1}};
+            blitRegion.srcOffsets[1] = VkOffset3D{.x = (int32_t)mipExtent.width,
+                                                  .y = (int32_t)mipExtent.height,
+                                                  .z = 1};
+            blitRegion.dstOffsets[1] = VkOffset3D{.x = (int32_t)nextExtent.width,
+                                                  .y = (int32_t)nextExtent.height,
+                                                  .z = 1};
+            VkBlitImageInfo2 blitInfo{.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2,
+                                      .pNext = nullptr,
+                                      .srcImage = image,
+                                      .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                      .dstImage = image,
+                                      .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                      .regionCount = 1,
+                                      .pRegions = &blitRegion,
+                                      .filter = VK_FILTER_LINEAR};
+            vkd.vkCmdBlitImage2(cmd, &blitInfo);
+
+            transition_image_mips(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mip, 1);
+            mipExtent = nextExtent;
+        }
+        transition_image_mips(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, baseMipLevel + levelCount - 1, 1);
     }
-}  // namespace bluevk
\ No newline at end of file
+}  // namespace bluevk
@@ -38,6 +38,31 @@ namespace bluevk {
                              .signalSemaphoreInfoCount = signalSemaphoreInfoCount,
                              .pSignalSemaphoreInfos = signalSemaphoreInfo};
     }
+    VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info(const VkFormat* colorFormat, VkFormat depthFormat) {
+        return VkCommandBufferInheritanceRenderingInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+            .viewMask = 0,
+            .colorAttachmentCount = colorFormat ? 1u : 0u,
+            .pColorAttachmentFormats = colorFormat,
+            .depthAttachmentFormat = depthFormat,
+            .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        };
+    }
+    VkCommandBufferInheritanceInfo inheritance_info(VkCommandBufferInheritanceRenderingInfo* renderingInfo) {
+        return VkCommandBufferInheritanceInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .pNext = renderingInfo,
+            .renderPass = VK_NULL_HANDLE,
+            .subpass = 0,
+            .framebuffer = VK_NULL_HANDLE,
+            .occlusionQueryEnable = VK_FALSE,
+            .queryFlags = 0,
+            .pipelineStatistics = 0,
+        };
+    }
     VkImageSubresourceRange image_subresource_range(VkImageAspectFlags aspectMask) {
         return VkImageSubresourceRange{
             .aspectMask = aspectMask,
@@ -61,13 +86,13 @@ namespace bluevk {
         }
         return info;
     }
-    VkRenderingAttachmentInfo depth_attachment_info(VkImageView view, VkImageLayout layout) {
+    VkRenderingAttachmentInfo depth_attachment_info(VkImageView view, VkImageLayout layout, VkAttachmentLoadOp loadOp) {
         VkRenderingAttachmentInfo info{
             .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
             .pNext = nullptr,
             .imageView = view,
             .imageLayout = layout,
-            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .loadOp = loadOp,
             .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
         };
         info.clearValue.depthStencil.depth = 0.0f;
@@ -79,7 +104,7 @@ namespace bluevk {
             .pNext = nullptr,
             .renderArea = VkRect2D{VkOffset2D{0, 0}, renderExtent},
             .layerCount = 1,
-            .colorAttachmentCount = 1,
+            .colorAttachmentCount = colorAttachment ? 1u : 0u,
             .pColorAttachments = colorAttachment,
             .pDepthAttachment = depthAttachment,
             .pStencilAttachment = nullptr,
@@ -0,0 +1,198 @@
+#include <vk_memory.hpp>
+
+#include <imgui.h>
+
+namespace bluevk {
+    static constexpr double MB = 1024.0 * 1024.0;
+
+    static float get_fragmentation(const VmaDetailedStatistics &stats) {
+        //! 0 when all free space is one range, approaching 1 as it gets split into many small ranges
+        VkDeviceSize unusedBytes = stats.statistics.blockBytes - stats.statistics.allocationBytes;
+        if (unusedBytes == 0 || stats.unusedRangeCount == 0) {
+            return 0.0f;
+        }
+        return 1.0f - (float)((double)stats.unusedRangeSizeMax / (double)unusedBytes);
+    }
+
+    void MemoryTracker::init(VkPhysicalDevice physicalDevice, VmaAllocator allocator, uint32_t frameCount, bool budgetExtension) {
+        this->allocator = allocator;
+        this->frameCount = frameCount;
+        this->budgetExtension = budgetExtension;
+
+        VkPhysicalDeviceMemoryProperties properties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &properties);
+        heapFlags.resize(properties.memoryHeapCount);
+        for (uint32_t heap = 0; heap < properties.memoryHeapCount; heap++) {
+            heapFlags[heap] = properties.memoryHeaps[heap].flags;
+        }
+        budgets.resize(properties.memoryHeapCount);
+        vmaCalculateStatistics(allocator, &statistics);
+        fragmentation = get_fragmentation(statistics.total);
+    }
+    void MemoryTracker::destroy() {
+        //! The device is idle at this point, whatever is in flight can be released right away
+        if (passInFlight) {
+            end_pass();
+        }
+        if (defragmentation != VK_NULL_HANDLE) {
+            vmaEndDefragmentation(allocator, defragmentation, nullptr);
+            defragmentation = VK_NULL_HANDLE;
+        }
+    }
+    void MemoryTracker::update(VkCommandBuffer cmd, uint64_t frameNumber) {
+        vmaSetCurrentFrameIndex(allocator, (uint32_t)frameNumber);
+        vmaGetHeapBudgets(allocator, budgets.data());
+
+        if (frameNumber >= statisticsFrame + STATISTICS_INTERVAL) {
+            statisticsFrame = frameNumber;
+            vmaCalculateStatistics(allocator, &statistics);
+            fragmentation = get_fragmentation(statistics.total);
+
+            bool cooledDown = lastDefragmentationFrame == 0 || frameNumber >= lastDefragmentationFrame + DEFRAGMENTATION_COOLDOWN;
+            if (autoDefragment && cooledDown && fragmentation > defragmentThreshold) {
+                defragmentRequested = true;
+            }
+        }
+
+        if (passInFlight) {
+            //! Frames recorded before the copies may still read the old resources
+            if (frameNumber < passFrame + frameCount) {
+                return;
+            }
+            if (end_pass() == VK_SUCCESS) {
+                finish_defragmentation(frameNumber);
+                return;
+            }
+        }
+
+        if (defragmentation == VK_NULL_HANDLE) {
+            if (!defragmentRequested) {
+                return;
+            }
+            VmaDefragmentationInfo info{
+                .flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FAST_BIT,
+                .pool = VK_NULL_HANDLE,
+                .maxBytesPerPass = maxBytesPerPass,
+                .maxAllocationsPerPass = maxAllocationsPerPass,
+            };
+            VK_CHECK(vmaBeginDefragmentation(allocator, &info, &defragmentation));
+            defragmentationRuns++;
+        }
+        begin_pass(cmd, frameNumber);
+    }
+    void MemoryTracker::begin_pass(VkCommandBuffer cmd, uint64_t frameNumber) {
+        VkResult result = vmaBeginDefragmentationPass(allocator, defragmentation, &pass);
+        if (result == VK_SUCCESS) {
+            finish_defragmentation(frameNumber);
+            return;
+        }
+
+        for (uint32_t i = 0; i < pass.moveCount; i++) {
+            VmaDefragmentationMove &move = pass.pMoves[i];
+            VmaAllocationInfo info;
+            vmaGetAllocationInfo(allocator, move.srcAllocation, &info);
+            MovableResource *resource = static_cast<MovableResource *>(info.pUserData);
+
+            std::function<void()> release{};
+            if (resource != nullptr) {
+                release = resource->move(cmd, move.dstTmpAllocation);
+            }
+            if (release) {
+                passReleases.push_back(std::move(release));
+            } else {
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+            }
+        }
+        passInFlight = true;
+        passFrame = frameNumber;
+    }
+    VkResult MemoryTracker::end_pass() {
+        //! Old resources have to be gone before VMA frees the memory they were bound to
+        for (std::function<void()> &release : passReleases) {
+            release();
+        }
+        passReleases.clear();
+        passInFlight = false;
+        defragmentationPasses++;
+        return vmaEndDefragmentationPass(allocator, defragmentation, &pass);
+    }
+    void MemoryTracker::finish_defragmentation(uint64_t frameNumber) {
+        VmaDefragmentationStats stats{};
+        vmaEndDefragmentation(allocator, defragmentation, &stats);
+        defragmentation = VK_NULL_HANDLE;
+        defragmentRequested = false;
+        lastDefragmentationFrame = std::max<uint64_t>(frameNumber, 1);
+
+        defragmentationTotals.bytesMoved += stats.bytesMoved;
+        defragmentationTotals.bytesFreed += stats.bytesFreed;
+        defragmentationTotals.allocationsMoved += stats.allocationsMoved;
+        defragmentationTotals.deviceMemoryBlocksFreed += stats.deviceMemoryBlocksFreed;
+
+        //! Refresh right away so the finished run isn't triggered again by stale numbers
+        statisticsFrame = frameNumber;
+        vmaCalculateStatistics(allocator, &statistics);
+        fragmentation = get_fragmentation(statistics.total);
+    }
+    void MemoryTracker::report(Profiler &profiler) const {
+        VkDeviceSize usage = 0, budget = 0;
+        for (uint32_t heap = 0; heap < budgets.size(); heap++) {
+            if (heapFlags[heap] & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                usage += budgets[heap].usage;
+                budget += budgets[heap].budget;
+            }
+        }
+        profiler.set_counter("VRAM Usage (MB)", usage / MB);
+        profiler.set_counter("VRAM Budget (MB)", budget / MB);
+        profiler.set_counter("VMA Allocations", statistics.total.statistics.allocationCount);
+        profiler.set_counter("VMA Blocks", statistics.total.statistics.blockCount);
+        profiler.set_counter("VMA Fragmentation (%)", fragmentation * 100.0);
+    }
+    void MemoryTracker::draw_imgui() {
+        if (ImGui::Begin("Memory")) {
+            if (!budgetExtension) {
+                ImGui::TextUnformatted("VK_EXT_memory_budget unavailable, budgets are estimates");
+            }
+            for (uint32_t heap = 0; heap < budgets.size(); heap++) {
+                const VmaBudget &budget = budgets[heap];
+                ImGui::Text("Heap %u%s: %.1f / %.1f MB, %u blocks, %u allocations",
+                            heap, (heapFlags[heap] & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "",
+                            budget.usage / MB, budget.budget / MB,
+                            budget.statistics.blockCount, budget.statistics.allocationCount);
+                ImGui::ProgressBar(budget.budget > 0 ? (float)((double)budget.usage / (double)budget.budget) : 0.0f);
+            }
+            ImGui::Separator();
+            const VmaStatistics &total = statistics.total.statistics;
+            ImGui::Text("Allocated: %.1f MB in %.1f MB of blocks", total.allocationBytes / MB, total.blockBytes / MB);
+            ImGui::Text("Free ranges: %u, largest %.2f MB", statistics.total.unusedRangeCount,
+                        statistics.total.unusedRangeCount > 0 ? statistics.total.unusedRangeSizeMax / MB : 0.0);
+            ImGui::Text("Fragmentation: %.1f%%", fragmentation * 100.0f);
+            ImGui::Separator();
+            ImGui::Checkbox("Auto Defragment", &autoDefragment);
+            ImGui::SliderFloat("Threshold", &defragmentThreshold, 0.05f, 0.95f);
+            ImGui::BeginDisabled(defragmentation != VK_NULL_HANDLE);
+            if (ImGui::Button("Defragment")) {
+                defragmentRequested = true;
+            }
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+            ImGui::TextUnformatted(defragmentation != VK_NULL_HANDLE ? "running" : "idle");
+            ImGui::Text("Runs: %u, passes: %u, moved %.2f MB in %u allocations, freed %u blocks",
+                        defragmentationRuns, defragmentationPasses,
+                        defragmentationTotals.bytesMoved / MB, defragmentationTotals.allocationsMoved,
+                        defragmentationTotals.deviceMemoryBlocksFreed);
+        }
+        ImGui::End();
+    }
+    void MemoryTracker::print_report() {
+        fmt::println("[BlueVK]::[MEMORY]: Heaps (usage / budget):");
+        for (uint32_t heap = 0; heap < budgets.size(); heap++) {
+            fmt::println("    Heap {:<2}{:<16} {:>10.1f} / {:>10.1f} MB  {:>6} blocks  {:>8} allocations",
+                         heap, (heapFlags[heap] & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "",
+                         budgets[heap].usage / MB, budgets[heap].budget / MB,
+                         budgets[heap].statistics.blockCount, budgets[heap].statistics.allocationCount);
+        }
+        fmt::println("[BlueVK]::[MEMORY]: Fragmentation {:.1f}%, {} defragmentation runs ({} passes) moved {:.2f} MB, freed {} blocks",
+                     fragmentation * 100.0f, defragmentationRuns, defragmentationPasses,
+                     defragmentationTotals.bytesMoved / MB, defragmentationTotals.deviceMemoryBlocksFreed);
+    }
+}  // namespace bluevk
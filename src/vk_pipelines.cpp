@@ -1,4 +1,5 @@
 #include <vk_pipelines.hpp>
+#include <vk_dispatch.hpp>
 #include <vk_initializers.hpp>
 
 namespace bluevk {
@@ -24,7 +25,7 @@ namespace bluevk {
         };
 
         VkShaderModule shader;
-        VK_CHECK(vkCreateShaderModule(device, &info, nullptr, &shader));
+        VK_CHECK(vkd.vkCreateShaderModule(device, &info, nullptr, &shader));
         return shader;
     }
     PipelineLayoutBuilder& PipelineLayoutBuilder::add_set_layout(VkDescriptorSetLayout setLayout) {
@@ -52,7 +53,7 @@ namespace bluevk {
             .pPushConstantRanges = pcRanges.data(),
         };
         VkPipelineLayout layout;
-        VK_CHECK(vkCreatePipelineLayout(device, &info, nullptr, &layout));
+        VK_CHECK(vkd.vkCreatePipelineLayout(device, &info, nullptr, &layout));
         return layout;
     }
     ComputePipelineBuilder& ComputePipelineBuilder::set_layout(VkPipelineLayout layout) {
@@ -71,7 +72,7 @@ namespace bluevk {
     }
     VkPipeline ComputePipelineBuilder::build(VkDevice device) {
         VkPipeline compute;
-        VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, &compute));
+        VK_CHECK(vkd.vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &info, nullptr, &compute));
         return compute;
     }
 
@@ -95,6 +96,12 @@ namespace bluevk {
         shaderStages.push_back(pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
         return *this;
     }
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::set_vertex_shader(VkShaderModule vertexShader) {
+        //! Depth-only pipelines don't need a fragment stage
+        shaderStages.clear();
+        shaderStages.push_back(pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, vertexShader));
+        return *this;
+    }
     GraphicsPipelineBuilder& GraphicsPipelineBuilder::set_input_topology(VkPrimitiveTopology topology) {
         inputAssembly.topology = topology;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
@@ -165,6 +172,13 @@ namespace bluevk {
         depthStencil.maxDepthBounds = 1.f;
         return *this;
     }
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::enable_depth_bias(float constantFactor, float slopeFactor) {
+        rasterizer.depthBiasEnable = VK_TRUE;
+        rasterizer.depthBiasConstantFactor = constantFactor;
+        rasterizer.depthBiasSlopeFactor = slopeFactor;
+        rasterizer.depthBiasClamp = 0.0f;
+        return *this;
+    }
     GraphicsPipelineBuilder& GraphicsPipelineBuilder::enable_blending_additive() {
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
         colorBlendAttachment.blendEnable = VK_TRUE;
@@ -187,6 +201,17 @@ namespace bluevk {
         colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
         return *this;
     }
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::enable_blending_premultiplied() {
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable = VK_TRUE;
+        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+        return *this;
+    }
     VkPipeline GraphicsPipelineBuilder::build(VkDevice device) {
         //! Due to dynamic rendering, we don't have to specify the viewport and scissor
         VkPipelineViewportStateCreateInfo viewportState{.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
@@ -197,7 +222,7 @@ namespace bluevk {
                                                           .pNext = nullptr,
                                                           .logicOpEnable = VK_FALSE,
                                                           .logicOp = VK_LOGIC_OP_COPY,
-                                                          .attachmentCount = 1,
+                                                          .attachmentCount = renderInfo.colorAttachmentCount,
                                                           .pAttachments = &colorBlendAttachment};
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
         std::vector<VkDynamicState> states{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
@@ -219,7 +244,7 @@ namespace bluevk {
                                                   .pDynamicState = &dynamicInfo,
                                                   .layout = pipelineLayout};
         VkPipeline pipeline;
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        if (vkd.vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
             throw std::runtime_error(fmt::format("[BlueVK]::[ERROR]: Failed to create graphics pipeline!\n"));
         }
         return pipeline;
@@ -0,0 +1,158 @@
+#include <vk_profiler.hpp>
+#include <vk_dispatch.hpp>
+
+#include <imgui.h>
+
+namespace bluevk {
+    static void record_sample(std::vector<Profiler::Entry> &entries, const std::string &name, double value) {
+        for (Profiler::Entry &entry : entries) {
+            if (entry.name == name) {
+                entry.last = value;
+                entry.total += value;
+                entry.samples++;
+                return;
+            }
+        }
+        entries.push_back(Profiler::Entry{.name = name, .last = value, .total = value, .samples = 1});
+    }
+
+    void Profiler::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameCount) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        timestampPeriod = properties.limits.timestampPeriod;
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+        uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+        //! Timestamps wrap at validBits, the upper bits of the results are undefined
+        timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+        gpuTimings = properties.limits.timestampComputeAndGraphics && validBits > 0;
+        if (!gpuTimings) {
+            fmt::println("[BlueVK]::[WARNING]: Timestamp queries are not supported on the graphics queue, GPU timings are disabled");
+            return;
+        }
+
+        VkQueryPoolCreateInfo info{
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = nullptr,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = MAX_QUERIES_PER_FRAME,
+        };
+        frames.resize(frameCount);
+        for (FrameQueries &frame : frames) {
+            VK_CHECK(vkd.vkCreateQueryPool(device, &info, nullptr, &frame.pool));
+            frame.queryCount = 0;
+        }
+    }
+    void Profiler::destroy(VkDevice device) {
+        for (FrameQueries &frame : frames) {
+            vkd.vkDestroyQueryPool(device, frame.pool, nullptr);
+        }
+        frames.clear();
+        current = nullptr;
+    }
+    void Profiler::begin_frame(VkDevice device, VkCommandBuffer cmd, uint32_t frameIndex) {
+        if (!gpuTimings) {
+            return;
+        }
+        current = &frames[frameIndex % frames.size()];
+
+        //! The frame's fence has already been waited on, so the previous results are available
+        if (current->queryCount > 0) {
+            std::vector<uint64_t> results(current->queryCount);
+            VkResult result = vkd.vkGetQueryPoolResults(device, current->pool, 0, current->queryCount,
+                                                    results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t),
+                                                    VK_QUERY_RESULT_64_BIT);
+            if (result == VK_SUCCESS) {
+                std::lock_guard<std::mutex> lock{entryMutex};
+                for (const auto &[name, query] : current->scopes) {
+                    uint64_t ticks = (results[query + 1] - results[query]) & timestampMask;
+                    double milliseconds = (double)ticks * timestampPeriod / 1000000.0;
+                    record_sample(timings, name, milliseconds);
+                }
+            }
+        }
+
+        current->queryCount = 0;
+        current->scopes.clear();
+        current->openScopes.clear();
+        vkd.vkCmdResetQueryPool(cmd, current->pool, 0, MAX_QUERIES_PER_FRAME);
+    }
+    void Profiler::begin_scope(VkCommandBuffer cmd, const std::string &name) {
+#if BLUEVK_DEBUG_TOOLS
+        if (debugLabels) {
+            VkDebugUtilsLabelEXT label{
+                .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
+                .pLabelName = name.c_str(),
+            };
+            vkd.vkCmdBeginDebugUtilsLabelEXT(cmd, &label);
+        }
+#endif
+        if (current == nullptr || current->queryCount + 2 > MAX_QUERIES_PER_FRAME) {
+            return;
+        }
+        uint32_t query = current->queryCount;
+        current->queryCount += 2;
+        current->scopes.emplace_back(name, query);
+        current->openScopes.push_back(query);
+        vkd.vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, current->pool, query);
+    }
+    void Profiler::end_scope(VkCommandBuffer cmd) {
+#if BLUEVK_DEBUG_TOOLS
+        if (debugLabels) {
+            vkd.vkCmdEndDebugUtilsLabelEXT(cmd);
+        }
+#endif
+        if (current == nullptr || current->openScopes.empty()) {
+            return;
+        }
+        uint32_t query = current->openScopes.back();
+        current->openScopes.pop_back();
+        vkd.vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, current->pool, query + 1);
+    }
+    void Profiler::set_timing(const std::string &name, double milliseconds) {
+        std::lock_guard<std::mutex> lock{entryMutex};
+        record_sample(timings, name, milliseconds);
+    }
+    void Profiler::set_counter(const std::string &name, double value) {
+        std::lock_guard<std::mutex> lock{entryMutex};
+        record_sample(counters, name, value);
+    }
+    double Profiler::get_average(const std::string &name) {
+        std::lock_guard<std::mutex> lock{entryMutex};
+        for (const std::vector<Entry> *entries : {&timings, &counters}) {
+            for (const Entry &entry : *entries) {
+                if (entry.name == name) {
+                    return entry.samples ? entry.total / entry.samples : 0.0;
+                }
+            }
+        }
+        return 0.0;
+    }
+    void Profiler::draw_imgui() {
+        std::lock_guard<std::mutex> lock{entryMutex};
+        if (ImGui::Begin("Profiler")) {
+            for (const Entry &entry : timings) {
+                ImGui::Text("%-32s %8.3f ms", entry.name.c_str(), entry.last);
+            }
+            ImGui::Separator();
+            for (const Entry &entry : counters) {
+                ImGui::Text("%-32s %12.0f", entry.name.c_str(), entry.last);
+            }
+        }
+        ImGui::End();
+    }
+    void Profiler::print_report() {
+        std::lock_guard<std::mutex> lock{entryMutex};
+        fmt::println("[BlueVK]::[PROFILER]: Timings (average over frames):");
+        for (const Entry &entry : timings) {
+            fmt::println("    {:<40} {:>10.3f} ms  ({} samples)", entry.name, entry.total / entry.samples, entry.samples);
+        }
+        fmt::println("[BlueVK]::[PROFILER]: Counters (average over frames):");
+        for (const Entry &entry : counters) {
+            fmt::println("    {:<40} {:>14.1f}  ({} samples)", entry.name, entry.total / entry.samples, entry.samples);
+        }
+    }
+}  // namespace bluevk
@@ -0,0 +1,283 @@
+#include <vk_readback.hpp>
+#include <vk_dispatch.hpp>
+
+#include <fstream>
+#include <stdexcept>
+
+#include <glm/gtc/packing.hpp>
+
+#include <vk_builders.hpp>
+#include <vk_buffers.hpp>
+#include <vk_images.hpp>
+
+namespace bluevk {
+    static VkDeviceSize get_texel_size(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+                return 16;
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+                return 8;
+            case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+            case VK_FORMAT_R32_SFLOAT:
+            case VK_FORMAT_D32_SFLOAT:
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+                return 4;
+            default:
+                throw std::runtime_error(fmt::format("[BlueVK]::[ERROR]: Can't read back images of format {}!", string_VkFormat(format)));
+        }
+    }
+    //! RGB of texel i as floats, false for formats that aren't stored as float maps
+    static bool read_float_texel(const ReadbackResult &result, size_t i, float *rgb) {
+        switch (result.format) {
+            case VK_FORMAT_R32G32B32A32_SFLOAT: {
+                const float *texel = (const float *)result.data + i * 4;
+                rgb[0] = texel[0];
+                rgb[1] = texel[1];
+                rgb[2] = texel[2];
+            } break;
+            case VK_FORMAT_R16G16B16A16_SFLOAT: {
+                const uint16_t *texel = (const uint16_t *)result.data + i * 4;
+                rgb[0] = glm::unpackHalf1x16(texel[0]);
+                rgb[1] = glm::unpackHalf1x16(texel[1]);
+                rgb[2] = glm::unpackHalf1x16(texel[2]);
+            } break;
+            case VK_FORMAT_B10G11R11_UFLOAT_PACK32: {
+                //! R is in the low bits, the same order glm packs x, y, z in
+                glm::vec3 texel = glm::unpackF2x11_1x10(((const uint32_t *)result.data)[i]);
+                rgb[0] = texel.r;
+                rgb[1] = texel.g;
+                rgb[2] = texel.b;
+            } break;
+            case VK_FORMAT_R32_SFLOAT:
+            case VK_FORMAT_D32_SFLOAT:
+                rgb[0] = rgb[1] = rgb[2] = ((const float *)result.data)[i];
+                break;
+            default:
+                return false;
+        }
+        return true;
+    }
+    static void write_capture(const std::string &path, const ReadbackResult &result) {
+        uint32_t width = result.extent.width;
+        uint32_t height = result.extent.height;
+        float rgb[3];
+        if (read_float_texel(result, 0, rgb)) {
+            //! Portable float map, little endian and stored bottom row first
+            std::ofstream file{path + ".pfm", std::ios::binary};
+            file << fmt::format("PF\n{} {}\n-1.0\n", width, height);
+            std::vector<float> row(width * 3);
+            for (uint32_t y = height; y-- > 0;) {
+                for (uint32_t x = 0; x < width; x++) {
+                    read_float_texel(result, (size_t)y * width + x, &row[x * 3]);
+                }
+                file.write((const char *)row.data(), row.size() * sizeof(float));
+            }
+        } else if (result.format == VK_FORMAT_R8G8B8A8_UNORM || result.format == VK_FORMAT_R8G8B8A8_SRGB ||
+                   result.format == VK_FORMAT_B8G8R8A8_UNORM || result.format == VK_FORMAT_B8G8R8A8_SRGB) {
+            bool bgra = result.format == VK_FORMAT_B8G8R8A8_UNORM || result.format == VK_FORMAT_B8G8R8A8_SRGB;
+            std::ofstream file{path + ".ppm", std::ios::binary};
+            file << fmt::format("P6\n{} {}\n255\n", width, height);
+            std::vector<uint8_t> row(width * 3);
+            for (uint32_t y = 0; y < height; y++) {
+                const uint8_t *texels = (const uint8_t *)result.data + (size_t)y * width * 4;
+                for (uint32_t x = 0; x < width; x++) {
+                    row[x * 3 + 0] = texels[x * 4 + (bgra ? 2 : 0)];
+                    row[x * 3 + 1] = texels[x * 4 + 1];
+                    row[x * 3 + 2] = texels[x * 4 + (bgra ? 0 : 2)];
+                }
+                file.write((const char *)row.data(), row.size());
+            }
+        } else {
+            std::ofstream file{path + ".bin", std::ios::binary};
+            file.write((const char *)result.data, result.size);
+        }
+    }
+
+    void ReadbackQueue::init(VkDevice device, VmaAllocator allocator, uint32_t slotCount, JobSystem *jobs) {
+        _device = device;
+        _allocator = allocator;
+        _jobs = jobs;
+        //! Never resized, slots are referenced by writer jobs
+        _slots = std::vector<Slot>(slotCount);
+    }
+    void ReadbackQueue::destroy() {
+        _jobs->wait(_writeJobs);
+        for (Slot &slot : _slots) {
+            if (slot.capacity > 0) {
+                vmaDestroyBuffer(_allocator, slot.buffer.buffer, slot.buffer.allocation);
+            }
+        }
+        _slots.clear();
+    }
+    bool ReadbackQueue::read_image(VkCommandBuffer cmd,
+                                   const BlueVKImage &image,
+                                   VkImageLayout layout,
+                                   VkOffset2D offset,
+                                   VkExtent2D extent,
+                                   ReadbackCallback &&callback) {
+        Slot *slot = record_image_copy(cmd, image, layout, offset, extent);
+        if (slot == nullptr) {
+            return false;
+        }
+        slot->callback = std::move(callback);
+        return true;
+    }
+    bool ReadbackQueue::read_buffer(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, ReadbackCallback &&callback) {
+        Slot *slot = acquire(size);
+        if (slot == nullptr) {
+            return false;
+        }
+        slot->result.format = VK_FORMAT_UNDEFINED;
+        slot->result.extent = VkExtent2D{0, 0};
+        slot->callback = std::move(callback);
+
+        //! Whatever wrote the buffer earlier in the frame has to finish first
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                       VK_ACCESS_2_MEMORY_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                       VK_ACCESS_2_TRANSFER_READ_BIT);
+        copy_buffer_to_buffer(cmd, buffer, slot->buffer.buffer, size, offset, 0);
+        record_host_barrier(cmd);
+        return true;
+    }
+    bool ReadbackQueue::capture_image(VkCommandBuffer cmd,
+                                      const BlueVKImage &image,
+                                      VkImageLayout layout,
+                                      VkExtent2D extent,
+                                      const std::string &path) {
+        Slot *slot = record_image_copy(cmd, image, layout, VkOffset2D{0, 0}, extent);
+        if (slot == nullptr) {
+            return false;
+        }
+        slot->path = path;
+        return true;
+    }
+    void ReadbackQueue::update(uint32_t frameIndex, uint64_t frameNumber) {
+        std::vector<Slot *> completed{};
+        {
+            std::lock_guard<std::mutex> lock{_slotMutex};
+            for (Slot &slot : _slots) {
+                if (slot.state == SlotState::Copying && slot.frameIndex == frameIndex) {
+                    completed.push_back(&slot);
+                }
+            }
+        }
+        _frameIndex = frameIndex;
+        _frameNumber = frameNumber;
+
+        for (Slot *slot : completed) {
+            vmaInvalidateAllocation(_allocator, slot->buffer.allocation, 0, VK_WHOLE_SIZE);
+            if (!slot->path.empty()) {
+                {
+                    std::lock_guard<std::mutex> lock{_slotMutex};
+                    slot->state = SlotState::Writing;
+                }
+                _pendingWrites.fetch_add(1, std::memory_order_relaxed);
+                _jobs->schedule_background([this, slot]() { write(*slot); }, &_writeJobs);
+                continue;
+            }
+            if (slot->callback) {
+                slot->callback(slot->result);
+            }
+            std::lock_guard<std::mutex> lock{_slotMutex};
+            slot->callback = nullptr;
+            slot->state = SlotState::Free;
+        }
+    }
+    uint32_t ReadbackQueue::get_slots_in_flight() {
+        std::lock_guard<std::mutex> lock{_slotMutex};
+        uint32_t count = 0;
+        for (const Slot &slot : _slots) {
+            count += slot.state != SlotState::Free;
+        }
+        return count;
+    }
+    ReadbackQueue::Slot *ReadbackQueue::acquire(VkDeviceSize size) {
+        std::lock_guard<std::mutex> lock{_slotMutex};
+        //! A free slot that is large enough, otherwise the first free one grows
+        Slot *slot = nullptr;
+        for (Slot &candidate : _slots) {
+            if (candidate.state != SlotState::Free) {
+                continue;
+            }
+            if (candidate.capacity >= size) {
+                slot = &candidate;
+                break;
+            }
+            if (slot == nullptr) {
+                slot = &candidate;
+            }
+        }
+        if (slot == nullptr) {
+            _droppedCount++;
+            return nullptr;
+        }
+
+        if (slot->capacity < size) {
+            if (slot->capacity > 0) {
+                vmaDestroyBuffer(_allocator, slot->buffer.buffer, slot->buffer.allocation);
+            }
+            VmaAllocationCreateInfo allocCreateInfo{
+                .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+                .usage = VMA_MEMORY_USAGE_GPU_TO_CPU,
+            };
+            slot->buffer.buffer = BufferBuilder{}
+                                      .set_size(size)
+                                      .set_usage(VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+                                      .vmaBuild(_allocator, &allocCreateInfo, &slot->buffer.allocation, &slot->buffer.info);
+            slot->capacity = size;
+        }
+        slot->state = SlotState::Copying;
+        slot->frameIndex = _frameIndex;
+        slot->path.clear();
+        slot->result = ReadbackResult{
+            .data = slot->buffer.info.pMappedData,
+            .size = size,
+            .frame = _frameNumber,
+        };
+        return slot;
+    }
+    ReadbackQueue::Slot *ReadbackQueue::record_image_copy(VkCommandBuffer cmd,
+                                                          const BlueVKImage &image,
+                                                          VkImageLayout layout,
+                                                          VkOffset2D offset,
+                                                          VkExtent2D extent) {
+        VkImageAspectFlags aspect = image.format == VK_FORMAT_D32_SFLOAT ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        Slot *slot = acquire(get_texel_size(image.format) * extent.width * extent.height);
+        if (slot == nullptr) {
+            return nullptr;
+        }
+        slot->result.format = image.format;
+        slot->result.extent = extent;
+
+        transition_image(cmd, image.image, layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        copy_image_to_buffer(cmd, image.image, slot->buffer.buffer, offset, extent, aspect);
+        transition_image(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout);
+        record_host_barrier(cmd);
+        return slot;
+    }
+    void ReadbackQueue::record_host_barrier(VkCommandBuffer cmd) {
+        memory_barrier(cmd,
+                       VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                       VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                       VK_PIPELINE_STAGE_2_HOST_BIT,
+                       VK_ACCESS_2_HOST_READ_BIT);
+    }
+    void ReadbackQueue::write(Slot &slot) {
+        try {
+            write_capture(slot.path, slot.result);
+        } catch (const std::exception &e) {
+            fmt::println("[BlueVK]::[WARNING]: Failed to write capture '{}': {}", slot.path, e.what());
+        }
+        _writtenCount.fetch_add(1, std::memory_order_relaxed);
+        _pendingWrites.fetch_sub(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock{_slotMutex};
+        slot.path.clear();
+        slot.state = SlotState::Free;
+    }
+}  // namespace bluevk
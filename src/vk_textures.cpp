@@ -0,0 +1,483 @@
+#include <vk_textures.hpp>
+#include <vk_dispatch.hpp>
+
+#include <fstream>
+#include <cmath>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <imgui.h>
+
+#include <vk_builders.hpp>
+#include <vk_images.hpp>
+#include <texture_codec.hpp>
+#include <ktx2.hpp>
+
+namespace bluevk {
+    static uint64_t hash_bytes(const std::vector<uint8_t> &bytes) {
+        //! FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for (uint8_t byte : bytes) {
+            hash ^= byte;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    //! Transfer source so defragmentation can copy the image somewhere else
+    static constexpr VkImageUsageFlags TEXTURE_USAGE = VK_IMAGE_USAGE_SAMPLED_BIT |
+                                                       VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                                       VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    static VkExtent2D get_mip_extent(VkExtent2D extent, uint32_t mip) {
+        return VkExtent2D{std::max(extent.width >> mip, 1u), std::max(extent.height >> mip, 1u)};
+    }
+    static uint32_t get_tail_mip(VkExtent2D extent, uint32_t mipLevels) {
+        uint32_t mip = 0;
+        while (mip + 1 < mipLevels) {
+            VkExtent2D mipExtent = get_mip_extent(extent, mip);
+            if (std::max(mipExtent.width, mipExtent.height) <= TextureCache::MIP_TAIL_SIZE) {
+                break;
+            }
+            mip++;
+        }
+        return mip;
+    }
+
+    void TextureCache::init(VkDevice device,
+                            VkPhysicalDevice physicalDevice,
+                            VmaAllocator allocator,
+                            bool textureCompressionBC,
+                            uint32_t frameCount,
+                            JobSystem *jobs,
+                            VkDeviceSize uploadBudget,
+                            Downsampler *downsampler) {
+        _device = device;
+        _allocator = allocator;
+        _uploadBudget = uploadBudget;
+
+        _bcSupported = textureCompressionBC;
+        for (VkFormat format : {VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_BC5_UNORM_BLOCK}) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+            _bcSupported &= (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+        }
+        if (!_bcSupported) {
+            fmt::println("[BlueVK]::[WARNING]: BC textures are not supported, KTX2 textures will be decoded to RGBA8");
+        }
+
+        _pendingFrees.resize(frameCount);
+        _sampler = SamplerBuilder{}
+                       .set_filter(VK_FILTER_LINEAR, VK_FILTER_LINEAR)
+                       .set_mipmap_mode(VK_SAMPLER_MIPMAP_MODE_LINEAR)
+                       .set_address_mode(VK_SAMPLER_ADDRESS_MODE_REPEAT)
+                       .build(_device);
+        _jobs = jobs;
+        _downsampler = downsampler;
+    }
+    void TextureCache::destroy() {
+        _jobs->wait(_decodeJobs);
+        for (std::vector<std::function<void()>> &frees : _pendingFrees) {
+            for (std::function<void()> &free : frees) {
+                free();
+            }
+            frees.clear();
+        }
+        for (Texture &texture : _textures) {
+            if (texture.image.image != VK_NULL_HANDLE) {
+                vkd.vkDestroyImageView(_device, texture.image.view, nullptr);
+                vmaDestroyImage(_allocator, texture.image.image, texture.image.allocation);
+            }
+        }
+        _textures.clear();
+        _pathLookup.clear();
+        _cache.clear();
+        _decoded.clear();
+        _pendingUploads.clear();
+        vkd.vkDestroySampler(_device, _sampler, nullptr);
+    }
+    TextureHandle TextureCache::load(const std::string &path) {
+        auto it = _pathLookup.find(path);
+        if (it != _pathLookup.end()) {
+            return it->second;
+        }
+        return request(path);
+    }
+    TextureHandle TextureCache::reload(const std::string &path) {
+        //! The file is hashed again, unchanged content resolves to the already uploaded texture
+        return request(path);
+    }
+    TextureHandle TextureCache::request(const std::string &path) {
+        TextureHandle handle = (TextureHandle)_textures.size();
+        _textures.push_back(Texture{.path = path});
+        _pathLookup[path] = handle;
+        _jobs->schedule_background([this, handle, path]() { decode(handle, path); }, &_decodeJobs);
+        return handle;
+    }
+    void TextureCache::decode(TextureHandle handle, const std::string &path) {
+        DecodedTexture decoded{.handle = handle, .contentHash = 0};
+
+        std::ifstream file{path, std::ios::ate | std::ios::binary};
+        if (!file.is_open()) {
+            fmt::println("[BlueVK]::[WARNING]: Failed to open texture '{}'!", path);
+            decoded.failed = true;
+        } else {
+            size_t fileSize = file.tellg();
+            std::vector<uint8_t> bytes(fileSize);
+            file.seekg(0);
+            file.read(reinterpret_cast<char *>(bytes.data()), fileSize);
+            file.close();
+
+            decoded.contentHash = hash_bytes(bytes);
+            std::string key = fmt::format("{}#{:016x}", path, decoded.contentHash);
+            {
+                std::lock_guard<std::mutex> lock{_cacheMutex};
+                auto [it, inserted] = _cache.try_emplace(key, handle);
+                if (!inserted) {
+                    decoded.aliasOf = it->second;
+                }
+            }
+
+            if (decoded.aliasOf == INVALID_TEXTURE) {
+                decoded.failed = is_ktx2(bytes) ? !decode_ktx2(decoded, path, bytes) : !decode_image(decoded, path, bytes);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock{_decodedMutex};
+        _decoded.push_back(std::move(decoded));
+    }
+    bool TextureCache::decode_image(DecodedTexture &decoded, const std::string &path, const std::vector<uint8_t> &bytes) {
+        int width, height, channels;
+        stbi_uc *data = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels, STBI_rgb_alpha);
+        if (data == nullptr) {
+            fmt::println("[BlueVK]::[WARNING]: Failed to decode texture '{}': {}", path, stbi_failure_reason());
+            return false;
+        }
+        decoded.format = VK_FORMAT_R8G8B8A8_UNORM;
+        decoded.extent = VkExtent2D{(uint32_t)width, (uint32_t)height};
+        decoded.mipLevels = (uint32_t)std::floor(std::log2(std::max(width, height))) + 1;
+        decoded.tailMip = get_tail_mip(decoded.extent, decoded.mipLevels);
+        decoded.generateMips = true;
+        decoded.levels.resize(decoded.mipLevels);
+        decoded.levels[0].assign(data, data + (size_t)width * height * 4);
+        stbi_image_free(data);
+
+        //! Box filtered on the CPU only down to the tail, everything else is generated on the GPU
+        std::vector<uint8_t> pixels = decoded.levels[0];
+        VkExtent2D extent = decoded.extent;
+        for (uint32_t mip = 1; mip <= decoded.tailMip; mip++) {
+            pixels = downsample_rgba8(pixels, extent, extent);
+        }
+        if (decoded.tailMip > 0) {
+            decoded.levels[decoded.tailMip] = std::move(pixels);
+        }
+        return true;
+    }
+    bool TextureCache::decode_ktx2(DecodedTexture &decoded, const std::string &path, const std::vector<uint8_t> &bytes) {
+        std::optional<Ktx2Image> image = read_ktx2(bytes);
+        if (!image.has_value()) {
+            fmt::println("[BlueVK]::[WARNING]: Failed to read KTX2 texture '{}'!", path);
+            return false;
+        }
+        bool isBC = is_bc_format(image->format);
+        if (!isBC && image->format != VK_FORMAT_R8G8B8A8_UNORM && image->format != VK_FORMAT_R8G8B8A8_SRGB) {
+            fmt::println("[BlueVK]::[WARNING]: Unsupported KTX2 format {} in '{}'!", string_VkFormat(image->format), path);
+            return false;
+        }
+        for (uint32_t mip = 0; mip < image->levels.size(); mip++) {
+            if (image->levels[mip].size() != get_image_size(image->format, get_mip_extent(image->extent, mip))) {
+                fmt::println("[BlueVK]::[WARNING]: Truncated mip {} in KTX2 texture '{}'!", mip, path);
+                return false;
+            }
+        }
+
+        decoded.format = image->format;
+        decoded.extent = image->extent;
+        decoded.mipLevels = (uint32_t)image->levels.size();
+        decoded.tailMip = get_tail_mip(decoded.extent, decoded.mipLevels);
+        decoded.generateMips = false;
+        decoded.levels = std::move(image->levels);
+
+        if (isBC && !_bcSupported) {
+            for (uint32_t mip = 0; mip < decoded.mipLevels; mip++) {
+                decoded.levels[mip] = decompress_image(decoded.levels[mip], get_mip_extent(decoded.extent, mip), decoded.format);
+            }
+            decoded.format = decoded.format == VK_FORMAT_BC7_SRGB_BLOCK ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        }
+        return true;
+    }
+    VkImageUsageFlags TextureCache::get_usage(VkFormat format) const {
+        //! The downsampler writes generated levels as storage images
+        bool generated = _downsampler != nullptr && _downsampler->is_format_supported(format);
+        return TEXTURE_USAGE | (generated ? VK_IMAGE_USAGE_STORAGE_BIT : 0);
+    }
+    VkDeviceSize TextureCache::get_stage_bytes(const DecodedTexture &decoded) const {
+        uint32_t firstMip = decoded.stage == UploadStage::MipTail ? decoded.tailMip : 0;
+        uint32_t lastMip = decoded.stage == UploadStage::MipTail ? decoded.mipLevels : decoded.tailMip;
+        VkDeviceSize bytes = 0;
+        for (uint32_t mip = firstMip; mip < lastMip; mip++) {
+            bytes += decoded.levels[mip].size();
+        }
+        return bytes;
+    }
+    bool TextureCache::has_pending_work() {
+        if (!_decodeJobs.is_done() || !_pendingUploads.empty()) {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock{_decodedMutex};
+        return !_decoded.empty();
+    }
+    void TextureCache::update(VkCommandBuffer cmd, uint32_t frameIndex) {
+        uint32_t frameSlot = frameIndex % _pendingFrees.size();
+        for (std::function<void()> &free : _pendingFrees[frameSlot]) {
+            free();
+        }
+        _pendingFrees[frameSlot].clear();
+
+        {
+            std::lock_guard<std::mutex> lock{_decodedMutex};
+            while (!_decoded.empty()) {
+                _pendingUploads.push_back(std::move(_decoded.front()));
+                _decoded.pop_front();
+            }
+        }
+
+        VkDeviceSize budget = _uploadBudget;
+        bool uploaded = false;
+        while (!_pendingUploads.empty()) {
+            DecodedTexture &decoded = _pendingUploads.front();
+            Texture &texture = _textures[decoded.handle];
+            texture.contentHash = decoded.contentHash;
+
+            if (decoded.failed) {
+                texture.state = TextureState::Failed;
+                _pendingUploads.pop_front();
+                continue;
+            }
+            if (decoded.aliasOf != INVALID_TEXTURE) {
+                texture.aliasOf = decoded.aliasOf;
+                _pendingUploads.pop_front();
+                continue;
+            }
+
+            VkDeviceSize bytes = get_stage_bytes(decoded);
+            //! At least one upload per frame so a texture larger than the budget still makes progress
+            if (uploaded && bytes > budget) {
+                break;
+            }
+            upload(cmd, frameSlot, decoded);
+            budget -= std::min(bytes, budget);
+            uploaded = true;
+            _uploadedBytes += bytes;
+
+            if (texture.state == TextureState::Resident) {
+                _pendingUploads.pop_front();
+            }
+        }
+    }
+    void TextureCache::upload(VkCommandBuffer cmd, uint32_t frameSlot, DecodedTexture &decoded) {
+        Texture &texture = _textures[decoded.handle];
+        uint32_t firstMip = decoded.stage == UploadStage::MipTail ? decoded.tailMip : 0;
+        uint32_t lastMip = decoded.stage == UploadStage::MipTail ? decoded.mipLevels : decoded.tailMip;
+
+        //! All levels of the stage share one staging buffer, offsets are aligned for block compressed copies
+        std::vector<VkDeviceSize> offsets(decoded.mipLevels, 0);
+        VkDeviceSize stagingSize = 0;
+        for (uint32_t mip = firstMip; mip < lastMip; mip++) {
+            stagingSize = (stagingSize + BC_BLOCK_SIZE - 1) / BC_BLOCK_SIZE * BC_BLOCK_SIZE;
+            offsets[mip] = stagingSize;
+            stagingSize += decoded.levels[mip].size();
+        }
+
+        BlueVKBuffer staging;
+        VmaAllocationCreateInfo stagingCreateInfo{
+            .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_ONLY,
+        };
+        staging.buffer = BufferBuilder{}
+                             .set_size(stagingSize)
+                             .set_usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+                             .vmaBuild(_allocator, &stagingCreateInfo, &staging.allocation, &staging.info);
+        for (uint32_t mip = firstMip; mip < lastMip; mip++) {
+            memcpy((uint8_t *)staging.info.pMappedData + offsets[mip], decoded.levels[mip].data(), decoded.levels[mip].size());
+        }
+        vmaFlushAllocation(_allocator, staging.allocation, 0, VK_WHOLE_SIZE);
+
+        if (decoded.stage == UploadStage::MipTail) {
+            VmaAllocationCreateInfo allocCreateInfo{
+                .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+                .requiredFlags = VkMemoryPropertyFlags{VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT},
+            };
+            texture.image.format = decoded.format;
+            texture.image.extent = decoded.extent;
+            texture.image.mipLevels = decoded.mipLevels;
+            texture.image.image = ImageBuilder{}
+                                      .set_extent(decoded.extent)
+                                      .set_format(texture.image.format)
+                                      .set_mip_levels(decoded.mipLevels)
+                                      .set_usage(get_usage(texture.image.format))
+                                      .vmaBuild(_allocator, &allocCreateInfo, &texture.image.allocation, nullptr);
+            texture.movable = std::make_unique<MovableResource>(MovableResource{
+                .move = [this, handle = decoded.handle](VkCommandBuffer cmd, VmaAllocation destination) {
+                    return move(handle, cmd, destination);
+                },
+            });
+            vmaSetAllocationUserData(_allocator, texture.image.allocation, texture.movable.get());
+            transition_image_mips(cmd, texture.image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, decoded.mipLevels);
+
+            VmaAllocationInfo allocationInfo;
+            vmaGetAllocationInfo(_allocator, texture.image.allocation, &allocationInfo);
+            texture.memoryBytes = allocationInfo.size;
+            texture.uncompressedBytes = 0;
+            for (uint32_t mip = 0; mip < decoded.mipLevels; mip++) {
+                texture.uncompressedBytes += get_image_size(VK_FORMAT_R8G8B8A8_UNORM, get_mip_extent(decoded.extent, mip));
+            }
+        } else if (decoded.generateMips) {
+            //! The tail is being sampled, it goes back to TRANSFER_DST so the chain can be rebuilt from level 0
+            transition_image_mips(cmd, texture.image.image,
+                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                  decoded.tailMip, decoded.mipLevels - decoded.tailMip);
+        }
+
+        for (uint32_t mip = firstMip; mip < lastMip; mip++) {
+            if (!decoded.levels[mip].empty()) {
+                copy_buffer_to_image(cmd, staging.buffer, texture.image.image, get_mip_extent(decoded.extent, mip), mip, offsets[mip]);
+                decoded.levels[mip].clear();
+                decoded.levels[mip].shrink_to_fit();
+            }
+        }
+        if (decoded.generateMips && _downsampler != nullptr && _downsampler->is_format_supported(texture.image.format)) {
+            _downsampler->generate_mipmaps(cmd, texture.image, firstMip, decoded.mipLevels - firstMip);
+        } else if (decoded.generateMips) {
+            generate_mipmaps(cmd, texture.image.image, get_mip_extent(decoded.extent, firstMip), firstMip, decoded.mipLevels - firstMip);
+        } else {
+            transition_image_mips(cmd, texture.image.image,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                  firstMip, lastMip - firstMip);
+        }
+
+        texture.residentMip = firstMip;
+        texture.state = firstMip == 0 ? TextureState::Resident : TextureState::Partial;
+        decoded.stage = UploadStage::Full;
+        recreate_view(texture, frameSlot);
+
+        _pendingFrees[frameSlot].push_back([allocator = _allocator, staging]() {
+            vmaDestroyBuffer(allocator, staging.buffer, staging.allocation);
+        });
+    }
+    void TextureCache::recreate_view(Texture &texture, uint32_t frameSlot) {
+        if (texture.image.view != VK_NULL_HANDLE) {
+            _pendingFrees[frameSlot].push_back([device = _device, view = texture.image.view]() {
+                vkd.vkDestroyImageView(device, view, nullptr);
+            });
+        }
+        //! Only the resident levels are part of the view, so sampling never touches unwritten mips
+        texture.image.view = ImageViewBuilder{}
+                                 .set_format(texture.image.format)
+                                 .set_image(texture.image.image)
+                                 .set_mip_range(texture.residentMip, texture.image.mipLevels - texture.residentMip)
+                                 .build(_device);
+    }
+    std::function<void()> TextureCache::move(TextureHandle handle, VkCommandBuffer cmd, VmaAllocation destination) {
+        Texture &texture = _textures[handle];
+        //! Partially streamed images still have levels waiting for uploads, they stay where they are
+        if (texture.state != TextureState::Resident) {
+            return {};
+        }
+
+        VkImage image = ImageBuilder{}
+                            .set_extent(texture.image.extent)
+                            .set_format(texture.image.format)
+                            .set_mip_levels(texture.image.mipLevels)
+                            .set_usage(get_usage(texture.image.format))
+                            .build(_device);
+        VK_CHECK(vmaBindImageMemory(_allocator, destination, image));
+
+        transition_image_mips(cmd, texture.image.image,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                              0, texture.image.mipLevels);
+        transition_image_mips(cmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, texture.image.mipLevels);
+        copy_image_mips(cmd, texture.image.image, image, texture.image.extent, texture.image.mipLevels);
+        transition_image_mips(cmd, image,
+                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              0, texture.image.mipLevels);
+
+        VkImage oldImage = texture.image.image;
+        VkImageView oldView = texture.image.view;
+        texture.image.image = image;
+        texture.image.view = ImageViewBuilder{}
+                                 .set_format(texture.image.format)
+                                 .set_image(texture.image.image)
+                                 .set_mip_range(0, texture.image.mipLevels)
+                                 .build(_device);
+        //! The allocation handle stays the same, VMA rebinds it to the new memory when the pass ends
+        return [device = _device, oldImage, oldView]() {
+            vkd.vkDestroyImageView(device, oldView, nullptr);
+            vkd.vkDestroyImage(device, oldImage, nullptr);
+        };
+    }
+    const TextureCache::Texture &TextureCache::get(TextureHandle handle) const {
+        while (_textures[handle].aliasOf != INVALID_TEXTURE) {
+            handle = _textures[handle].aliasOf;
+        }
+        return _textures[handle];
+    }
+    bool TextureCache::is_usable(TextureHandle handle) const {
+        TextureState state = get(handle).state;
+        return state == TextureState::Partial || state == TextureState::Resident;
+    }
+    VkDeviceSize TextureCache::get_memory_bytes() const {
+        VkDeviceSize bytes = 0;
+        for (const Texture &texture : _textures) {
+            bytes += texture.memoryBytes;
+        }
+        return bytes;
+    }
+    VkDeviceSize TextureCache::get_uncompressed_bytes() const {
+        VkDeviceSize bytes = 0;
+        for (const Texture &texture : _textures) {
+            bytes += texture.uncompressedBytes;
+        }
+        return bytes;
+    }
+    void TextureCache::draw_imgui() {
+        if (ImGui::Begin("Textures")) {
+            static char pathInput[256] = "";
+            ImGui::InputText("Path", pathInput, sizeof(pathInput));
+            ImGui::SameLine();
+            if (ImGui::Button("Load")) {
+                load(pathInput);
+            }
+            ImGui::Text("Uploaded: %.2f MB", _uploadedBytes / (1024.0 * 1024.0));
+            ImGui::Text("VRAM: %.2f MB (%.2f MB as RGBA8)%s",
+                        get_memory_bytes() / (1024.0 * 1024.0),
+                        get_uncompressed_bytes() / (1024.0 * 1024.0),
+                        _bcSupported ? "" : ", BC decoded on the CPU");
+            ImGui::Separator();
+            for (TextureHandle handle = 0; handle < _textures.size(); handle++) {
+                const Texture &texture = get(handle);
+                const char *state = "Loading";
+                switch (texture.state) {
+                    case TextureState::Failed:
+                        state = "Failed";
+                        break;
+                    case TextureState::Partial:
+                        state = "Partial";
+                        break;
+                    case TextureState::Resident:
+                        state = "Resident";
+                        break;
+                    default:
+                        break;
+                }
+                ImGui::Text("[%u] %s: %ux%u %s, %s from mip %u%s",
+                            handle, _textures[handle].path.c_str(),
+                            texture.image.extent.width, texture.image.extent.height,
+                            string_VkFormat(texture.image.format),
+                            state, texture.residentMip,
+                            _textures[handle].aliasOf != INVALID_TEXTURE ? " (cached)" : "");
+            }
+        }
+        ImGui::End();
+    }
+}  // namespace bluevk
@@ -0,0 +1,70 @@
+#include <fstream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <ktx2.hpp>
+#include <texture_codec.hpp>
+
+using namespace bluevk;
+
+//! Offline converter: encodes an image into a BC7 (color) or BC5 (normal map) KTX2 file with a full mip chain
+//! Usage: BlueVKTextureConverter <input> <output.ktx2> [--bc5] [--srgb]
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fmt::println("Usage: {} <input> <output.ktx2> [--bc5] [--srgb]", argv[0]);
+        return 1;
+    }
+    std::string inputPath = argv[1];
+    std::string outputPath = argv[2];
+    VkFormat format = VK_FORMAT_BC7_UNORM_BLOCK;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bc5") {
+            format = VK_FORMAT_BC5_UNORM_BLOCK;
+        } else if (arg == "--srgb") {
+            format = VK_FORMAT_BC7_SRGB_BLOCK;
+        } else {
+            fmt::println("[BlueVK]::[CONVERTER]: Unknown argument '{}'", arg);
+            return 1;
+        }
+    }
+
+    int width, height, channels;
+    stbi_uc *data = stbi_load(inputPath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (data == nullptr) {
+        fmt::println("[BlueVK]::[CONVERTER]: Failed to load '{}': {}", inputPath, stbi_failure_reason());
+        return 1;
+    }
+
+    Ktx2Image image{
+        .format = format,
+        .extent = VkExtent2D{(uint32_t)width, (uint32_t)height},
+    };
+    std::vector<uint8_t> pixels(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+
+    size_t uncompressedBytes = 0;
+    VkExtent2D extent = image.extent;
+    while (true) {
+        uncompressedBytes += pixels.size();
+        image.levels.push_back(compress_image(pixels, extent, format));
+        if (extent.width == 1 && extent.height == 1) {
+            break;
+        }
+        pixels = downsample_rgba8(pixels, extent, extent);
+    }
+
+    std::vector<uint8_t> bytes = write_ktx2(image);
+    std::ofstream file(outputPath, std::ios::binary);
+    if (!file.is_open()) {
+        fmt::println("[BlueVK]::[CONVERTER]: Failed to open '{}' for writing", outputPath);
+        return 1;
+    }
+    file.write((const char *)bytes.data(), (std::streamsize)bytes.size());
+
+    fmt::println("[BlueVK]::[CONVERTER]: {} -> {} ({}x{}, {} mips, {}): {:.2f} MB -> {:.2f} MB",
+                  inputPath, outputPath, width, height, image.levels.size(), string_VkFormat(format),
+                  uncompressedBytes / (1024.0 * 1024.0), bytes.size() / (1024.0 * 1024.0));
+    return 0;
+}